@@ -0,0 +1,147 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jeff Ferr                                       *
+ *   root@sat                                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#include "jmedia/jimagepack.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <algorithm>
+#include <vector>
+#include <map>
+
+#include <string.h>
+
+#define MANIFEST "manifest"
+
+int main(int argc, char *argv[]) 
+{
+	if (argc < 3) {
+		std::cout << "usage: " << argv[0] << " <directory> <output> [fps]" << std::endl;
+
+		return -1;
+	}
+
+	std::filesystem::path directory = argv[1];
+	std::vector<std::filesystem::path> files;
+	std::map<std::string, uint64_t> durations;
+	uint64_t frame_duration = 1000000;
+
+	if (argc > 3 and atof(argv[3]) > 0.0) {
+		frame_duration = (uint64_t)(1000000.0/atof(argv[3]));
+	}
+
+	for (auto const &entry : std::filesystem::directory_iterator(directory)) {
+		if (entry.is_regular_file() == true and entry.path().filename() != MANIFEST) {
+			files.push_back(entry.path());
+		}
+	}
+
+	if (files.size() == 0) {
+		std::cout << "There is no file in the directory" << std::endl;
+
+		return -1;
+	}
+
+	std::sort(files.begin(), files.end());
+
+	// the same manifest the image list player reads: "<file> <milliseconds>" per line
+	std::ifstream manifest(directory / MANIFEST);
+	std::string line;
+
+	while (std::getline(manifest, line)) {
+		std::istringstream tokens(line);
+		std::string name;
+		double ms;
+
+		if (!(tokens >> name) or name[0] == '#' or !(tokens >> ms) or ms < 0.0) {
+			continue;
+		}
+
+		durations[name] = (uint64_t)(ms*1000.0);
+	}
+
+	std::ofstream output(argv[2], std::ios::binary | std::ios::trunc);
+
+	if (!output) {
+		std::cout << "Unable to create " << argv[2] << std::endl;
+
+		return -1;
+	}
+
+	// the images are appended after the index, so the index is written again at the end
+	jmedia::jimagepack_header_t header;
+	std::vector<jmedia::jimagepack_entry_t> entries(files.size());
+
+	memcpy(header.magic, JMEDIA_IMAGEPACK_MAGIC, 4);
+
+	header.version = JMEDIA_IMAGEPACK_VERSION;
+	header.count = files.size();
+	header.duration = 0;
+
+	output.write((const char *)&header, sizeof(header));
+	output.write((const char *)entries.data(), entries.size()*sizeof(jmedia::jimagepack_entry_t));
+
+	for (std::size_t i=0; i<files.size(); i++) {
+		std::ifstream input(files[i], std::ios::binary);
+
+		if (!input) {
+			std::cout << "Unable to read " << files[i] << std::endl;
+
+			return -1;
+		}
+
+		auto duration = durations.find(files[i].filename().string());
+
+		entries[i].offset = output.tellp();
+		entries[i].start = header.duration;
+
+		// an empty image would set the failbit of the output with operator<<, so the bytes are copied in blocks
+		char buffer[65536];
+
+		while (input.read(buffer, sizeof(buffer)) or input.gcount() > 0) {
+			output.write(buffer, input.gcount());
+		}
+
+		if (!output) {
+			std::cout << "Unable to write " << argv[2] << std::endl;
+
+			return -1;
+		}
+
+		entries[i].size = (uint64_t)output.tellp() - entries[i].offset;
+
+		header.duration = header.duration + ((duration != durations.end() and duration->second != 0)?duration->second:frame_duration);
+	}
+
+	output.seekp(0);
+	output.write((const char *)&header, sizeof(header));
+	output.write((const char *)entries.data(), entries.size()*sizeof(jmedia::jimagepack_entry_t));
+
+	if (!output) {
+		std::cout << "Unable to write " << argv[2] << std::endl;
+
+		return -1;
+	}
+
+	std::cout << "Packed " << files.size() << " images, " << header.duration/1000 << " ms" << std::endl;
+
+	return 0;
+}
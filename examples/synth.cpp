@@ -19,6 +19,9 @@
  ***************************************************************************/
 #include "jmedia/jsynthesizer.h"
 
+#include <thread>
+#include <chrono>
+
 int main(int, char *[]) 
 {
 	jmedia::Synthesizer s("default", 2);
@@ -43,23 +46,27 @@ int main(int, char *[])
 
 		s.SetWave(waves[index].wave);
 
-		s.Play(0, 400, 0.1);
-		s.Play(0, 600, 0.1);
-		s.Play(0, 800, 0.1);
-		s.Play(0, 1000, 0.1);
-		s.Play(0, 1200, 0.1);
-		s.Play(0, 1400, 0.1);
-		s.Play(0, 1600, 0.1);
-		s.Play(0, 400, 0.1);
+		for (int channel=0; channel<2; channel++) {
+			for (double frequency : {400, 600, 800, 1000, 1200, 1400, 1600, 400}) {
+				// the note is queued and the call returns at once
+				s.Play(channel, frequency, 0.1);
+
+				std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			}
+		}
+
+		// a chord on both channels
+		uint32_t notes[] = {
+			s.NoteOn(-1, 262, 0.3),
+			s.NoteOn(-1, 330, 0.3),
+			s.NoteOn(-1, 392, 0.3)
+		};
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(500));
 
-		s.Play(1, 400, 0.1);
-		s.Play(1, 600, 0.1);
-		s.Play(1, 800, 0.1);
-		s.Play(1, 1000, 0.1);
-		s.Play(1, 1200, 0.1);
-		s.Play(1, 1400, 0.1);
-		s.Play(1, 1600, 0.1);
-		s.Play(1, 400, 0.1);
+		for (uint32_t note : notes) {
+			s.NoteOff(note);
+		}
 
 		index = (index + 1) % 6;
 	}
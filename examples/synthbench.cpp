@@ -0,0 +1,155 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jeff Ferr                                       *
+ *   root@sat                                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#include "jmedia/jsynthesizer.h"
+#include "jmedia/joscillator.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+
+#include <math.h>
+
+#define DEFAULT_SAMPLE_RATE 48000
+#define DEFAULT_FREQUENCY 440.0
+#define DEFAULT_SECONDS 20
+#define BLOCK_SIZE 256
+
+// the loop of the synthesizer before the oscillator, one call of the wave per sample
+static void render_function(double (* function)(double), int16_t *samples, int count, double frequency, int sample_rate, double *state)
+{
+	double 
+		phase = *state,
+		max_phase = 1.0/frequency,
+		step = 1.0/sample_rate;
+
+	for (int i=0; i<count; i++) {
+		samples[i] = (int16_t)(function((phase*2*M_PI)/max_phase - M_PI)*32767);
+
+		phase = phase + step;
+
+		if (phase >= max_phase) {
+			phase = phase - max_phase;
+		}
+	}
+
+	*state = phase;
+}
+
+static void render_oscillator(jmedia::Oscillator *oscillator, float *block, int16_t *samples, int count)
+{
+	oscillator->Render(block, count);
+
+	for (int i=0; i<count; i++) {
+		samples[i] = (int16_t)(block[i]*32767.0f);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int seconds = DEFAULT_SECONDS;
+
+	if (argc > 1 and atoi(argv[1]) > 0) {
+		seconds = atoi(argv[1]);
+	}
+
+	struct wave_t {
+		std::string name;
+		double (* function)(double);
+		jmedia::jwaveform_t waveform;
+	};
+
+	struct wave_t waves[] = {
+		{"sine", jmedia::sine_wave, jmedia::jwaveform_t::Sine},
+		{"triangle", jmedia::triangle_wave, jmedia::jwaveform_t::Triangle},
+		{"sawtooth", jmedia::sawtooth_wave, jmedia::jwaveform_t::Sawtooth},
+		{"square", jmedia::square_wave, jmedia::jwaveform_t::Square},
+		{"noise", jmedia::noise_wave, jmedia::jwaveform_t::Noise}
+	};
+
+	std::vector<int16_t> samples(BLOCK_SIZE);
+	std::vector<float> block(BLOCK_SIZE);
+	int blocks = seconds*DEFAULT_SAMPLE_RATE/BLOCK_SIZE;
+	int64_t checksum = 0;
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << seconds << " s of " << DEFAULT_FREQUENCY << " Hz at " << DEFAULT_SAMPLE_RATE << " Hz, in blocks of " << BLOCK_SIZE << " samples" << std::endl;
+	std::cout << std::setw(10) << "wave" << std::setw(18) << "function [MS/s]" << std::setw(20) << "oscillator [MS/s]" << std::setw(10) << "speedup" << std::endl;
+
+	for (auto &wave : waves) {
+		jmedia::Oscillator oscillator(DEFAULT_SAMPLE_RATE);
+		double state = 0.0;
+
+		oscillator.SetWaveform(wave.waveform);
+		oscillator.SetFrequency(DEFAULT_FREQUENCY);
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		for (int i=0; i<blocks; i++) {
+			render_function(wave.function, samples.data(), BLOCK_SIZE, DEFAULT_FREQUENCY, DEFAULT_SAMPLE_RATE, &state);
+
+			checksum = checksum + samples[i % BLOCK_SIZE];
+		}
+
+		double function = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		start = std::chrono::steady_clock::now();
+
+		for (int i=0; i<blocks; i++) {
+			render_oscillator(&oscillator, block.data(), samples.data(), BLOCK_SIZE);
+
+			checksum = checksum + samples[i % BLOCK_SIZE];
+		}
+
+		double generated = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		double count = (double)blocks*BLOCK_SIZE/1e6;
+
+		std::cout << std::setw(10) << wave.name << std::setw(18) << count/function << std::setw(20) << count/generated << std::setw(9) << function/generated << "x" << std::endl;
+	}
+
+	// a sequence of chords rendered without a device, as fast as the cpu allows
+	jmedia::Synthesizer synthesizer(2, DEFAULT_SAMPLE_RATE);
+	std::vector<jmedia::jnote_t> notes;
+	uint64_t period = DEFAULT_SAMPLE_RATE/10;
+
+	synthesizer.SetWave(jmedia::sawtooth_wave);
+
+	for (uint64_t i=0; i<(uint64_t)seconds*10; i++) {
+		for (int k=0; k<8; k++) {
+			notes.push_back({i*period, period, -1, DEFAULT_FREQUENCY/2 + 50*k, 0.1});
+		}
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	std::vector<int16_t> rendered = synthesizer.Render(notes);
+
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	double duration = (double)rendered.size()/2/DEFAULT_SAMPLE_RATE;
+
+	std::cout << "offline: " << duration << " s of 8 voices in " << elapsed*1000 << " ms, " << duration/elapsed << "x realtime" << std::endl;
+
+	checksum = checksum + rendered[rendered.size()/2];
+
+	// keeps the loops from being optimized away
+	std::cout << "checksum: " << checksum << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,161 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jeff Ferr                                       *
+ *   root@sat                                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#include "jmedia/jplayermanager.h"
+#include "jmedia/jframegrabberlistener.h"
+#include "jmedia/jvideostatisticscontrol.h"
+#include "jcanvas/core/jbufferedimage.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#define DEFAULT_DEVICE "v4l2:///synthetic,size=640x480,format=yuyv,fps=60"
+#define DEFAULT_DURATION 10
+
+class CaptureBench : public jmedia::FrameGrabberListener {
+
+	private:
+		uint64_t _checksum;
+		uint64_t _frames;
+
+	public:
+		CaptureBench()
+		{
+			_checksum = 0;
+			_frames = 0;
+		}
+
+		virtual ~CaptureBench()
+		{
+		}
+
+		uint64_t GetFrames()
+		{
+			return _frames;
+		}
+
+		virtual void FrameGrabbed(jmedia::FrameGrabberEvent *event)
+		{
+			// every painted frame is reported, so only the ones whose first line changed are counted
+			std::shared_ptr<jcanvas::Image> image = event->GetFrame();
+			jcanvas::jpoint_t<int> size = image->GetSize();
+
+			uint32_t *data = (uint32_t *)image->LockData();
+			uint64_t checksum = 0;
+
+			if (data != nullptr) {
+				for (int i=0; i<size.x; i++) {
+					checksum = checksum*31 + data[i];
+				}
+			}
+
+			image->UnlockData();
+
+			if (checksum != _checksum) {
+				_checksum = checksum;
+				_frames = _frames + 1;
+			}
+		}
+
+};
+
+int main(int argc, char **argv)
+{
+	std::string device = DEFAULT_DEVICE;
+	int duration = DEFAULT_DURATION;
+
+	if (argc > 1) {
+		device = argv[1];
+	}
+
+	if (argc > 2 and atoi(argv[2]) > 0) {
+		duration = atoi(argv[2]);
+	}
+
+	jmedia::Player *player = jmedia::PlayerManager::CreatePlayer(device);
+
+	if (player == nullptr) {
+		std::cout << "use:: " << argv[0] << " [" << DEFAULT_DEVICE << "] [seconds]" << std::endl;
+
+		return -1;
+	}
+
+	jcanvas::Component *cmp = player->GetVisualComponent();
+	CaptureBench bench;
+
+	cmp->SetSize(640, 480);
+
+	player->RegisterFrameGrabberListener(&bench);
+	player->Play();
+
+	// paints as a display with no vsync would, measuring the conversion and the blit of each frame
+	std::shared_ptr<jcanvas::Image> offscreen = std::make_shared<jcanvas::BufferedImage>(jcanvas::jpixelformat_t::RGB32, jcanvas::jpoint_t<int>{640, 480});
+	std::vector<double> times;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point end = start + std::chrono::seconds(duration);
+
+	while (std::chrono::steady_clock::now() < end) {
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+		cmp->Paint(offscreen->GetGraphics());
+
+		times.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count());
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	jmedia::VideoStatisticsControl *control = dynamic_cast<jmedia::VideoStatisticsControl *>(player->GetControl("video.statistics"));
+
+	player->Stop();
+	player->RemoveFrameGrabberListener(&bench);
+
+	std::sort(times.begin(), times.end());
+
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "device: " << device << std::endl;
+	std::cout << "frames: " << bench.GetFrames() << " (" << bench.GetFrames()/elapsed << " fps)" << std::endl;
+	std::cout << "paints: " << times.size() << std::endl;
+
+	if (times.size() > 0) {
+		std::cout << "paint [us]: p50 " << times[times.size()/2] << ", p99 " << times[(times.size()*99)/100] << ", max " << times.back() << std::endl;
+	}
+
+	if (control != nullptr) {
+		const char *stages[] = {"dequeue", "convert", "paint"};
+
+		std::cout << "captured: " << control->GetCapturedFrames() << ", dropped: " << control->GetDroppedFrames() << ", skipped: " << control->GetSkippedFrames() << std::endl;
+
+		for (int i=0; i<3; i++) {
+			jmedia::jlatency_statistics_t latency = control->GetLatency((jmedia::jlatency_stage_t)i);
+
+			std::cout << "capture to " << stages[i] << " [us]: p50 " << latency.p50 << ", p99 " << latency.p99 << ", max " << latency.max << " (" << latency.count << " frames)" << std::endl;
+		}
+	}
+
+	delete player;
+
+	return 0;
+}
@@ -10,11 +10,24 @@ target_sources(${PROJECT_NAME} PRIVATE providers/ilist/bind.cpp)
 target_compile_definitions(${PROJECT_NAME} PRIVATE ILIST_IMAGE)
 list(APPEND IMAGE_PROVIDER_LIST ilist)
 
+pkg_check_modules(LibJpeg IMPORTED_TARGET libjpeg)
+
+if (LibJpeg_FOUND)
+  target_link_libraries(${PROJECT_NAME} PRIVATE PkgConfig::LibJpeg)
+  target_compile_definitions(${PROJECT_NAME} PRIVATE ILIST_LIBJPEG)
+endif()
+
 # alsa
 pkg_check_modules(Alsa IMPORTED_TARGET alsa)
 
 if (Alsa_FOUND)
-  target_sources(${PROJECT_NAME} PRIVATE providers/alsa/bind.cpp)
+  target_sources(${PROJECT_NAME}
+    PRIVATE
+      providers/alsa/audioconverter.cpp
+      providers/alsa/audiomixer.cpp
+      providers/alsa/bind.cpp
+      providers/alsa/periodring.cpp
+      providers/alsa/wavefile.cpp)
   target_link_libraries(${PROJECT_NAME} PUBLIC PkgConfig::Alsa)
   target_compile_definitions(${PROJECT_NAME} PRIVATE ALSA_MEDIA)
   list(APPEND MEDIA_PROVIDER_LIST alsa)
@@ -79,11 +92,27 @@ if (LibV4l2_FOUND)
   target_sources(${PROJECT_NAME}
     PRIVATE
       providers/v4l2/bind.cpp
+      providers/v4l2/capturereactor.cpp
+      providers/v4l2/latencyhistogram.cpp
+      providers/v4l2/mjpegdecoder.cpp
+      providers/v4l2/syntheticdevice.cpp
       providers/v4l2/videocontrol.cpp
+      providers/v4l2/videodevice.cpp
       providers/v4l2/videograbber.cpp)
   target_link_libraries(${PROJECT_NAME} PUBLIC PkgConfig::LibV4l2)
   target_compile_definitions(${PROJECT_NAME} PRIVATE V4L2_MEDIA)
   list(APPEND MEDIA_PROVIDER_LIST v4l2)
+
+  if (LibJpeg_FOUND)
+    target_compile_definitions(${PROJECT_NAME} PRIVATE V4L2_LIBJPEG)
+  endif()
+
+  pkg_check_modules(TurboJpeg IMPORTED_TARGET libturbojpeg)
+
+  if (TurboJpeg_FOUND)
+    target_link_libraries(${PROJECT_NAME} PRIVATE PkgConfig::TurboJpeg)
+    target_compile_definitions(${PROJECT_NAME} PRIVATE V4L2_TURBOJPEG)
+  endif()
 endif()
 
 message ("\tProviders: ${MEDIA_PROVIDER_LIST}")
@@ -0,0 +1,44 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jeff Ferr                                       *
+ *   root@sat                                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#pragma once
+
+#include <cstdint>
+
+namespace jmedia {
+
+/**
+ * \brief Parameters of the stream of an audio device. The sizes are in frames of the device, and
+ * a zero keeps the choice of the driver.
+ *
+ */
+struct jaudio_latency_t {
+  /** \brief frames between two wakeups of the writer */
+  uint32_t period_size = 0;
+  /** \brief frames queued in the device, the latency of the output */
+  uint32_t buffer_size = 0;
+  /** \brief frames queued before the device starts */
+  uint32_t start_threshold = 0;
+  /** \brief frames free in the device before the writer is woken up */
+  uint32_t avail_min = 0;
+  /** \brief runs the writer with SCHED_FIFO and locks its buffers in memory, when the process is allowed to */
+  bool realtime = false;
+};
+
+}
@@ -0,0 +1,86 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jeff Ferr                                       *
+ *   root@sat                                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#pragma once
+
+#include "jmedia/jcontrol.h"
+
+#include <cstdint>
+
+namespace jmedia {
+
+/**
+ * \brief
+ *
+ * \author Jeff Ferr
+ */
+class AudioStatisticsControl : public Control {
+
+  public:
+    /**
+     * \brief
+     *
+     */
+    AudioStatisticsControl();
+
+    /**
+     * \brief Destrutor virtual.
+     *
+     */
+    virtual ~AudioStatisticsControl();
+
+    /**
+     * \brief Returns the times the device ran out of samples.
+     *
+     */
+    virtual uint64_t GetUnderruns();
+
+    /**
+     * \brief Returns the milliseconds of audio read ahead of the device.
+     *
+     */
+    virtual uint64_t GetBufferLevel();
+
+    /**
+     * \brief Returns the lowest level of the buffer since the last reset, in milliseconds.
+     *
+     */
+    virtual uint64_t GetMinimumBufferLevel();
+
+    /**
+     * \brief Returns the milliseconds of audio that the buffer holds when it is full.
+     *
+     */
+    virtual uint64_t GetBufferCapacity();
+
+    /**
+     * \brief Returns the milliseconds between the write of a sample and its output, as measured by the device.
+     *
+     */
+    virtual uint64_t GetLatency();
+
+    /**
+     * \brief
+     *
+     */
+    virtual void Reset();
+
+};
+
+}
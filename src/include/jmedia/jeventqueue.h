@@ -0,0 +1,142 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jeff Ferr                                       *
+ *   root@sat                                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+namespace jmedia {
+
+/**
+ * \brief Bounded queue of events for any number of producers and consumers.
+ * Each slot carries a sequence number that tells whose turn it is, so a push
+ * or a pop takes one compare and swap and neither side ever waits for a lock.
+ * The capacity is rounded up to a power of two.
+ *
+ */
+template<typename T> class EventQueue {
+
+  private:
+    struct Slot {
+      std::atomic<size_t> sequence;
+      T value;
+    };
+
+  private:
+    /** \brief */
+    std::unique_ptr<Slot[]> _slots;
+    /** \brief */
+    size_t _mask;
+    /** \brief */
+    alignas(64) std::atomic<size_t> _head;
+    /** \brief */
+    alignas(64) std::atomic<size_t> _tail;
+
+  public:
+    /**
+     * \brief
+     *
+     */
+    EventQueue(size_t capacity)
+    {
+      size_t size = 2;
+
+      while (size < capacity) {
+        size = size*2;
+      }
+
+      _slots.reset(new Slot[size]);
+      _mask = size - 1;
+
+      for (size_t i=0; i<size; i++) {
+        _slots[i].sequence.store(i, std::memory_order_relaxed);
+      }
+
+      _head.store(0, std::memory_order_relaxed);
+      _tail.store(0, std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief
+     *
+     */
+    virtual ~EventQueue()
+    {
+    }
+
+    /**
+     * \brief Returns false when the queue is full.
+     *
+     */
+    bool Push(const T &value)
+    {
+      size_t position = _tail.load(std::memory_order_relaxed);
+
+      for (;;) {
+        Slot &slot = _slots[position & _mask];
+        intptr_t difference = (intptr_t)slot.sequence.load(std::memory_order_acquire) - (intptr_t)position;
+
+        if (difference == 0) {
+          if (_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed) == true) {
+            slot.value = value;
+            slot.sequence.store(position + 1, std::memory_order_release);
+
+            return true;
+          }
+        } else if (difference < 0) {
+          return false;
+        } else {
+          position = _tail.load(std::memory_order_relaxed);
+        }
+      }
+    }
+
+    /**
+     * \brief Returns false when the queue is empty.
+     *
+     */
+    bool Pop(T &value)
+    {
+      size_t position = _head.load(std::memory_order_relaxed);
+
+      for (;;) {
+        Slot &slot = _slots[position & _mask];
+        intptr_t difference = (intptr_t)slot.sequence.load(std::memory_order_acquire) - (intptr_t)(position + 1);
+
+        if (difference == 0) {
+          if (_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed) == true) {
+            value = slot.value;
+            slot.sequence.store(position + _mask + 1, std::memory_order_release);
+
+            return true;
+          }
+        } else if (difference < 0) {
+          return false;
+        } else {
+          position = _head.load(std::memory_order_relaxed);
+        }
+      }
+    }
+
+};
+
+}
@@ -20,6 +20,7 @@
 #pragma once
 
 #include "jcanvas/core/jimage.h"
+#include "jcanvas/core/jgraphics.h"
 
 #include <memory>
 
@@ -44,7 +45,13 @@ class FrameGrabberEvent {
     /** \brief */
     std::shared_ptr<jcanvas::Image> _frame;
     /** \brief */
+    jcanvas::jrect_t<int> _region;
+    /** \brief */
     jframeevent_type_t _type;
+    /** \brief */
+    uint64_t _sequence;
+    /** \brief */
+    uint64_t _timestamp;
 
   public:
     /**
@@ -53,6 +60,21 @@ class FrameGrabberEvent {
      */
     FrameGrabberEvent(std::shared_ptr<jcanvas::Image> frame, jframeevent_type_t type);
 
+    /**
+     * \brief 
+     *
+     * \param region Area of the frame that changed since the previous one.
+     */
+    FrameGrabberEvent(std::shared_ptr<jcanvas::Image> frame, jframeevent_type_t type, jcanvas::jrect_t<int> region);
+
+    /**
+     * \brief 
+     *
+     * \param sequence Number of the frame in the stream of the device.
+     * \param timestamp Capture time in microseconds of the monotonic clock (std::chrono::steady_clock).
+     */
+    FrameGrabberEvent(std::shared_ptr<jcanvas::Image> frame, jframeevent_type_t type, uint64_t sequence, uint64_t timestamp);
+
     /**
      * \brief
      *
@@ -65,6 +87,24 @@ class FrameGrabberEvent {
      */
     std::shared_ptr<jcanvas::Image> GetFrame();
 
+    /**
+     * \brief Returns the area of the frame that changed since the previous one.
+     *
+     */
+    jcanvas::jrect_t<int> GetRegion();
+
+    /**
+     * \brief Returns the number of the frame in the stream of the device, or zero when unknown.
+     *
+     */
+    uint64_t GetSequence();
+
+    /**
+     * \brief Returns the capture time in microseconds of the monotonic clock, or zero when unknown.
+     *
+     */
+    uint64_t GetTimestamp();
+
     /**
      * \brief
      *
@@ -0,0 +1,148 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jeff Ferr                                       *
+ *   root@sat                                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace jmedia {
+
+/**
+ * \brief Triple buffer shared by one producer and one consumer. The producer
+ * fills GetWriteBuffer() and calls Publish(), the consumer calls Acquire()
+ * and reads GetReadBuffer(). Neither side ever waits for the other, each one
+ * owns its buffer until the next exchange and the consumer always gets the
+ * most recent frame.
+ *
+ */
+template<typename T> class FrameMailbox {
+
+  private:
+    /** \brief */
+    static const int Fresh = 0x04;
+    /** \brief */
+    static const int Index = 0x03;
+
+  private:
+    /** \brief */
+    T _buffers[3];
+    /** \brief index of the buffer being exchanged, marked as Fresh while not acquired */
+    std::atomic<int> _state;
+    /** \brief */
+    std::atomic<uint64_t> _overwritten;
+    /** \brief */
+    int _write;
+    /** \brief */
+    int _read;
+
+  public:
+    /**
+     * \brief
+     *
+     */
+    FrameMailbox():
+      _state(1), _overwritten(0), _write(0), _read(2)
+    {
+    }
+
+    /**
+     * \brief
+     *
+     */
+    virtual ~FrameMailbox()
+    {
+    }
+
+    /**
+     * \brief Returns the buffer owned by the producer.
+     *
+     */
+    T & GetWriteBuffer()
+    {
+      return _buffers[_write];
+    }
+
+    /**
+     * \brief Hands the write buffer to the consumer. Returns true when it
+     * replaces a frame that was never acquired.
+     *
+     */
+    bool Publish()
+    {
+      int state = _state.exchange(_write | Fresh, std::memory_order_acq_rel);
+
+      _write = state & Index;
+
+      if ((state & Fresh) != 0) {
+        _overwritten.fetch_add(1, std::memory_order_relaxed);
+
+        return true;
+      }
+
+      return false;
+    }
+
+    /**
+     * \brief Returns true when the last published frame was not acquired yet.
+     *
+     */
+    bool IsPending()
+    {
+      return (_state.load(std::memory_order_acquire) & Fresh) != 0;
+    }
+
+    /**
+     * \brief Takes the most recent frame, if any was published since the last
+     * call. Returns false when the read buffer is unchanged.
+     *
+     */
+    bool Acquire()
+    {
+      if (IsPending() == false) {
+        return false;
+      }
+
+      _read = _state.exchange(_read, std::memory_order_acq_rel) & Index;
+
+      return true;
+    }
+
+    /**
+     * \brief Returns the buffer owned by the consumer.
+     *
+     */
+    T & GetReadBuffer()
+    {
+      return _buffers[_read];
+    }
+
+    /**
+     * \brief Returns how many frames were replaced before being acquired.
+     *
+     */
+    uint64_t GetOverwrittenFrames()
+    {
+      return _overwritten.load(std::memory_order_relaxed);
+    }
+
+};
+
+}
+
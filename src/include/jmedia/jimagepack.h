@@ -0,0 +1,51 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jeff Ferr                                       *
+ *   root@sat                                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#pragma once
+
+#include <cstdint>
+
+#define JMEDIA_IMAGEPACK_MAGIC "JMPK"
+#define JMEDIA_IMAGEPACK_VERSION 1
+
+namespace jmedia {
+
+/**
+ * \brief Layout of a packed image sequence, in the byte order of the host
+ * that wrote it: the header, 'count' entries and the encoded images, each
+ * one stored as it was read from its original file. The version is also
+ * the byte order marker, a pack from a host of the other order reads a
+ * swapped version and is rejected.
+ *
+ */
+struct jimagepack_header_t {
+  char magic[4];
+  uint32_t version;
+  uint64_t count;
+  uint64_t duration; // microseconds
+};
+
+struct jimagepack_entry_t {
+  uint64_t offset; // from the beginning of the file
+  uint64_t size;
+  uint64_t start; // microseconds
+};
+
+}
+
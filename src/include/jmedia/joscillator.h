@@ -0,0 +1,165 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jeff Ferr                                       *
+ *   root@sat                                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace jmedia {
+
+/**
+ * \brief
+ *
+ */
+enum class jwaveform_t {
+  Sine,
+  Triangle,
+  Sawtooth,
+  Square,
+  Noise,
+  Silence,
+  Custom
+};
+
+/**
+ * \brief Generates a waveform in blocks of samples from a phase accumulator. The sine and the
+ * triangle are read from wavetables limited to the harmonics below the nyquist frequency, the
+ * sawtooth and the square have their steps smoothed by polyBLEP, so none of them aliases as the
+ * naive waves do. A custom function is evaluated once per sample, as the slow path.
+ *
+ * \author Jeff Ferr
+ */
+class Oscillator {
+
+  private:
+    /** \brief */
+    double (* _function)(double);
+    /** \brief */
+    const float *_table;
+    /** \brief */
+    jwaveform_t _waveform;
+    /** \brief */
+    double _sample_rate;
+    /** \brief */
+    double _frequency;
+    /** \brief position in the cycle, from 0 to 1 */
+    double _phase;
+    /** \brief cycles per sample */
+    double _increment;
+    /** \brief states of the noise generators */
+    uint32_t _seeds[4];
+    /** \brief generator of the next noise sample */
+    uint32_t _seed_index;
+
+  private:
+    /**
+     * \brief Selects the wavetable with the harmonics that the frequency allows.
+     *
+     */
+    void Update();
+
+    /**
+     * \brief
+     *
+     */
+    void RenderTable(float *samples, size_t count);
+
+    /**
+     * \brief
+     *
+     */
+    void RenderBlep(float *samples, size_t count);
+
+    /**
+     * \brief
+     *
+     */
+    void RenderNoise(float *samples, size_t count);
+
+    /**
+     * \brief
+     *
+     */
+    void RenderFunction(float *samples, size_t count);
+
+  public:
+    /**
+     * \brief
+     *
+     */
+    Oscillator(int sample_rate);
+
+    /**
+     * \brief
+     *
+     */
+    virtual ~Oscillator();
+
+    /**
+     * \brief
+     *
+     */
+    void SetWaveform(jwaveform_t waveform);
+
+    /**
+     * \brief
+     *
+     */
+    jwaveform_t GetWaveform();
+
+    /**
+     * \brief Generates the function, which receives the phase from -pi to pi, in place of the waveform.
+     *
+     */
+    void SetFunction(double (* function)(double));
+
+    /**
+     * \brief
+     *
+     */
+    void SetFrequency(double frequency);
+
+    /**
+     * \brief
+     *
+     */
+    double GetFrequency();
+
+    /**
+     * \brief
+     *
+     */
+    void SetPhase(double phase);
+
+    /**
+     * \brief
+     *
+     */
+    double GetPhase();
+
+    /**
+     * \brief Writes the next samples of the waveform, from -1 to 1.
+     *
+     */
+    void Render(float *samples, size_t count);
+
+};
+
+}
@@ -29,7 +29,9 @@ enum class jplayer_hints_t {
   Caching,
   Lightweight,
   Security,
-  Plugins
+  Plugins,
+  LowLatency,
+  Realtime
 };
 
 /**
@@ -0,0 +1,124 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jeff Ferr                                       *
+ *   root@sat                                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#pragma once
+
+#include "jmedia/jvolumecontrol.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+namespace jmedia {
+
+/**
+ * \brief Volume of a single stream, applied to its samples before they reach the device, so the
+ * players do not share the volume of the system. A change of the level ramps the gain through
+ * some frames to avoid the clicks of a step, the unity gain leaves the samples untouched and a
+ * muted stream is written as silence.
+ *
+ * \author Jeff Ferr
+ */
+class SoftwareVolumeControl : public VolumeControl {
+
+  private:
+    /** \brief */
+    std::atomic<int> _level;
+    /** \brief */
+    std::atomic<bool> _is_muted;
+    /** \brief gain of the last frame, owned by the thread that applies the volume */
+    float _gain;
+    /** \brief */
+    float _target;
+    /** \brief */
+    float _step;
+    /** \brief frames of the ramp */
+    size_t _ramp;
+    /** \brief frames left to reach the target */
+    size_t _remaining;
+    /** \brief the gain before the first samples is set without a ramp */
+    bool _is_started;
+
+  private:
+    /**
+     * \brief
+     *
+     */
+    template<typename T> void Process(T *samples, size_t frames, int channels);
+
+  public:
+    /**
+     * \brief
+     *
+     * \param ramp Frames that a change of the gain takes
+     */
+    SoftwareVolumeControl(size_t ramp = 0);
+
+    /**
+     * \brief
+     *
+     */
+    virtual ~SoftwareVolumeControl();
+
+    /**
+     * \brief
+     *
+     */
+    virtual int GetLevel();
+
+    /**
+     * \brief
+     *
+     */
+    virtual void SetLevel(int level);
+
+    /**
+     * \brief
+     *
+     */
+    virtual bool IsMute();
+
+    /**
+     * \brief
+     *
+     */
+    virtual void SetMute(bool b);
+
+    /**
+     * \brief Applies the volume to interleaved samples in place. It is called by a single thread,
+     * the one that writes the stream.
+     *
+     */
+    void Apply(int16_t *samples, size_t frames, int channels);
+
+    /**
+     * \brief
+     *
+     */
+    void Apply(int32_t *samples, size_t frames, int channels);
+
+    /**
+     * \brief
+     *
+     */
+    void Apply(float *samples, size_t frames, int channels);
+
+};
+
+}
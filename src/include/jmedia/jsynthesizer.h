@@ -19,7 +19,15 @@
  ***************************************************************************/
 #pragma once
 
+#include "jmedia/jsoftwarevolumecontrol.h"
+#include "jmedia/jaudiolatency.h"
+#include "jmedia/joscillator.h"
+#include "jmedia/jeventqueue.h"
+
 #include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
 
 #include <alsa/asoundlib.h>
 
@@ -32,8 +40,104 @@ double sine_wave(double s);
 double noise_wave(double s) ;
 double silence_wave(double s);
 
+/**
+ * \brief Level of a note along the time. The attack, the decay and the release are in seconds,
+ * the sustain is the level from 0 to 1 held until the note is released.
+ *
+ */
+struct jenvelope_t {
+  double attack = 0.005;
+  double decay = 0.0;
+  double sustain = 1.0;
+  double release = 0.02;
+};
+
+/**
+ * \brief Note of an offline rendering. The start and the duration are in frames from the start
+ * of the rendering, so the notes are placed to the sample.
+ *
+ */
+struct jnote_t {
+  uint64_t start = 0;
+  uint64_t duration = 0;
+  int channel = -1;
+  double frequency = 0.0;
+  double level = 1.0;
+};
+
+/**
+ * \brief Plays notes on a set of voices mixed by a thread of its own. The notes are queued
+ * without locks and the calls return at once, the thread applies them at the next period and
+ * sleeps while no voice sounds.
+ *
+ */
 class Synthesizer {
 
+  private:
+    enum class Stage {
+      Idle,
+      Attack,
+      Decay,
+      Sustain,
+      Release
+    };
+
+    struct Event {
+      /* \brief */
+      uint32_t note = 0;
+      /* \brief true to start the note, false to release it */
+      bool start = false;
+      /* \brief output channel, or -1 for all of them */
+      int channel = -1;
+      /* \brief */
+      double frequency = 0.0;
+      /* \brief */
+      double level = 1.0;
+      /* \brief frames until the release, or 0 to hold the note until it is released */
+      uint64_t duration = 0;
+      /* \brief */
+      jwaveform_t waveform = jwaveform_t::Sine;
+      /* \brief */
+      double (* function)(double) = nullptr;
+      /* \brief */
+      jenvelope_t envelope;
+    };
+
+    struct Voice {
+      /* \brief keeps its phase from one note to the next */
+      Oscillator oscillator;
+      /* \brief */
+      Stage stage;
+      /* \brief */
+      uint32_t note;
+      /* \brief */
+      int channel;
+      /* \brief */
+      float level;
+      /* \brief level of the envelope */
+      float gain;
+      /* \brief */
+      float attack;
+      /* \brief */
+      float decay;
+      /* \brief */
+      float sustain;
+      /* \brief frames of the release */
+      float release;
+      /* \brief decrement of the gain during the release */
+      float fall;
+      /* \brief frames until the release */
+      uint64_t remaining;
+      /* \brief order of the notes, the oldest voice is taken when all of them sound */
+      uint64_t age;
+
+      Voice(int sample_rate):
+        oscillator(sample_rate), stage(Stage::Idle), note(0), channel(-1), level(0.0f), gain(0.0f), 
+        attack(0.0f), decay(0.0f), sustain(0.0f), release(0.0f), fall(0.0f), remaining(0), age(0)
+      {
+      }
+    };
+
   private:
     /* \brief playback device */
     std::string _device_name;
@@ -41,8 +145,6 @@ class Synthesizer {
     snd_pcm_format_t _format;
     /* \brief stream rate */
     uint32_t _sample_rate;
-    /* \brief ring buffer length in us */
-    uint32_t _buffer_time;
     /* \brief count of channels */
     int _channels;
     /* \brief */
@@ -56,45 +158,132 @@ class Synthesizer {
     /* \brief waveform of sound */
     double (* _function)(double);
     /* \brief */
-    double _volume;
+    jwaveform_t _waveform;
+    /* \brief */
+    jenvelope_t _envelope;
+    /* \brief */
+    SoftwareVolumeControl _volume;
+    /* \brief */
+    jaudio_latency_t _latency;
+    /* \brief */
+    std::vector<struct pollfd> _descriptors;
+    /* \brief notes waiting for the render thread */
+    EventQueue<Event> _events;
+    /* \brief incremented by each event, the render thread waits on it while idle */
+    std::atomic<uint32_t> _pending;
+    /* \brief */
+    std::atomic<uint32_t> _serial;
+    /* \brief owned by the render thread */
+    std::vector<Voice> _voices;
+    /* \brief one period of a voice */
+    std::vector<float> _block;
+    /* \brief one period of the voices mixed */
+    std::vector<float> _mix;
+    /* \brief one period of samples */
+    std::vector<int16_t> _samples;
+    /* \brief */
+    uint64_t _age;
+    /* \brief */
+    std::atomic<uint64_t> _underruns;
+    /* \brief frames queued in the device after the last write */
+    std::atomic<snd_pcm_sframes_t> _delay;
+    /* \brief */
+    std::thread _thread;
+    /* \brief */
+    std::atomic<bool> _is_running;
 
   private:
     /**
      * \brief
      *
      */
-    void GenerateSamples(int16_t *samples, int channel, double frequency, int count, double *_phase); 
+    int SetAudioParameters(snd_pcm_t *handle, snd_pcm_hw_params_t *params, snd_pcm_access_t access);
 
     /**
      * \brief
      *
      */
-    int SetAudioParameters(snd_pcm_t *handle, snd_pcm_hw_params_t *params, snd_pcm_access_t access);
+    int SetAudioParameters(snd_pcm_t *handle, snd_pcm_sw_params_t *swparams);
 
     /**
      * \brief
      *
      */
-    int SetAudioParameters(snd_pcm_t *handle, snd_pcm_sw_params_t *swparams);
+    int Underflow(snd_pcm_t *handle, int err);
+
+    /**
+     * \brief Waits until the device accepts a period. It returns 1 when the device is ready, 0 when
+     * the wait timed out, and the error of the device otherwise.
+     *
+     */
+    int Wait(snd_pcm_t *handle);
 
     /**
      * \brief
      *
      */
-    int Underflow(snd_pcm_t *handle, int err);
+    int Write(const int16_t *samples, int frames);
+
+    /**
+     * \brief Queues the event and wakes up the render thread. It returns the note, or 0 when the queue is full.
+     *
+     */
+    uint32_t Post(Event &event);
 
     /**
      * \brief
      *
      */
-    int WriteSamples(snd_pcm_t *handle, int channel, double frequency, double periods, int16_t *samples);
+    void Apply(const Event &event);
+
+    /**
+     * \brief
+     *
+     */
+    void Release(Voice &voice);
+
+    /**
+     * \brief Adds the next frames of the voice to the mix.
+     *
+     */
+    void Render(Voice &voice, int frames);
+
+    /**
+     * \brief Allocates the voices and the buffers of a period, before the first note.
+     *
+     */
+    void Allocate();
+
+    /**
+     * \brief Mixes the voices in samples. It returns false, and leaves samples untouched, when no voice sounds.
+     *
+     */
+    bool Mix(int16_t *samples, int frames);
+
+    /**
+     * \brief Applies the events and mixes the voices in samples. It returns false when no voice sounds.
+     *
+     */
+    bool Process(int16_t *samples, int frames);
+
+    /**
+     * \brief
+     *
+     */
+    void Run();
 
   public:
     /**
      * \brief
      *
      */
-    Synthesizer(std::string device_name = std::string("default"), int channels = 1, int sample_rate = 8192);
+    Synthesizer(std::string device_name = std::string("default"), int channels = 1, int sample_rate = 8192, jaudio_latency_t latency = jaudio_latency_t());
+
+    /**
+     * \brief Opens no device, the notes are rendered with Render() as fast as the cpu allows.
+     *
+     */
+    Synthesizer(int channels, int sample_rate);
 
     /**
      * \brief
@@ -103,7 +292,8 @@ class Synthesizer {
     virtual ~Synthesizer();
 
     /**
-     * \brief
+     * \brief Selects the waveform of the next notes. The waves of this file are generated by the
+     * oscillator, any other function is evaluated once per sample.
      *
      */
     virtual void SetWave(double (* function)(double));
@@ -114,6 +304,18 @@ class Synthesizer {
      */
     virtual void *GetWave();
 
+    /**
+     * \brief Selects the envelope of the next notes.
+     *
+     */
+    virtual void SetEnvelope(jenvelope_t envelope);
+
+    /**
+     * \brief
+     *
+     */
+    virtual jenvelope_t GetEnvelope();
+
     /**
      * \brief
      *
@@ -126,16 +328,65 @@ class Synthesizer {
      */
     virtual int GetVolume();
 
+    /**
+     * \brief Returns the volume of the samples of the synthesizer, which does not change the volume of the system.
+     *
+     */
+    virtual VolumeControl * GetVolumeControl();
+
+    /**
+     * \brief Returns the times the device ran out of samples.
+     *
+     */
+    virtual uint64_t GetUnderruns();
+
+    /**
+     * \brief Returns the milliseconds between the write of a sample and its output, as measured by the device.
+     *
+     */
+    virtual uint64_t GetLatency();
+
+    /**
+     * \brief Starts a note that sounds until NoteOff().
+     *
+     * \param channel Individual channel, or -1 for all of them
+     * \param frequency Value of frequency
+     * \param level Level of the note, from 0 to 1
+     * \return The note, or 0 when too many events are waiting or no device is open
+     */
+    virtual uint32_t NoteOn(int channel, double frequency, double level = 1.0);
+
+    /**
+     * \brief Releases the note, which fades with the release of its envelope.
+     *
+     */
+    virtual void NoteOff(uint32_t note);
+
     /** 
-     * \brief Plays a beep in the selected channel.
+     * \brief Plays a beep in the selected channel. The call returns at once.
      *
-     * \param channel Individual channel
+     * \param channel Individual channel, or -1 for all of them
      * \param frequency Value of frequency
-     * \param duration Delay in milliseconds
+     * \param duration Duration in seconds
+     * \return The note, or 0 when too many events are waiting or no device is open
+     */
+    virtual uint32_t Play(int channel, double frequency, double duration);
+
+    /**
+     * \brief Renders the notes with the current wave, envelope and volume, until the release of
+     * the last note. The samples are interleaved and can be replayed by the audio mixer.
+     *
+     * \exception std::runtime_error when the synthesizer plays on a device
+     */
+    virtual std::vector<int16_t> Render(const std::vector<jnote_t> &notes);
+
+    /**
+     * \brief Renders the notes to a pcm wav file.
+     *
+     * \exception std::runtime_error when the synthesizer plays on a device or the file is not written
      */
-    virtual void Play(int channel, double frequency, double duration);
+    virtual void Render(const std::vector<jnote_t> &notes, std::string filename);
 
 };
 
 }
-
@@ -0,0 +1,102 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jeff Ferr                                       *
+ *   root@sat                                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#pragma once
+
+#include "jmedia/jcontrol.h"
+
+#include <cstdint>
+
+namespace jmedia {
+
+/**
+ * \brief Points of the pipeline where the latency of a frame is measured, always from the
+ * capture of the frame.
+ *
+ */
+enum class jlatency_stage_t {
+  Dequeue, // the frame is delivered by the device
+  Convert, // the frame is converted to the image of the component
+  Paint // the frame is drawn by the component
+};
+
+/**
+ * \brief Distribution of the latencies of a stage, in microseconds.
+ *
+ */
+struct jlatency_statistics_t {
+  uint64_t count;
+  uint64_t p50;
+  uint64_t p99;
+  uint64_t max;
+};
+
+/**
+ * \brief
+ *
+ * \author Jeff Ferr
+ */
+class VideoStatisticsControl : public Control {
+
+  public:
+    /**
+     * \brief
+     *
+     */
+    VideoStatisticsControl();
+
+    /**
+     * \brief Destrutor virtual.
+     *
+     */
+    virtual ~VideoStatisticsControl();
+
+    /**
+     * \brief Returns the latencies from the capture of the frames to the stage.
+     *
+     */
+    virtual jlatency_statistics_t GetLatency(jlatency_stage_t stage);
+
+    /**
+     * \brief Returns the frames delivered by the device.
+     *
+     */
+    virtual uint64_t GetCapturedFrames();
+
+    /**
+     * \brief Returns the frames lost by the device, from the gaps in the sequence of the frames.
+     *
+     */
+    virtual uint64_t GetDroppedFrames();
+
+    /**
+     * \brief Returns the frames delivered by the device and replaced before being painted.
+     *
+     */
+    virtual uint64_t GetSkippedFrames();
+
+    /**
+     * \brief
+     *
+     */
+    virtual void Reset();
+
+};
+
+}
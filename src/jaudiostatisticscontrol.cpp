@@ -0,0 +1,62 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jeff Ferr                                       *
+ *   root@sat                                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#include "jmedia/jaudiostatisticscontrol.h"
+
+namespace jmedia {
+
+AudioStatisticsControl::AudioStatisticsControl():
+  Control("audio.statistics")
+{
+}
+    
+AudioStatisticsControl::~AudioStatisticsControl()
+{
+}
+
+uint64_t AudioStatisticsControl::GetUnderruns()
+{
+  return 0;
+}
+
+uint64_t AudioStatisticsControl::GetBufferLevel()
+{
+  return 0;
+}
+
+uint64_t AudioStatisticsControl::GetMinimumBufferLevel()
+{
+  return 0;
+}
+
+uint64_t AudioStatisticsControl::GetBufferCapacity()
+{
+  return 0;
+}
+
+uint64_t AudioStatisticsControl::GetLatency()
+{
+  return 0;
+}
+
+void AudioStatisticsControl::Reset()
+{
+}
+
+}
@@ -25,6 +25,29 @@ FrameGrabberEvent::FrameGrabberEvent(std::shared_ptr<jcanvas::Image> frame, jfra
 {
   _frame = frame;
   _type = type;
+  _region = {0, 0, 0, 0};
+  _sequence = 0;
+  _timestamp = 0;
+
+  if (_frame != nullptr) {
+    _region.size = _frame->GetSize();
+  }
+}
+
+FrameGrabberEvent::FrameGrabberEvent(std::shared_ptr<jcanvas::Image> frame, jframeevent_type_t type, jcanvas::jrect_t<int> region)
+{
+  _frame = frame;
+  _type = type;
+  _region = region;
+  _sequence = 0;
+  _timestamp = 0;
+}
+
+FrameGrabberEvent::FrameGrabberEvent(std::shared_ptr<jcanvas::Image> frame, jframeevent_type_t type, uint64_t sequence, uint64_t timestamp):
+  FrameGrabberEvent(frame, type)
+{
+  _sequence = sequence;
+  _timestamp = timestamp;
 }
     
 FrameGrabberEvent::~FrameGrabberEvent()
@@ -36,6 +59,21 @@ std::shared_ptr<jcanvas::Image> FrameGrabberEvent::GetFrame()
   return _frame;
 }
 
+jcanvas::jrect_t<int> FrameGrabberEvent::GetRegion()
+{
+  return _region;
+}
+
+uint64_t FrameGrabberEvent::GetSequence()
+{
+  return _sequence;
+}
+
+uint64_t FrameGrabberEvent::GetTimestamp()
+{
+  return _timestamp;
+}
+
 jframeevent_type_t FrameGrabberEvent::GetType()
 {
   return _type;
@@ -0,0 +1,399 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jeff Ferr                                       *
+ *   root@sat                                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#include "jmedia/joscillator.h"
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define OSCILLATOR_TABLE_SIZE 2048
+#define OSCILLATOR_TABLE_LEVELS 11
+#define OSCILLATOR_SYNC_SAMPLES 64
+
+namespace jmedia {
+
+struct Wavetables {
+  /** \brief one cycle and the first samples again, so the interpolation never wraps */
+  std::vector<float> sine;
+  /** \brief the level k has the harmonics up to 2^k */
+  std::vector<float> triangle[OSCILLATOR_TABLE_LEVELS];
+};
+
+static const Wavetables & get_wavetables()
+{
+  static Wavetables tables = []() {
+    Wavetables tables;
+
+    tables.sine.resize(OSCILLATOR_TABLE_SIZE + 2);
+
+    for (int i=0; i<OSCILLATOR_TABLE_SIZE + 2; i++) {
+      tables.sine[i] = (float)sin(2*M_PI*i/OSCILLATOR_TABLE_SIZE);
+    }
+
+    for (int level=0; level<OSCILLATOR_TABLE_LEVELS; level++) {
+      std::vector<float> &table = tables.triangle[level];
+      int harmonics = 1 << level;
+
+      table.resize(OSCILLATOR_TABLE_SIZE + 2);
+
+      // the odd harmonics of the triangle fall with the square of their order
+      for (int i=0; i<OSCILLATOR_TABLE_SIZE + 2; i++) {
+        double sample = 0.0;
+
+        for (int n=1; n<=harmonics; n+=2) {
+          sample = sample + cos(2*M_PI*n*i/OSCILLATOR_TABLE_SIZE)/(n*n);
+        }
+
+        table[i] = (float)(-8.0/(M_PI*M_PI)*sample);
+      }
+    }
+
+    return tables;
+  }();
+
+  return tables;
+}
+
+static float poly_blep(float t, float dt)
+{
+  if (t < dt) {
+    float x = t/dt;
+
+    return x + x - x*x - 1.0f;
+  }
+
+  if (t > 1.0f - dt) {
+    float x = (t - 1.0f)/dt;
+
+    return x*x + x + x + 1.0f;
+  }
+
+  return 0.0f;
+}
+
+#if defined(__SSE2__)
+static __m128 fraction(__m128 x)
+{
+  // the phases are positive, so the truncation is the floor
+  return _mm_sub_ps(x, _mm_cvtepi32_ps(_mm_cvttps_epi32(x)));
+}
+
+static __m128 poly_blep(__m128 t, __m128 dt, __m128 inverse)
+{
+  __m128
+    one = _mm_set1_ps(1.0f),
+    x1 = _mm_mul_ps(t, inverse),
+    x2 = _mm_mul_ps(_mm_sub_ps(t, one), inverse),
+    b1 = _mm_sub_ps(_mm_sub_ps(_mm_add_ps(x1, x1), _mm_mul_ps(x1, x1)), one),
+    b2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x2, x2), _mm_add_ps(x2, x2)), one),
+    m1 = _mm_cmplt_ps(t, dt),
+    m2 = _mm_andnot_ps(m1, _mm_cmpgt_ps(t, _mm_sub_ps(one, dt)));
+
+  return _mm_or_ps(_mm_and_ps(m1, b1), _mm_and_ps(m2, b2));
+}
+#endif
+
+Oscillator::Oscillator(int sample_rate)
+{
+  _function = nullptr;
+  _table = nullptr;
+  _waveform = jwaveform_t::Sine;
+  _sample_rate = std::max(sample_rate, 1);
+  _frequency = 0.0;
+  _phase = 0.0;
+  _increment = 0.0;
+  _seeds[0] = 0x9e3779b9;
+  _seeds[1] = 0x7f4a7c15;
+  _seeds[2] = 0x85ebca6b;
+  _seeds[3] = 0xc2b2ae35;
+  _seed_index = 0;
+
+  Update();
+}
+
+Oscillator::~Oscillator()
+{
+}
+
+void Oscillator::Update()
+{
+  const Wavetables &tables = get_wavetables();
+
+  _increment = _frequency/_sample_rate;
+  _table = nullptr;
+
+  if (_waveform == jwaveform_t::Sine) {
+    _table = tables.sine.data();
+  } else if (_waveform == jwaveform_t::Triangle) {
+    int level = OSCILLATOR_TABLE_LEVELS - 1;
+
+    if (_frequency > 0.0) {
+      level = std::clamp((int)floor(log2(0.5*_sample_rate/_frequency)), 0, OSCILLATOR_TABLE_LEVELS - 1);
+    }
+
+    _table = tables.triangle[level].data();
+  }
+}
+
+void Oscillator::SetWaveform(jwaveform_t waveform)
+{
+  if (waveform == jwaveform_t::Custom and _function == nullptr) {
+    waveform = jwaveform_t::Silence;
+  }
+
+  _waveform = waveform;
+
+  Update();
+}
+
+jwaveform_t Oscillator::GetWaveform()
+{
+  return _waveform;
+}
+
+void Oscillator::SetFunction(double (* function)(double))
+{
+  _function = function;
+
+  SetWaveform(jwaveform_t::Custom);
+}
+
+void Oscillator::SetFrequency(double frequency)
+{
+  _frequency = std::clamp(frequency, 0.0, 0.5*_sample_rate);
+
+  Update();
+}
+
+double Oscillator::GetFrequency()
+{
+  return _frequency;
+}
+
+void Oscillator::SetPhase(double phase)
+{
+  _phase = phase - floor(phase);
+}
+
+double Oscillator::GetPhase()
+{
+  return _phase;
+}
+
+void Oscillator::RenderTable(float *samples, size_t count)
+{
+  const float *table = _table;
+  size_t i = 0;
+
+#if defined(__SSE2__)
+  float dt = (float)_increment;
+  __m128
+    lanes = _mm_set_ps(3*dt, 2*dt, dt, 0.0f),
+    t = lanes,
+    step = _mm_set1_ps(4*dt),
+    size = _mm_set1_ps((float)OSCILLATOR_TABLE_SIZE);
+  alignas(16) int32_t indexes[4];
+
+  for (; i + 4 <= count; i += 4) {
+    // the lanes accumulate in floats, so they are taken again from the exact phase from time to time
+    if (i % OSCILLATOR_SYNC_SAMPLES == 0) {
+      double phase = _phase + i*_increment;
+
+      t = fraction(_mm_add_ps(_mm_set1_ps((float)(phase - (int64_t)phase)), lanes));
+    }
+
+    __m128 position = _mm_mul_ps(t, size);
+    __m128i index = _mm_cvttps_epi32(position);
+    __m128 weight = _mm_sub_ps(position, _mm_cvtepi32_ps(index));
+
+    _mm_store_si128((__m128i *)indexes, index);
+
+    __m128
+      a = _mm_set_ps(table[indexes[3]], table[indexes[2]], table[indexes[1]], table[indexes[0]]),
+      b = _mm_set_ps(table[indexes[3] + 1], table[indexes[2] + 1], table[indexes[1] + 1], table[indexes[0] + 1]);
+
+    _mm_storeu_ps(samples + i, _mm_add_ps(a, _mm_mul_ps(weight, _mm_sub_ps(b, a))));
+
+    t = fraction(_mm_add_ps(t, step));
+  }
+
+  _phase = _phase + i*_increment;
+  _phase = _phase - floor(_phase);
+#endif
+
+  for (; i<count; i++) {
+    double position = _phase*OSCILLATOR_TABLE_SIZE;
+    int index = (int)position;
+    float fraction = (float)(position - index);
+
+    samples[i] = table[index] + fraction*(table[index + 1] - table[index]);
+
+    _phase = _phase + _increment;
+
+    if (_phase >= 1.0) {
+      _phase = _phase - 1.0;
+    }
+  }
+}
+
+void Oscillator::RenderBlep(float *samples, size_t count)
+{
+  bool square = (_waveform == jwaveform_t::Square);
+  float dt = std::max((float)_increment, 1e-9f);
+  size_t i = 0;
+
+#if defined(__SSE2__)
+  __m128
+    lanes = _mm_set_ps(3*dt, 2*dt, dt, 0.0f),
+    t = lanes,
+    block = _mm_set1_ps(4*dt),
+    step = _mm_set1_ps(dt),
+    inverse = _mm_set1_ps(1.0f/dt),
+    half = _mm_set1_ps(0.5f),
+    one = _mm_set1_ps(1.0f),
+    two = _mm_set1_ps(2.0f);
+
+  for (; i + 4 <= count; i += 4) {
+    __m128 sample;
+
+    if (i % OSCILLATOR_SYNC_SAMPLES == 0) {
+      double phase = _phase + i*_increment;
+
+      t = fraction(_mm_add_ps(_mm_set1_ps((float)(phase - (int64_t)phase)), lanes));
+    }
+
+    if (square == true) {
+      // +1 in the first half of the cycle and -1 in the second, with a step at each half
+      sample = _mm_sub_ps(_mm_and_ps(_mm_cmplt_ps(t, half), two), one);
+      sample = _mm_add_ps(sample, poly_blep(t, step, inverse));
+      sample = _mm_sub_ps(sample, poly_blep(fraction(_mm_add_ps(t, half)), step, inverse));
+    } else {
+      sample = _mm_sub_ps(_mm_sub_ps(_mm_mul_ps(t, two), one), poly_blep(t, step, inverse));
+    }
+
+    _mm_storeu_ps(samples + i, sample);
+
+    t = fraction(_mm_add_ps(t, block));
+  }
+
+  _phase = _phase + i*_increment;
+  _phase = _phase - floor(_phase);
+#endif
+
+  for (; i<count; i++) {
+    float t = (float)_phase;
+
+    if (square == true) {
+      float t2 = t + 0.5f;
+
+      if (t2 >= 1.0f) {
+        t2 = t2 - 1.0f;
+      }
+
+      samples[i] = ((t < 0.5f)?1.0f:-1.0f) + poly_blep(t, dt) - poly_blep(t2, dt);
+    } else {
+      samples[i] = 2.0f*t - 1.0f - poly_blep(t, dt);
+    }
+
+    _phase = _phase + _increment;
+
+    if (_phase >= 1.0) {
+      _phase = _phase - 1.0;
+    }
+  }
+}
+
+static float next_noise(uint32_t *seed)
+{
+  *seed = *seed ^ (*seed << 13);
+  *seed = *seed ^ (*seed >> 17);
+  *seed = *seed ^ (*seed << 5);
+
+  return (int32_t)*seed/2147483648.0f;
+}
+
+void Oscillator::RenderNoise(float *samples, size_t count)
+{
+  size_t i = 0;
+
+  // the generators take turns, so the sequence does not depend on the size of the blocks
+  for (; i<count and _seed_index != 0; i++) {
+    samples[i] = next_noise(&_seeds[_seed_index]);
+
+    _seed_index = (_seed_index + 1) % 4;
+  }
+
+#if defined(__SSE2__)
+  __m128i seeds = _mm_loadu_si128((const __m128i *)_seeds);
+  __m128 scale = _mm_set1_ps(1.0f/2147483648.0f);
+
+  // four xorshift generators side by side
+  for (; i + 4 <= count; i += 4) {
+    seeds = _mm_xor_si128(seeds, _mm_slli_epi32(seeds, 13));
+    seeds = _mm_xor_si128(seeds, _mm_srli_epi32(seeds, 17));
+    seeds = _mm_xor_si128(seeds, _mm_slli_epi32(seeds, 5));
+
+    _mm_storeu_ps(samples + i, _mm_mul_ps(_mm_cvtepi32_ps(seeds), scale));
+  }
+
+  _mm_storeu_si128((__m128i *)_seeds, seeds);
+#endif
+
+  for (; i<count; i++) {
+    samples[i] = next_noise(&_seeds[_seed_index]);
+
+    _seed_index = (_seed_index + 1) % 4;
+  }
+}
+
+void Oscillator::RenderFunction(float *samples, size_t count)
+{
+  for (size_t i=0; i<count; i++) {
+    samples[i] = (float)_function(2*M_PI*_phase - M_PI);
+
+    _phase = _phase + _increment;
+
+    if (_phase >= 1.0) {
+      _phase = _phase - 1.0;
+    }
+  }
+}
+
+void Oscillator::Render(float *samples, size_t count)
+{
+  if (_waveform == jwaveform_t::Sine or _waveform == jwaveform_t::Triangle) {
+    RenderTable(samples, count);
+  } else if (_waveform == jwaveform_t::Sawtooth or _waveform == jwaveform_t::Square) {
+    RenderBlep(samples, count);
+  } else if (_waveform == jwaveform_t::Noise) {
+    RenderNoise(samples, count);
+  } else if (_waveform == jwaveform_t::Custom) {
+    RenderFunction(samples, count);
+  } else {
+    memset(samples, 0, count*sizeof(float));
+  }
+}
+
+}
@@ -21,6 +21,9 @@
 
 #include "jdemux/jurl.h"
 
+#define PLAYER_LOW_LATENCY_PERIOD 256
+#define PLAYER_LOW_LATENCY_PERIODS 3
+
 #if defined(LIBVLC_MEDIA)
 #include "providers/libvlc/bind.h"
 #endif
@@ -72,6 +75,8 @@ Player * PlayerManager::CreatePlayer(std::string uri)
     _hints[jplayer_hints_t::Lightweight] = true;
     _hints[jplayer_hints_t::Security] = false;
     _hints[jplayer_hints_t::Plugins] = false;
+    _hints[jplayer_hints_t::LowLatency] = false;
+    _hints[jplayer_hints_t::Realtime] = false;
   }
 
   jdemux::Url url{uri};
@@ -88,7 +93,19 @@ Player * PlayerManager::CreatePlayer(std::string uri)
 
 #if defined(ALSA_MEDIA)
   try {
-    return new AlsaLightPlayer(uri);
+    jaudio_latency_t latency;
+
+    // a few milliseconds of samples queued in the device, the writer wakes up once per period
+    if (GetHint(jplayer_hints_t::LowLatency) == true) {
+      latency.period_size = PLAYER_LOW_LATENCY_PERIOD;
+      latency.buffer_size = PLAYER_LOW_LATENCY_PERIOD*PLAYER_LOW_LATENCY_PERIODS;
+      latency.start_threshold = PLAYER_LOW_LATENCY_PERIOD*(PLAYER_LOW_LATENCY_PERIODS - 1);
+      latency.avail_min = PLAYER_LOW_LATENCY_PERIOD;
+    }
+
+    latency.realtime = GetHint(jplayer_hints_t::Realtime);
+
+    return new AlsaLightPlayer(uri, latency);
   } catch (std::runtime_error &e) {
   }
 #endif
@@ -0,0 +1,228 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Jeff Ferr                                       *
+ *   root@sat                                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#include "jmedia/jsoftwarevolumecontrol.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace jmedia {
+
+static int16_t scale_sample(int16_t sample, float gain)
+{
+  return (int16_t)std::clamp(lrintf(sample*gain), -32768L, 32767L);
+}
+
+static int32_t scale_sample(int32_t sample, float gain)
+{
+  return (int32_t)std::clamp(llrint((double)sample*gain), -2147483648LL, 2147483647LL);
+}
+
+static float scale_sample(float sample, float gain)
+{
+  return sample*gain;
+}
+
+static void scale_samples(int16_t *samples, size_t count, float gain)
+{
+  int16_t q15 = (int16_t)std::min(lrintf(gain*32768.0f), 32767L);
+  size_t i = 0;
+
+#if defined(__SSE2__)
+  __m128i g = _mm_set1_epi16(q15);
+
+  for (; i + 8 <= count; i += 8) {
+    __m128i s = _mm_loadu_si128((const __m128i *)(samples + i));
+
+    // (s*gain) >> 15 rebuilt from the high and low halves of the products
+    _mm_storeu_si128((__m128i *)(samples + i), _mm_or_si128(_mm_slli_epi16(_mm_mulhi_epi16(s, g), 1), _mm_srli_epi16(_mm_mullo_epi16(s, g), 15)));
+  }
+#elif defined(__ARM_NEON)
+  int16x8_t g = vdupq_n_s16(q15);
+
+  for (; i + 8 <= count; i += 8) {
+    vst1q_s16(samples + i, vqrdmulhq_s16(vld1q_s16(samples + i), g));
+  }
+#endif
+
+  for (; i<count; i++) {
+    samples[i] = (int16_t)((samples[i]*q15) >> 15);
+  }
+}
+
+static void scale_samples(int32_t *samples, size_t count, float gain)
+{
+  size_t i = 0;
+
+#if defined(__SSE2__)
+  __m128 
+    g = _mm_set1_ps(gain),
+    // the largest float below 2^31, the conversion of a larger one wraps to the lowest sample
+    limit = _mm_set1_ps(2147483520.0f);
+
+  for (; i + 4 <= count; i += 4) {
+    __m128 s = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(samples + i))), g);
+
+    _mm_storeu_si128((__m128i *)(samples + i), _mm_cvtps_epi32(_mm_min_ps(s, limit)));
+  }
+#elif defined(__ARM_NEON)
+  float32x4_t g = vdupq_n_f32(gain);
+
+  for (; i + 4 <= count; i += 4) {
+    // the conversion of neon saturates
+    vst1q_s32(samples + i, vcvtq_s32_f32(vmulq_f32(vcvtq_f32_s32(vld1q_s32(samples + i)), g)));
+  }
+#endif
+
+  for (; i<count; i++) {
+    samples[i] = scale_sample(samples[i], gain);
+  }
+}
+
+static void scale_samples(float *samples, size_t count, float gain)
+{
+  size_t i = 0;
+
+#if defined(__SSE2__)
+  __m128 g = _mm_set1_ps(gain);
+
+  for (; i + 4 <= count; i += 4) {
+    _mm_storeu_ps(samples + i, _mm_mul_ps(_mm_loadu_ps(samples + i), g));
+  }
+#elif defined(__ARM_NEON)
+  float32x4_t g = vdupq_n_f32(gain);
+
+  for (; i + 4 <= count; i += 4) {
+    vst1q_f32(samples + i, vmulq_f32(vld1q_f32(samples + i), g));
+  }
+#endif
+
+  for (; i<count; i++) {
+    samples[i] = samples[i]*gain;
+  }
+}
+
+SoftwareVolumeControl::SoftwareVolumeControl(size_t ramp):
+  VolumeControl()
+{
+  _level = 100;
+  _is_muted = false;
+  _gain = 1.0f;
+  _target = 1.0f;
+  _step = 0.0f;
+  _ramp = ramp;
+  _remaining = 0;
+  _is_started = false;
+}
+
+SoftwareVolumeControl::~SoftwareVolumeControl()
+{
+}
+
+int SoftwareVolumeControl::GetLevel()
+{
+  return _level;
+}
+
+void SoftwareVolumeControl::SetLevel(int level)
+{
+  _level = std::clamp(level, 0, 100);
+}
+
+bool SoftwareVolumeControl::IsMute()
+{
+  return _is_muted;
+}
+
+void SoftwareVolumeControl::SetMute(bool b)
+{
+  _is_muted = b;
+}
+
+template<typename T> void SoftwareVolumeControl::Process(T *samples, size_t frames, int channels)
+{
+  float target = 0.0f;
+
+  if (_is_muted == false) {
+    float level = _level/100.0f;
+
+    // the loudness follows the cube of the gain closer than the gain itself
+    target = level*level*level;
+  }
+
+  if (target != _target) {
+    _target = target;
+
+    if (_ramp == 0 or _is_started == false) {
+      _gain = target;
+      _remaining = 0;
+    } else {
+      _step = (target - _gain)/_ramp;
+      _remaining = _ramp;
+    }
+  }
+
+  _is_started = true;
+
+  for (; frames > 0 and _remaining > 0; frames--, _remaining--) {
+    _gain = (_remaining == 1)?_target:(_gain + _step);
+
+    for (int i=0; i<channels; i++) {
+      samples[i] = scale_sample(samples[i], _gain);
+    }
+
+    samples = samples + channels;
+  }
+
+  if (frames == 0 or _gain == 1.0f) {
+    return;
+  }
+
+  if (_gain == 0.0f) {
+    memset(samples, 0, frames*channels*sizeof(T));
+
+    return;
+  }
+
+  scale_samples(samples, frames*channels, _gain);
+}
+
+void SoftwareVolumeControl::Apply(int16_t *samples, size_t frames, int channels)
+{
+  Process(samples, frames, channels);
+}
+
+void SoftwareVolumeControl::Apply(int32_t *samples, size_t frames, int channels)
+{
+  Process(samples, frames, channels);
+}
+
+void SoftwareVolumeControl::Apply(float *samples, size_t frames, int channels)
+{
+  Process(samples, frames, channels);
+}
+
+}
@@ -21,8 +21,21 @@
 
 #include <thread>
 #include <stdexcept>
+#include <algorithm>
+#include <fstream>
 
 #include <math.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#define SYNTHESIZER_RAMP 10
+#define SYNTHESIZER_WAIT 1000
+#define SYNTHESIZER_PRIORITY 50
+#define SYNTHESIZER_VOICES 16
+#define SYNTHESIZER_EVENTS 256
+#define SYNTHESIZER_BLOCK 256
+#define SYNTHESIZER_PERIODS 4
 
 namespace jmedia {
 
@@ -66,7 +79,9 @@ double silence_wave(double)
   return 0;
 }
 
-Synthesizer::Synthesizer(std::string device_name, int channels, int sample_rate)
+Synthesizer::Synthesizer(std::string device_name, int channels, int sample_rate, jaudio_latency_t latency):
+  _volume(sample_rate*SYNTHESIZER_RAMP/1000),
+  _events(SYNTHESIZER_EVENTS)
 {
   if (channels < 0) {
     throw std::runtime_error("Invalid number of channels");
@@ -79,13 +94,18 @@ Synthesizer::Synthesizer(std::string device_name, int channels, int sample_rate)
   _device_name = device_name; // "default", "plughw:0,0";
   _output = nullptr;
   _function = square_wave;
+  _waveform = jwaveform_t::Square;
   _format = SND_PCM_FORMAT_S16;
   _sample_rate = sample_rate;
   _channels = channels;
-  _buffer_time = 1000;
-  _buffer_size = 1000;
-  _period_size = 1000;
-  _volume = 1.0;
+  _buffer_size = SYNTHESIZER_BLOCK*SYNTHESIZER_PERIODS;
+  _period_size = SYNTHESIZER_BLOCK;
+  _latency = latency;
+  _pending = 0;
+  _serial = 0;
+  _age = 0;
+  _underruns = 0;
+  _delay = 0;
 
   snd_pcm_hw_params_alloca(&hwparams);
   snd_pcm_sw_params_alloca(&swparams);
@@ -94,7 +114,8 @@ Synthesizer::Synthesizer(std::string device_name, int channels, int sample_rate)
     throw std::runtime_error("Output failed");
   }
 
-  if ((err = snd_pcm_open(&_handle, _device_name.c_str(), SND_PCM_STREAM_PLAYBACK, 0)) < 0) {
+  // the writes wait for the device in poll() instead of blocking in the driver
+  if ((err = snd_pcm_open(&_handle, _device_name.c_str(), SND_PCM_STREAM_PLAYBACK, SND_PCM_NONBLOCK)) < 0) {
     throw std::runtime_error("Playback open error");
   }
 
@@ -106,41 +127,95 @@ Synthesizer::Synthesizer(std::string device_name, int channels, int sample_rate)
     throw std::runtime_error("Setting of swparams failed");
   }
 
+  int count = snd_pcm_poll_descriptors_count(_handle);
+
+  if (count <= 0) {
+    throw std::runtime_error("Poll descriptors failed");
+  }
+
+  _descriptors.resize(count);
+
+  snd_pcm_poll_descriptors(_handle, _descriptors.data(), count);
+
+  Allocate();
+
+  if (_latency.realtime == true) {
+    mlock(_block.data(), _block.size()*sizeof(float));
+    mlock(_mix.data(), _mix.size()*sizeof(float));
+    mlock(_samples.data(), _samples.size()*sizeof(int16_t));
+  }
+
+  _is_running = true;
+
+  _thread = std::thread(&Synthesizer::Run, this);
+
   // printf("Playback device is %s, Stream parameters are %iHz, %s, %i channels\n", _device_name.c_str(), _sample_rate, snd_pcm_format_name(_format), _channels);
 }
 
-Synthesizer::~Synthesizer()
+Synthesizer::Synthesizer(int channels, int sample_rate):
+  _volume(sample_rate*SYNTHESIZER_RAMP/1000),
+  _events(SYNTHESIZER_EVENTS)
 {
-  snd_pcm_drain(_handle);
-  snd_pcm_close(_handle);
+  if (channels <= 0 or sample_rate <= 0) {
+    throw std::runtime_error("Invalid audio parameters");
+  }
+
+  _device_name = "";
+  _output = nullptr;
+  _handle = nullptr;
+  _function = square_wave;
+  _waveform = jwaveform_t::Square;
+  _format = SND_PCM_FORMAT_S16;
+  _sample_rate = sample_rate;
+  _channels = channels;
+  _buffer_size = SYNTHESIZER_BLOCK;
+  _period_size = SYNTHESIZER_BLOCK;
+  _pending = 0;
+  _serial = 0;
+  _age = 0;
+  _underruns = 0;
+  _delay = 0;
+  _is_running = false;
+
+  Allocate();
 }
 
-void Synthesizer::GenerateSamples(int16_t *samples, int channel, double frequency, int count, double *_phase) 
+Synthesizer::~Synthesizer()
 {
-  double phase = *_phase;
-  double max_phase = 1.0 / frequency;
-  double step = 1.0 / (double)_sample_rate;
-  int ires;
+  if (_handle == nullptr) {
+    return;
+  }
 
-  while (count-- > 0) {
-    double res = _function((phase * 2 * M_PI) / max_phase - M_PI) * 32767 * _volume;
+  _is_running = false;
+  _pending.fetch_add(1);
+  _pending.notify_one();
 
-    ires = res;
+  _thread.join();
 
-    for (int i=0; i<_channels; i++) {
-      if (i == channel) {
-        *samples++ = ires;
-      } else {
-        *samples++ = 0;
-      }
-    }
+  // the drain of a nonblocking device does not wait for the last samples
+  snd_pcm_nonblock(_handle, 0);
+  snd_pcm_drain(_handle);
+  snd_pcm_close(_handle);
+
+  if (_latency.realtime == true) {
+    munlock(_block.data(), _block.size()*sizeof(float));
+    munlock(_mix.data(), _mix.size()*sizeof(float));
+    munlock(_samples.data(), _samples.size()*sizeof(int16_t));
+  }
+}
+
+void Synthesizer::Allocate()
+{
+  // nothing is allocated by the render thread
+  _voices.reserve(SYNTHESIZER_VOICES);
 
-    phase += step;
-    if (phase >= max_phase)
-      phase -= max_phase;
+  for (int i=0; i<SYNTHESIZER_VOICES; i++) {
+    _voices.emplace_back(_sample_rate);
   }
 
-  *_phase = phase;
+  _block.resize(_period_size);
+  _mix.resize(_period_size*_channels);
+  _samples.resize(_period_size*_channels);
 }
 
 int Synthesizer::SetAudioParameters(snd_pcm_t *handle, snd_pcm_hw_params_t *params, snd_pcm_access_t access)
@@ -151,7 +226,6 @@ int Synthesizer::SetAudioParameters(snd_pcm_t *handle, snd_pcm_hw_params_t *para
   snd_pcm_uframes_t period_size_max;
   snd_pcm_uframes_t buffer_size_min;
   snd_pcm_uframes_t buffer_size_max;
-  snd_pcm_uframes_t buffer_time_to_size;
 
   /* choose all parameters */
   err = snd_pcm_hw_params_any(handle, params);
@@ -197,8 +271,7 @@ int Synthesizer::SetAudioParameters(snd_pcm_t *handle, snd_pcm_hw_params_t *para
 
   // printf("Rate set to %iHz (requested %iHz)\n", sample_rate, _sample_rate);
 
-  /* set the buffer time */
-  buffer_time_to_size = ( (snd_pcm_uframes_t)_buffer_time * _sample_rate) / 1000000;
+  /* set the buffer and period sizes */
   err = snd_pcm_hw_params_get_buffer_size_min(params, &buffer_size_min);
   err = snd_pcm_hw_params_get_buffer_size_max(params, &buffer_size_max);
   dir=0;
@@ -208,9 +281,23 @@ int Synthesizer::SetAudioParameters(snd_pcm_t *handle, snd_pcm_hw_params_t *para
 
   // printf("Buffer size range from %lu to %lu\n",buffer_size_min, buffer_size_max);
   // printf("Period size range from %lu to %lu\n",period_size_min, period_size_max);
-  // printf("Buffer time size %lu\n",buffer_time_to_size);
 
-  _buffer_size = buffer_time_to_size;
+  // the buffer holds SYNTHESIZER_PERIODS periods unless both sizes were requested
+  if (_latency.period_size > 0) {
+    _period_size = _latency.period_size;
+  } else if (_latency.buffer_size > 0) {
+    _period_size = _latency.buffer_size/SYNTHESIZER_PERIODS;
+  } else {
+    _period_size = SYNTHESIZER_BLOCK;
+  }
+
+  _period_size = std::clamp(_period_size, period_size_min, std::max(period_size_min, period_size_max));
+
+  if (_latency.buffer_size > 0) {
+    _buffer_size = _latency.buffer_size;
+  } else {
+    _buffer_size = _period_size*SYNTHESIZER_PERIODS;
+  }
 
   if (buffer_size_max < _buffer_size) {
     _buffer_size = buffer_size_max;
@@ -220,8 +307,9 @@ int Synthesizer::SetAudioParameters(snd_pcm_t *handle, snd_pcm_hw_params_t *para
     _buffer_size = buffer_size_min;
   }
 
-  _period_size = _buffer_size/8;
-  _buffer_size = _period_size*8;
+  if (_period_size > _buffer_size/2) {
+    _period_size = _buffer_size/2;
+  }
 
   // printf("To choose buffer_size = %lu\n", _buffer_size);
   // printf("To choose period_size = %lu\n", _period_size);
@@ -282,7 +370,7 @@ int Synthesizer::SetAudioParameters(snd_pcm_t *handle, snd_pcm_sw_params_t *swpa
   }
 
   /* start the transfer when a period is full */
-  err = snd_pcm_sw_params_set_start_threshold(handle, swparams, _period_size);
+  err = snd_pcm_sw_params_set_start_threshold(handle, swparams, (_latency.start_threshold > 0)?_latency.start_threshold:_period_size);
   if (err < 0) {
     // printf("Unable to set start threshold mode for playback: %s\n", snd_strerror(err));
 
@@ -290,7 +378,7 @@ int Synthesizer::SetAudioParameters(snd_pcm_t *handle, snd_pcm_sw_params_t *swpa
   }
 
   /* allow the transfer when at least period_size samples can be processed */
-  err = snd_pcm_sw_params_set_avail_min(handle, swparams, _period_size);
+  err = snd_pcm_sw_params_set_avail_min(handle, swparams, (_latency.avail_min > 0)?_latency.avail_min:_period_size);
   if (err < 0) {
     // printf("Unable to set avail min for playback: %s\n", snd_strerror(err));
 
@@ -311,6 +399,8 @@ int Synthesizer::SetAudioParameters(snd_pcm_t *handle, snd_pcm_sw_params_t *swpa
 int Synthesizer::Underflow(snd_pcm_t *handle, int err) 
 {
   if (err == -EPIPE) {  /* under-run */
+    _underruns = _underruns + 1;
+
     err = snd_pcm_prepare(handle);
     if (err < 0) {
       // printf("Can't recovery from underrun, prepare failed: %s\n", snd_strerror(err));
@@ -336,44 +426,317 @@ int Synthesizer::Underflow(snd_pcm_t *handle, int err)
   return err;
 }
 
-int Synthesizer::WriteSamples(snd_pcm_t *handle, int channel, double frequency, double periods, int16_t *samples)
+int Synthesizer::Wait(snd_pcm_t *handle)
 {
-  double phase = 0;
-  int16_t *ptr;
-  int err, cptr, n;
+  int err = poll(_descriptors.data(), _descriptors.size(), SYNTHESIZER_WAIT);
+
+  if (err < 0) {
+    return (errno == EINTR)?0:-errno;
+  }
+
+  unsigned short revents = 0;
 
-  for(n = 0; n < (int)periods; n++) {
-    GenerateSamples(samples, channel, frequency, _period_size, &phase);
-    ptr = samples;
-    cptr = _period_size;
+  if ((err = snd_pcm_poll_descriptors_revents(handle, _descriptors.data(), _descriptors.size(), &revents)) < 0) {
+    return err;
+  }
 
-    while (cptr > 0) {
-      err = snd_pcm_writei(handle, ptr, cptr);
+  // the device left the running state, as after an underrun
+  if ((revents & POLLERR) != 0) {
+    snd_pcm_state_t state = snd_pcm_state(handle);
 
-      if (err == -EAGAIN)
-        continue;
+    if (state == SND_PCM_STATE_XRUN) {
+      return -EPIPE;
+    } else if (state == SND_PCM_STATE_SUSPENDED) {
+      return -ESTRPIPE;
+    }
 
-      if (err < 0) {
-        if (Underflow(handle, err) < 0) {
-          // printf("Write error: %s\n", snd_strerror(err));
+    return -EIO;
+  }
+
+  return ((revents & POLLOUT) != 0)?1:0;
+}
 
-          return -1;
-        }
+int Synthesizer::Write(const int16_t *samples, int frames)
+{
+  const int16_t *ptr = samples;
+  int err, cptr = frames;
+
+  while (cptr > 0) {
+    err = snd_pcm_writei(_handle, ptr, cptr);
+
+    // the device is full, the writer sleeps until a period is free
+    if (err == -EAGAIN and (err = Wait(_handle)) >= 0) {
+      continue;
+    }
 
-        break;  /* skip one period */
+    if (err < 0) {
+      if (Underflow(_handle, err) < 0) {
+        // printf("Write error: %s\n", snd_strerror(err));
+
+        return -1;
       }
 
-      ptr += (err * _channels);
-      cptr -= err;
+      break;  /* skip one period */
     }
+
+    ptr += (err * _channels);
+    cptr -= err;
+  }
+
+  snd_pcm_sframes_t delay;
+
+  if (snd_pcm_delay(_handle, &delay) == 0) {
+    _delay = delay;
   }
 
   return 0;
 }
 
+uint32_t Synthesizer::Post(Event &event)
+{
+  // nothing would ever take the event
+  if (_handle == nullptr) {
+    return 0;
+  }
+
+  if (event.start == true) {
+    do {
+      event.note = _serial.fetch_add(1) + 1;
+    } while (event.note == 0);
+  }
+
+  if (_events.Push(event) == false) {
+    return 0;
+  }
+
+  _pending.fetch_add(1);
+  _pending.notify_one();
+
+  return event.note;
+}
+
+void Synthesizer::Release(Voice &voice)
+{
+  if (voice.stage == Stage::Idle or voice.stage == Stage::Release) {
+    return;
+  }
+
+  voice.stage = (voice.gain > 0.0f)?Stage::Release:Stage::Idle;
+  voice.fall = voice.gain/voice.release;
+  voice.remaining = 0;
+}
+
+void Synthesizer::Apply(const Event &event)
+{
+  if (event.start == false) {
+    for (Voice &voice : _voices) {
+      if (voice.stage != Stage::Idle and voice.note == event.note) {
+        Release(voice);
+      }
+    }
+
+    return;
+  }
+
+  Voice *voice = nullptr;
+
+  // a free voice, or else the quietest voice in release, or else the oldest note
+  for (Voice &candidate : _voices) {
+    if (candidate.stage == Stage::Idle) {
+      voice = &candidate;
+
+      break;
+    }
+
+    if (voice == nullptr) {
+      voice = &candidate;
+    } else if (candidate.stage == Stage::Release) {
+      if (voice->stage != Stage::Release or candidate.gain < voice->gain) {
+        voice = &candidate;
+      }
+    } else if (voice->stage != Stage::Release and candidate.age < voice->age) {
+      voice = &candidate;
+    }
+  }
+
+  const jenvelope_t &envelope = event.envelope;
+  float rate = (float)_sample_rate;
+
+  if (event.waveform == jwaveform_t::Custom) {
+    voice->oscillator.SetFunction(event.function);
+  } else {
+    voice->oscillator.SetWaveform(event.waveform);
+  }
+
+  voice->oscillator.SetFrequency(event.frequency);
+
+  // a voice taken from another note starts from its current level, without a click
+  if (voice->stage == Stage::Idle) {
+    voice->gain = 0.0f;
+  }
+
+  voice->stage = Stage::Attack;
+  voice->note = event.note;
+  voice->channel = (event.channel < _channels)?event.channel:-1;
+  voice->level = (float)std::clamp(event.level, 0.0, 1.0);
+  voice->sustain = (float)std::clamp(envelope.sustain, 0.0, 1.0);
+  voice->attack = (envelope.attack > 0.0)?1.0f/(float)(envelope.attack*rate):1.0f;
+  voice->decay = (envelope.decay > 0.0)?(1.0f - voice->sustain)/(float)(envelope.decay*rate):1.0f;
+  voice->release = std::max(1.0f, (float)(envelope.release*rate));
+  voice->fall = 0.0f;
+  voice->remaining = event.duration;
+  voice->age = _age++;
+}
+
+void Synthesizer::Render(Voice &voice, int frames)
+{
+  float *block = _block.data();
+  float *mix = _mix.data();
+
+  voice.oscillator.Render(block, frames);
+
+  for (int i=0; i<frames; i++) {
+    if (voice.remaining > 0 and --voice.remaining == 0) {
+      Release(voice);
+    }
+
+    if (voice.stage == Stage::Attack) {
+      voice.gain = voice.gain + voice.attack;
+
+      if (voice.gain >= 1.0f) {
+        voice.gain = 1.0f;
+        voice.stage = Stage::Decay;
+      }
+    } else if (voice.stage == Stage::Decay) {
+      voice.gain = voice.gain - voice.decay;
+
+      if (voice.gain <= voice.sustain) {
+        voice.gain = voice.sustain;
+        voice.stage = (voice.sustain > 0.0f)?Stage::Sustain:Stage::Idle;
+      }
+    } else if (voice.stage == Stage::Release) {
+      voice.gain = voice.gain - voice.fall;
+
+      if (voice.gain <= 0.0f) {
+        voice.gain = 0.0f;
+        voice.stage = Stage::Idle;
+      }
+    }
+
+    if (voice.stage == Stage::Idle) {
+      break;
+    }
+
+    float sample = block[i]*voice.gain*voice.level;
+
+    if (voice.channel < 0) {
+      for (int j=0; j<_channels; j++) {
+        mix[i*_channels + j] += sample;
+      }
+    } else {
+      mix[i*_channels + voice.channel] += sample;
+    }
+  }
+}
+
+bool Synthesizer::Mix(int16_t *samples, int frames)
+{
+  bool active = false;
+
+  std::fill(_mix.begin(), _mix.begin() + frames*_channels, 0.0f);
+
+  for (Voice &voice : _voices) {
+    if (voice.stage != Stage::Idle) {
+      Render(voice, frames);
+
+      active = true;
+    }
+  }
+
+  if (active == false) {
+    return false;
+  }
+
+  _volume.Apply(_mix.data(), frames, _channels);
+
+  for (int i=0; i<frames*_channels; i++) {
+    samples[i] = (int16_t)(std::clamp(_mix[i], -1.0f, 1.0f)*32767.0f);
+  }
+
+  return true;
+}
+
+bool Synthesizer::Process(int16_t *samples, int frames)
+{
+  Event event;
+
+  while (_events.Pop(event) == true) {
+    Apply(event);
+  }
+
+  return Mix(samples, frames);
+}
+
+void Synthesizer::Run()
+{
+  if (_latency.realtime == true) {
+    struct sched_param param;
+
+    param.sched_priority = SYNTHESIZER_PRIORITY;
+
+    pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+  }
+
+  bool playing = false;
+
+  while (_is_running == true) {
+    uint32_t pending = _pending.load();
+
+    if (Process(_samples.data(), _period_size) == true) {
+      if (Write(_samples.data(), _period_size) < 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(_period_size*1000000LL/_sample_rate));
+      }
+
+      playing = true;
+
+      continue;
+    }
+
+    // the last samples are played out and the thread sleeps until the next event
+    if (playing == true) {
+      snd_pcm_nonblock(_handle, 0);
+      snd_pcm_drain(_handle);
+      snd_pcm_nonblock(_handle, 1);
+      snd_pcm_prepare(_handle);
+
+      _delay = 0;
+
+      playing = false;
+    }
+
+    _pending.wait(pending);
+  }
+}
+
 void Synthesizer::SetWave(double (* function)(double))
 {
   _function = function;
+
+  if (function == sine_wave) {
+    _waveform = jwaveform_t::Sine;
+  } else if (function == triangle_wave) {
+    _waveform = jwaveform_t::Triangle;
+  } else if (function == sawtooth_wave) {
+    _waveform = jwaveform_t::Sawtooth;
+  } else if (function == square_wave) {
+    _waveform = jwaveform_t::Square;
+  } else if (function == noise_wave) {
+    _waveform = jwaveform_t::Noise;
+  } else if (function == silence_wave) {
+    _waveform = jwaveform_t::Silence;
+  } else {
+    _waveform = jwaveform_t::Custom;
+  }
 }
 
 void * Synthesizer::GetWave()
@@ -381,37 +744,192 @@ void * Synthesizer::GetWave()
   return (void *)_function;
 }
 
-void Synthesizer::SetVolume(int volume)
+void Synthesizer::SetEnvelope(jenvelope_t envelope)
 {
-  if (volume < 0) {
-    volume = 0;
-  }
+  _envelope = envelope;
+}
 
-  if (volume > 100) {
-    volume = 100;
-  }
+jenvelope_t Synthesizer::GetEnvelope()
+{
+  return _envelope;
+}
 
-  _volume = volume/100.0;
+void Synthesizer::SetVolume(int volume)
+{
+  _volume.SetLevel(volume);
 }
 
 int Synthesizer::GetVolume()
 {
-  return (int)(_volume * 100.0);
+  return _volume.GetLevel();
 }
 
-void Synthesizer::Play(int channel, double frequency, double duration)
+VolumeControl * Synthesizer::GetVolumeControl()
 {
-  int16_t *samples;
+  return &_volume;
+}
 
-  samples = (short int *)malloc((_period_size*_channels*snd_pcm_format_width(_format))/8);
+uint64_t Synthesizer::GetUnderruns()
+{
+  return _underruns;
+}
 
-  if (samples == nullptr) {
-    return;
+uint64_t Synthesizer::GetLatency()
+{
+  return (uint64_t)_delay*1000/_sample_rate;
+}
+
+uint32_t Synthesizer::NoteOn(int channel, double frequency, double level)
+{
+  Event event;
+
+  event.start = true;
+  event.channel = channel;
+  event.frequency = frequency;
+  event.level = level;
+  event.waveform = _waveform;
+  event.function = _function;
+  event.envelope = _envelope;
+
+  return Post(event);
+}
+
+void Synthesizer::NoteOff(uint32_t note)
+{
+  Event event;
+
+  event.start = false;
+  event.note = note;
+
+  Post(event);
+}
+
+uint32_t Synthesizer::Play(int channel, double frequency, double duration)
+{
+  Event event;
+
+  event.start = true;
+  event.channel = channel;
+  event.frequency = frequency;
+  event.waveform = _waveform;
+  event.function = _function;
+  event.envelope = _envelope;
+  event.duration = std::max<uint64_t>(1, (uint64_t)(duration*_sample_rate));
+
+  return Post(event);
+}
+
+std::vector<int16_t> Synthesizer::Render(const std::vector<jnote_t> &notes)
+{
+  if (_handle != nullptr) {
+    throw std::runtime_error("Rendering needs a synthesizer without device");
   }
 
-  WriteSamples(_handle, channel, frequency, duration*_sample_rate/(double)_period_size, samples);
+  std::vector<Event> events;
+
+  events.reserve(notes.size());
+
+  for (const jnote_t &note : notes) {
+    Event event;
 
-  free(samples);
+    event.note = events.size() + 1;
+    event.start = true;
+    event.channel = note.channel;
+    event.frequency = note.frequency;
+    event.level = note.level;
+    event.waveform = _waveform;
+    event.function = _function;
+    event.envelope = _envelope;
+    event.duration = std::max<uint64_t>(1, note.duration);
+    
+    events.push_back(event);
+  }
+
+  std::stable_sort(events.begin(), events.end(), 
+    [&notes](const Event &a, const Event &b) {
+      return notes[a.note - 1].start < notes[b.note - 1].start;
+    });
+
+  std::vector<int16_t> samples;
+  uint64_t frame = 0;
+  uint64_t end = 0;
+  size_t next = 0;
+
+  // the same notes render the same samples
+  for (Voice &voice : _voices) {
+    voice.oscillator.SetPhase(0.0);
+    voice.stage = Stage::Idle;
+    voice.gain = 0.0f;
+    voice.age = 0;
+  }
+
+  _age = 0;
+
+  // the periods are split at the start of each note
+  while (true) {
+    while (next < events.size() and notes[events[next].note - 1].start <= frame) {
+      Apply(events[next++]);
+    }
+
+    uint64_t frames = _period_size;
+
+    if (next < events.size()) {
+      frames = std::min<uint64_t>(frames, notes[events[next].note - 1].start - frame);
+    }
+
+    samples.resize((frame + frames)*_channels);
+
+    if (Mix(samples.data() + frame*_channels, frames) == true) {
+      end = frame + frames;
+    } else if (next == events.size()) {
+      break;
+    }
+
+    frame = frame + frames;
+  }
+
+  samples.resize(end*_channels);
+
+  return samples;
+}
+
+static void WriteLE(std::vector<uint8_t> &data, uint32_t word, int size)
+{
+  for (int i=0; i<size; i++) {
+    data.push_back((word >> (8*i)) & 0xff);
+  }
+}
+
+void Synthesizer::Render(const std::vector<jnote_t> &notes, std::string filename)
+{
+  std::vector<int16_t> samples = Render(notes);
+  std::vector<uint8_t> data;
+  uint32_t size = samples.size()*sizeof(int16_t);
+
+  data.reserve(44 + size);
+
+  data.insert(data.end(), {'R', 'I', 'F', 'F'});
+  WriteLE(data, 36 + size, 4);
+  data.insert(data.end(), {'W', 'A', 'V', 'E', 'f', 'm', 't', ' '});
+  WriteLE(data, 16, 4);
+  WriteLE(data, 1, 2); // pcm
+  WriteLE(data, _channels, 2);
+  WriteLE(data, _sample_rate, 4);
+  WriteLE(data, _sample_rate*_channels*sizeof(int16_t), 4);
+  WriteLE(data, _channels*sizeof(int16_t), 2);
+  WriteLE(data, 16, 2);
+  data.insert(data.end(), {'d', 'a', 't', 'a'});
+  WriteLE(data, size, 4);
+
+  for (int16_t sample : samples) {
+    WriteLE(data, (uint16_t)sample, 2);
+  }
+
+  std::ofstream stream(filename, std::ios::binary);
+
+  if (stream.write((const char *)data.data(), data.size()).good() == false) {
+    throw std::runtime_error("Unable to write the wav file");
+  }
 }
 
 }
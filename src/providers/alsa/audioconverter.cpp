@@ -0,0 +1,588 @@
+#include "audioconverter.h"
+
+#include <algorithm>
+#include <numeric>
+#include <cstring>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define ALSA_CONVERTER_BLOCK 256
+#define ALSA_CONVERTER_PHASES 512
+#define ALSA_CONVERTER_ZEROS 16
+#define ALSA_CONVERTER_CUTOFF 0.95
+#define ALSA_CONVERTER_BETA 8.6
+#define ALSA_CONVERTER_LAYOUTS 8
+
+// -3 dB, so a channel shared by two speakers keeps its power
+#define ALSA_CONVERTER_HALF_POWER 0.7071f
+
+namespace jmedia {
+
+static int GetSampleSize(snd_pcm_format_t format)
+{
+	if (format == SND_PCM_FORMAT_U8) {
+		return 1;
+	} else if (format == SND_PCM_FORMAT_S16_LE) {
+		return 2;
+	} else if (format == SND_PCM_FORMAT_S24_3LE) {
+		return 3;
+	}
+
+	return 4;
+}
+
+static void DecodeS16(const int16_t *src, float *dst, size_t count)
+{
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	const __m128 scale = _mm_set1_ps(1.0f/32768.0f);
+
+	for (; i + 8 <= count; i += 8) {
+		__m128i
+			x = _mm_loadu_si128((const __m128i *)(src + i)),
+			// each sample doubled in a 32 bits word and shifted back, so its sign is extended
+			lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16),
+			hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+
+		_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+		_mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+	}
+#endif
+
+	for (; i<count; i++) {
+		dst[i] = src[i]*(1.0f/32768.0f);
+	}
+}
+
+static void DecodeS32(const int32_t *src, float *dst, size_t count)
+{
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	const __m128 scale = _mm_set1_ps(1.0f/2147483648.0f);
+
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(src + i))), scale));
+	}
+#endif
+
+	for (; i<count; i++) {
+		dst[i] = src[i]*(1.0f/2147483648.0f);
+	}
+}
+
+static void EncodeS16(const float *src, int16_t *dst, size_t count)
+{
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	const __m128
+		scale = _mm_set1_ps(32768.0f),
+		low = _mm_set1_ps(-1.0f),
+		high = _mm_set1_ps(1.0f);
+
+	// the samples scale by the same power of two they were read with, and the pack saturates +1.0
+	for (; i + 8 <= count; i += 8) {
+		__m128
+			a = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), low), high),
+			b = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + 4), low), high);
+
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_packs_epi32(_mm_cvtps_epi32(_mm_mul_ps(a, scale)), _mm_cvtps_epi32(_mm_mul_ps(b, scale))));
+	}
+#endif
+
+	for (; i<count; i++) {
+		dst[i] = (int16_t)std::clamp(lrintf(src[i]*32768.0f), -32768L, 32767L);
+	}
+}
+
+static void EncodeS32(const float *src, int32_t *dst, size_t count)
+{
+	// the largest float under 1.0, as 1.0*2^31 does not fit in the samples
+	const float limit = 0.99999994f;
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	const __m128
+		scale = _mm_set1_ps(2147483648.0f),
+		low = _mm_set1_ps(-1.0f),
+		high = _mm_set1_ps(limit);
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 x = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), low), high);
+
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_cvtps_epi32(_mm_mul_ps(x, scale)));
+	}
+#endif
+
+	for (; i<count; i++) {
+		dst[i] = (int32_t)lrintf(std::clamp(src[i], -1.0f, limit)*2147483648.0f);
+	}
+}
+
+static void Decode(snd_pcm_format_t format, const uint8_t *src, float *dst, size_t count)
+{
+	if (format == SND_PCM_FORMAT_S16_LE) {
+		DecodeS16((const int16_t *)src, dst, count);
+	} else if (format == SND_PCM_FORMAT_S32_LE) {
+		DecodeS32((const int32_t *)src, dst, count);
+	} else if (format == SND_PCM_FORMAT_FLOAT_LE) {
+		memcpy(dst, src, count*sizeof(float));
+	} else if (format == SND_PCM_FORMAT_S24_3LE) {
+		for (size_t i=0; i<count; i++) {
+			int32_t sample = (int32_t)((uint32_t)src[3*i] << 8 | (uint32_t)src[3*i + 1] << 16 | (uint32_t)src[3*i + 2] << 24) >> 8;
+
+			dst[i] = sample*(1.0f/8388608.0f);
+		}
+	} else if (format == SND_PCM_FORMAT_U8) {
+		for (size_t i=0; i<count; i++) {
+			dst[i] = (src[i] - 128)*(1.0f/128.0f);
+		}
+	}
+}
+
+static void Encode(snd_pcm_format_t format, const float *src, uint8_t *dst, size_t count)
+{
+	if (format == SND_PCM_FORMAT_S16_LE) {
+		EncodeS16(src, (int16_t *)dst, count);
+	} else if (format == SND_PCM_FORMAT_S32_LE) {
+		EncodeS32(src, (int32_t *)dst, count);
+	} else if (format == SND_PCM_FORMAT_FLOAT_LE) {
+		memcpy(dst, src, count*sizeof(float));
+	} else if (format == SND_PCM_FORMAT_S24_3LE) {
+		for (size_t i=0; i<count; i++) {
+			int32_t sample = (int32_t)std::clamp(lrintf(std::clamp(src[i], -1.0f, 1.0f)*8388608.0f), -8388608L, 8388607L);
+
+			dst[3*i + 0] = sample & 0xff;
+			dst[3*i + 1] = (sample >> 8) & 0xff;
+			dst[3*i + 2] = (sample >> 16) & 0xff;
+		}
+	} else if (format == SND_PCM_FORMAT_U8) {
+		for (size_t i=0; i<count; i++) {
+			dst[i] = (uint8_t)std::clamp(lrintf(std::clamp(src[i], -1.0f, 1.0f)*128.0f) + 128L, 0L, 255L);
+		}
+	}
+}
+
+static float Dot(const float *x, const float *h, int count)
+{
+	int i = 0;
+	float sum = 0.0f;
+
+#if defined(__SSE2__)
+	__m128 acc = _mm_setzero_ps();
+
+	for (; i + 4 <= count; i += 4) {
+		acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(h + i)));
+	}
+
+	acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+	acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 0x55));
+
+	sum = _mm_cvtss_f32(acc);
+#endif
+
+	for (; i<count; i++) {
+		sum = sum + x[i]*h[i];
+	}
+
+	return sum;
+}
+
+enum Speaker {
+	SPEAKER_NONE,
+	SPEAKER_FL,
+	SPEAKER_FR,
+	SPEAKER_FC,
+	SPEAKER_LFE,
+	SPEAKER_RL,
+	SPEAKER_RR,
+	SPEAKER_RC,
+	SPEAKER_SL,
+	SPEAKER_SR
+};
+
+// the order of the channels in wav files and in the decoders
+static const Speaker MEDIA_LAYOUTS[ALSA_CONVERTER_LAYOUTS][ALSA_CONVERTER_LAYOUTS] = {
+	{SPEAKER_FC},
+	{SPEAKER_FL, SPEAKER_FR},
+	{SPEAKER_FL, SPEAKER_FR, SPEAKER_FC},
+	{SPEAKER_FL, SPEAKER_FR, SPEAKER_RL, SPEAKER_RR},
+	{SPEAKER_FL, SPEAKER_FR, SPEAKER_FC, SPEAKER_RL, SPEAKER_RR},
+	{SPEAKER_FL, SPEAKER_FR, SPEAKER_FC, SPEAKER_LFE, SPEAKER_RL, SPEAKER_RR},
+	{SPEAKER_FL, SPEAKER_FR, SPEAKER_FC, SPEAKER_LFE, SPEAKER_RC, SPEAKER_SL, SPEAKER_SR},
+	{SPEAKER_FL, SPEAKER_FR, SPEAKER_FC, SPEAKER_LFE, SPEAKER_RL, SPEAKER_RR, SPEAKER_SL, SPEAKER_SR}
+};
+
+// the order of the channels in the default maps of alsa
+static const Speaker DEVICE_LAYOUTS[ALSA_CONVERTER_LAYOUTS][ALSA_CONVERTER_LAYOUTS] = {
+	{SPEAKER_FC},
+	{SPEAKER_FL, SPEAKER_FR},
+	{SPEAKER_FL, SPEAKER_FR, SPEAKER_LFE},
+	{SPEAKER_FL, SPEAKER_FR, SPEAKER_RL, SPEAKER_RR},
+	{SPEAKER_FL, SPEAKER_FR, SPEAKER_RL, SPEAKER_RR, SPEAKER_FC},
+	{SPEAKER_FL, SPEAKER_FR, SPEAKER_RL, SPEAKER_RR, SPEAKER_FC, SPEAKER_LFE},
+	{SPEAKER_FL, SPEAKER_FR, SPEAKER_RL, SPEAKER_RR, SPEAKER_FC, SPEAKER_LFE, SPEAKER_RC},
+	{SPEAKER_FL, SPEAKER_FR, SPEAKER_RL, SPEAKER_RR, SPEAKER_FC, SPEAKER_LFE, SPEAKER_SL, SPEAKER_SR}
+};
+
+static Speaker GetSpeaker(const Speaker layouts[][ALSA_CONVERTER_LAYOUTS], int channels, int channel)
+{
+	if (channels > ALSA_CONVERTER_LAYOUTS or channel >= ALSA_CONVERTER_LAYOUTS) {
+		return SPEAKER_NONE;
+	}
+
+	return layouts[channels - 1][channel];
+}
+
+static int FindSpeaker(int channels, Speaker speaker)
+{
+	for (int c=0; c<channels; c++) {
+		if (GetSpeaker(DEVICE_LAYOUTS, channels, c) == speaker) {
+			return c;
+		}
+	}
+
+	return -1;
+}
+
+// adds the gain of a speaker to the channels of the device, or to the nearest speakers that the device has
+static void RouteSpeaker(Speaker speaker, float gain, float *column, int channels, int stride, int depth = 0)
+{
+	int channel = FindSpeaker(channels, speaker);
+
+	if (channel >= 0) {
+		column[channel*stride] = column[channel*stride] + gain;
+
+		return;
+	}
+
+	if (depth > 2) {
+		return;
+	}
+
+	if (speaker == SPEAKER_FL or speaker == SPEAKER_FR) {
+		RouteSpeaker(SPEAKER_FC, gain*ALSA_CONVERTER_HALF_POWER, column, channels, stride, depth + 1);
+	} else if (speaker == SPEAKER_FC) {
+		RouteSpeaker(SPEAKER_FL, gain*ALSA_CONVERTER_HALF_POWER, column, channels, stride, depth + 1);
+		RouteSpeaker(SPEAKER_FR, gain*ALSA_CONVERTER_HALF_POWER, column, channels, stride, depth + 1);
+	} else if (speaker == SPEAKER_RL or speaker == SPEAKER_SL) {
+		Speaker side = (speaker == SPEAKER_RL)?SPEAKER_SL:SPEAKER_RL;
+
+		if (FindSpeaker(channels, side) >= 0) {
+			RouteSpeaker(side, gain, column, channels, stride, depth + 1);
+		} else {
+			RouteSpeaker(SPEAKER_FL, gain*ALSA_CONVERTER_HALF_POWER, column, channels, stride, depth + 1);
+		}
+	} else if (speaker == SPEAKER_RR or speaker == SPEAKER_SR) {
+		Speaker side = (speaker == SPEAKER_RR)?SPEAKER_SR:SPEAKER_RR;
+
+		if (FindSpeaker(channels, side) >= 0) {
+			RouteSpeaker(side, gain, column, channels, stride, depth + 1);
+		} else {
+			RouteSpeaker(SPEAKER_FR, gain*ALSA_CONVERTER_HALF_POWER, column, channels, stride, depth + 1);
+		}
+	} else if (speaker == SPEAKER_RC) {
+		RouteSpeaker(SPEAKER_RL, gain*ALSA_CONVERTER_HALF_POWER, column, channels, stride, depth + 1);
+		RouteSpeaker(SPEAKER_RR, gain*ALSA_CONVERTER_HALF_POWER, column, channels, stride, depth + 1);
+	}
+
+	// the low frequencies are dropped by a device without a subwoofer
+}
+
+static double BesselI0(double x)
+{
+	double
+		sum = 1.0,
+		term = 1.0;
+
+	for (int k=1; k<32; k++) {
+		term = term*(x/(2*k))*(x/(2*k));
+		sum = sum + term;
+	}
+
+	return sum;
+}
+
+AudioConverter::AudioConverter(snd_pcm_format_t src_format, int src_channels, int src_rate, snd_pcm_format_t dst_format, int dst_channels, int dst_rate)
+{
+	_src_format = src_format;
+	_dst_format = dst_format;
+	_src_channels = src_channels;
+	_dst_channels = dst_channels;
+	_src_rate = src_rate;
+	_dst_rate = dst_rate;
+	_taps = 0;
+	_phases = 0;
+
+	_decoded.resize(ALSA_CONVERTER_BLOCK*src_channels);
+	_remixed.resize(ALSA_CONVERTER_BLOCK*dst_channels);
+
+	if (src_channels > 1 and (src_channels != dst_channels or src_channels > ALSA_CONVERTER_LAYOUTS)) {
+		_matrix.assign(dst_channels*src_channels, 0.0f);
+	} else if (src_channels > 1) {
+		// the same count of channels can still be in another order
+		for (int c=0; c<src_channels; c++) {
+			if (GetSpeaker(MEDIA_LAYOUTS, src_channels, c) != GetSpeaker(DEVICE_LAYOUTS, dst_channels, c)) {
+				_matrix.assign(dst_channels*src_channels, 0.0f);
+
+				break;
+			}
+		}
+	}
+
+	if (_matrix.empty() == false) {
+		for (int c=0; c<src_channels; c++) {
+			Speaker speaker = GetSpeaker(MEDIA_LAYOUTS, src_channels, c);
+
+			if (speaker != SPEAKER_NONE) {
+				RouteSpeaker(speaker, 1.0f, &_matrix[c], dst_channels, src_channels);
+			} else if (c < dst_channels) {
+				// a channel without a known speaker keeps its index
+				_matrix[c*src_channels + c] = 1.0f;
+			}
+		}
+
+		// a single speaker takes the mean of the channels, as the sum of all of them would clip
+		if (dst_channels == 1) {
+			float sum = std::accumulate(_matrix.begin(), _matrix.end(), 0.0f);
+
+			for (float &gain : _matrix) {
+				gain = (sum > 0.0f)?gain/sum:0.0f;
+			}
+		}
+	}
+
+	if (src_rate != dst_rate) {
+		// the cutoff follows the lowest of the rates, and the filter widens with it to keep its zeros
+		double cutoff = ALSA_CONVERTER_CUTOFF*std::min(1.0, (double)dst_rate/src_rate);
+		int phases = dst_rate/std::gcd(src_rate, dst_rate);
+
+		_phases = std::min(phases, ALSA_CONVERTER_PHASES);
+		_taps = 2*(int)std::ceil(ALSA_CONVERTER_ZEROS/cutoff);
+		_taps = (_taps + 3) & ~3;
+
+		_filters.resize(_phases*_taps);
+
+		for (int p=0; p<_phases; p++) {
+			float *filter = &_filters[p*_taps];
+			double sum = 0.0;
+
+			for (int k=0; k<_taps; k++) {
+				double
+					t = (k - (_taps/2 - 1)) - (double)p/_phases,
+					w = t/(_taps/2),
+					sinc = (t == 0.0)?1.0:std::sin(M_PI*cutoff*t)/(M_PI*cutoff*t),
+					window = (std::abs(w) >= 1.0)?0.0:BesselI0(ALSA_CONVERTER_BETA*std::sqrt(1.0 - w*w))/BesselI0(ALSA_CONVERTER_BETA);
+
+				filter[k] = (float)(sinc*window);
+
+				sum = sum + filter[k];
+			}
+
+			// each phase passes the dc unchanged, or the phases modulate the signal
+			for (int k=0; k<_taps; k++) {
+				filter[k] = (float)(filter[k]/sum);
+			}
+		}
+
+		_input.resize(dst_channels);
+	}
+
+	Reset();
+}
+
+AudioConverter::~AudioConverter()
+{
+}
+
+bool AudioConverter::IsSupported(snd_pcm_format_t format)
+{
+	return
+		format == SND_PCM_FORMAT_U8 or
+		format == SND_PCM_FORMAT_S16_LE or
+		format == SND_PCM_FORMAT_S24_3LE or
+		format == SND_PCM_FORMAT_S32_LE or
+		format == SND_PCM_FORMAT_FLOAT_LE;
+}
+
+void AudioConverter::Reset()
+{
+	for (auto &channel : _input) {
+		channel.assign(_taps/2 - 1, 0.0f);
+	}
+
+	_index = (_taps > 0)?(_taps/2 - 1):0;
+	_fraction = 0;
+	_is_flushed = false;
+}
+
+void AudioConverter::Load(const uint8_t *src, size_t frames)
+{
+	float
+		*in = _decoded.data(),
+		*out = _remixed.data();
+
+	if (src == nullptr) {
+		std::fill(out, out + frames*_dst_channels, 0.0f);
+
+		return;
+	}
+
+	if (_src_channels == 1 or _matrix.empty() == true) {
+		if (_src_channels == _dst_channels) {
+			Decode(_src_format, src, out, frames*_dst_channels);
+
+			return;
+		}
+
+		Decode(_src_format, src, in, frames);
+
+		for (size_t i=0; i<frames; i++, out += _dst_channels) {
+			std::fill(out, out + _dst_channels, in[i]);
+		}
+
+		return;
+	}
+
+	Decode(_src_format, src, in, frames*_src_channels);
+
+	for (size_t i=0; i<frames; i++, in += _src_channels, out += _dst_channels) {
+		for (int c=0; c<_dst_channels; c++) {
+			out[c] = Dot(in, &_matrix[c*_src_channels], _src_channels);
+		}
+	}
+}
+
+void AudioConverter::Store(uint8_t *dst, size_t frames)
+{
+	Encode(_dst_format, _remixed.data(), dst, frames*_dst_channels);
+}
+
+void AudioConverter::Append(size_t frames)
+{
+	for (int c=0; c<_dst_channels; c++) {
+		std::vector<float> &channel = _input[c];
+		size_t size = channel.size();
+
+		channel.resize(size + frames);
+
+		for (size_t i=0; i<frames; i++) {
+			channel[size + i] = _remixed[i*_dst_channels + c];
+		}
+	}
+}
+
+size_t AudioConverter::Convert(const uint8_t *src, size_t frames, size_t *consumed, uint8_t *dst, size_t capacity)
+{
+	size_t
+		src_frame = GetSampleSize(_src_format)*_src_channels,
+		dst_frame = GetSampleSize(_dst_format)*_dst_channels;
+
+	*consumed = 0;
+
+	if (_filters.empty() == true) {
+		if (src == nullptr) {
+			return 0;
+		}
+
+		size_t count = std::min(frames, capacity);
+
+		for (size_t i=0; i<count; i+=ALSA_CONVERTER_BLOCK) {
+			size_t block = std::min<size_t>(ALSA_CONVERTER_BLOCK, count - i);
+
+			Load(src + i*src_frame, block);
+			Store(dst + i*dst_frame, block);
+		}
+
+		*consumed = count;
+
+		return count;
+	}
+
+	size_t
+		produced = 0,
+		pending = 0;
+
+	while (produced + pending < capacity) {
+		size_t start = _index - (_taps/2 - 1);
+
+		if (start + _taps <= _input[0].size()) {
+			const float *filter = &_filters[(_fraction*_phases/_dst_rate)*_taps];
+
+			for (int c=0; c<_dst_channels; c++) {
+				_remixed[pending*_dst_channels + c] = Dot(&_input[c][start], filter, _taps);
+			}
+
+			pending = pending + 1;
+
+			if (pending == ALSA_CONVERTER_BLOCK) {
+				Store(dst + produced*dst_frame, pending);
+
+				produced = produced + pending;
+				pending = 0;
+			}
+
+			_fraction = _fraction + _src_rate;
+			_index = _index + _fraction/_dst_rate;
+			_fraction = _fraction % _dst_rate;
+
+			continue;
+		}
+
+		// _remixed is about to be loaded with input, so the outputs waiting in it are stored first
+		if (pending > 0) {
+			Store(dst + produced*dst_frame, pending);
+
+			produced = produced + pending;
+			pending = 0;
+		}
+
+		for (auto &channel : _input) {
+			channel.erase(channel.begin(), channel.begin() + start);
+		}
+
+		_index = _index - start;
+
+		size_t block;
+
+		if (src == nullptr) {
+			if (_is_flushed == true) {
+				break;
+			}
+
+			// the filter is fed with silence to release the last frames of the media
+			block = std::min(_taps, ALSA_CONVERTER_BLOCK);
+
+			Load(nullptr, block);
+
+			_is_flushed = true;
+		} else {
+			if (*consumed == frames) {
+				break;
+			}
+
+			block = std::min<size_t>(ALSA_CONVERTER_BLOCK, frames - *consumed);
+
+			Load(src + *consumed*src_frame, block);
+
+			*consumed = *consumed + block;
+		}
+
+		Append(block);
+	}
+
+	if (pending > 0) {
+		Store(dst + produced*dst_frame, pending);
+
+		produced = produced + pending;
+	}
+
+	return produced;
+}
+
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include <alsa/asoundlib.h>
+
+namespace jmedia {
+
+/**
+ * \brief Converts interleaved samples between the formats, channels and rates of a media and a
+ * device, so the device is opened with its own parameters and the plug layer of alsa has nothing
+ * to convert. The samples go through floats, remixed by the speakers of each channel when the
+ * layouts differ, and a polyphase windowed sinc filter changes the rate.
+ *
+ */
+class AudioConverter {
+
+	private:
+		/** \brief */
+		std::vector<float> _decoded;
+		/** \brief */
+		std::vector<float> _remixed;
+		/** \brief input of the resampler, one vector per channel */
+		std::vector<std::vector<float>> _input;
+		/** \brief one row per channel of the device with the gains of the channels of the media, empty when they match */
+		std::vector<float> _matrix;
+		/** \brief one filter per phase, with _taps coefficients each */
+		std::vector<float> _filters;
+		/** \brief */
+		snd_pcm_format_t _src_format;
+		/** \brief */
+		snd_pcm_format_t _dst_format;
+		/** \brief */
+		int _src_channels;
+		/** \brief */
+		int _dst_channels;
+		/** \brief */
+		int _src_rate;
+		/** \brief */
+		int _dst_rate;
+		/** \brief */
+		int _taps;
+		/** \brief */
+		int _phases;
+		/** \brief frame of the input where the next output is centered */
+		size_t _index;
+		/** \brief fraction of a frame past _index, in units of 1/_dst_rate */
+		uint64_t _fraction;
+		/** \brief */
+		bool _is_flushed;
+
+	private:
+		/**
+		 * \brief Converts the frames to floats with the channels of the device in _remixed.
+		 *
+		 */
+		void Load(const uint8_t *src, size_t frames);
+
+		/**
+		 * \brief Converts the floats in _remixed to the format of the device.
+		 *
+		 */
+		void Store(uint8_t *dst, size_t frames);
+
+		/**
+		 * \brief Appends the frames in _remixed to the input of the resampler.
+		 *
+		 */
+		void Append(size_t frames);
+
+	public:
+		/**
+		 * \brief
+		 *
+		 */
+		AudioConverter(snd_pcm_format_t src_format, int src_channels, int src_rate, snd_pcm_format_t dst_format, int dst_channels, int dst_rate);
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual ~AudioConverter();
+
+		/**
+		 * \brief Returns true for the formats that the converter reads and writes.
+		 *
+		 */
+		static bool IsSupported(snd_pcm_format_t format);
+
+		/**
+		 * \brief Discards the samples kept by the resampler, as after a seek.
+		 *
+		 */
+		void Reset();
+
+		/**
+		 * \brief Converts up to frames of src to up to capacity frames of dst. It returns the frames
+		 * written to dst and the frames read from src in consumed. The resampler holds back the frames
+		 * that its filter still needs, and a src of nullptr releases them at the end of the media.
+		 *
+		 */
+		size_t Convert(const uint8_t *src, size_t frames, size_t *consumed, uint8_t *dst, size_t capacity);
+
+};
+
+}
@@ -0,0 +1,578 @@
+#include "audiomixer.h"
+#include "wavefile.h"
+
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define ALSA_MIXER_DEVICE_NAME "default"
+#define ALSA_MIXER_RATE 48000
+#define ALSA_MIXER_CHANNELS 2
+#define ALSA_MIXER_LATENCY 6000
+#define ALSA_MIXER_VOICES 32
+#define ALSA_MIXER_IDLE 1000
+#define ALSA_MIXER_RAMP 10
+
+namespace jmedia {
+
+static int GetSampleSize(jaudio_format_t format)
+{
+	switch (format) {
+		case jaudio_format_t::S8:
+		case jaudio_format_t::U8:
+			return 1;
+		case jaudio_format_t::S16LSB:
+		case jaudio_format_t::S16MSB:
+		case jaudio_format_t::S16SYS:
+		case jaudio_format_t::S16:
+		case jaudio_format_t::U16LSB:
+		case jaudio_format_t::U16MSB:
+		case jaudio_format_t::U16SYS:
+		case jaudio_format_t::U16:
+			return 2;
+		default:
+			break;
+	}
+
+	return 4;
+}
+
+static uint32_t ReadWord(const uint8_t *data, int size, bool big)
+{
+	uint32_t word = 0;
+
+	for (int i=0; i<size; i++) {
+		word = word | (data[(big == true)?(size - 1 - i):i] << (8*i));
+	}
+
+	return word;
+}
+
+static float ReadSample(const uint8_t *data, jaudio_format_t format)
+{
+	bool native = __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__;
+
+	switch (format) {
+		case jaudio_format_t::S8:
+			return (int8_t)data[0]/128.0f;
+		case jaudio_format_t::U8:
+			return (data[0] - 128)/128.0f;
+		case jaudio_format_t::S16LSB:
+		case jaudio_format_t::S16:
+			return (int16_t)ReadWord(data, 2, false)/32768.0f;
+		case jaudio_format_t::S16MSB:
+			return (int16_t)ReadWord(data, 2, true)/32768.0f;
+		case jaudio_format_t::S16SYS:
+			return (int16_t)ReadWord(data, 2, native)/32768.0f;
+		case jaudio_format_t::U16LSB:
+		case jaudio_format_t::U16:
+			return ((int)ReadWord(data, 2, false) - 32768)/32768.0f;
+		case jaudio_format_t::U16MSB:
+			return ((int)ReadWord(data, 2, true) - 32768)/32768.0f;
+		case jaudio_format_t::U16SYS:
+			return ((int)ReadWord(data, 2, native) - 32768)/32768.0f;
+		case jaudio_format_t::S32LSB:
+		case jaudio_format_t::S32:
+			return (int32_t)ReadWord(data, 4, false)/2147483648.0f;
+		case jaudio_format_t::S32MSB:
+			return (int32_t)ReadWord(data, 4, true)/2147483648.0f;
+		case jaudio_format_t::S32SYS:
+			return (int32_t)ReadWord(data, 4, native)/2147483648.0f;
+		default:
+			break;
+	}
+
+	uint32_t word = ReadWord(data, 4, (format == jaudio_format_t::F32MSB) or (format == jaudio_format_t::F32SYS and native == true));
+	float sample;
+
+	memcpy(&sample, &word, sizeof(sample));
+
+	return sample;
+}
+
+static std::shared_ptr<AudioClip> DecodeClip(const uint8_t *data, size_t size, jaudio_format_t format, int frequency, int channels)
+{
+	if (data == nullptr or frequency <= 0 or channels <= 0) {
+		return nullptr;
+	}
+
+	int sample_size = GetSampleSize(format);
+	size_t frames = size/(sample_size*channels);
+
+	if (frames == 0) {
+		return nullptr;
+	}
+
+	// mono is spread to both sides and any channel after the second is discarded
+	std::vector<float> input(frames*ALSA_MIXER_CHANNELS);
+
+	for (size_t i=0; i<frames; i++) {
+		const uint8_t *frame = data + i*sample_size*channels;
+
+		for (int j=0; j<ALSA_MIXER_CHANNELS; j++) {
+			input[i*ALSA_MIXER_CHANNELS + j] = ReadSample(frame + std::min(j, channels - 1)*sample_size, format);
+		}
+	}
+
+	size_t count = (size_t)((uint64_t)frames*ALSA_MIXER_RATE/frequency);
+
+	if (count == 0) {
+		return nullptr;
+	}
+
+	std::shared_ptr<AudioClip> clip = std::make_shared<AudioClip>();
+
+	clip->samples.resize(count*ALSA_MIXER_CHANNELS);
+	clip->frames = count;
+	clip->volume = 1.0f;
+	clip->loop = false;
+
+	double step = (double)frequency/ALSA_MIXER_RATE;
+
+	for (size_t i=0; i<count; i++) {
+		double position = i*step;
+		size_t index = (size_t)position;
+		size_t next = std::min(index + 1, frames - 1);
+		float fraction = (float)(position - index);
+
+		for (int j=0; j<ALSA_MIXER_CHANNELS; j++) {
+			float
+				a = input[index*ALSA_MIXER_CHANNELS + j],
+				b = input[next*ALSA_MIXER_CHANNELS + j],
+				sample = std::clamp(a + (b - a)*fraction, -1.0f, 1.0f);
+
+			clip->samples[i*ALSA_MIXER_CHANNELS + j] = (int16_t)(sample*32767.0f);
+		}
+	}
+
+	return clip;
+}
+
+static void MixSamples(int16_t *dst, const int16_t *src, size_t count, int16_t gain)
+{
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	__m128i g = _mm_set1_epi16(gain);
+
+	for (; i + 8 <= count; i += 8) {
+		__m128i
+			s = _mm_loadu_si128((const __m128i *)(src + i)),
+			d = _mm_loadu_si128((const __m128i *)(dst + i));
+
+		if (gain != 32767) {
+			// (s*gain) >> 15 rebuilt from the high and low halves of the products
+			s = _mm_or_si128(_mm_slli_epi16(_mm_mulhi_epi16(s, g), 1), _mm_srli_epi16(_mm_mullo_epi16(s, g), 15));
+		}
+
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_adds_epi16(d, s));
+	}
+#elif defined(__ARM_NEON)
+	int16x8_t g = vdupq_n_s16(gain);
+
+	for (; i + 8 <= count; i += 8) {
+		int16x8_t
+			s = vld1q_s16(src + i),
+			d = vld1q_s16(dst + i);
+
+		if (gain != 32767) {
+			s = vqrdmulhq_s16(s, g);
+		}
+
+		vst1q_s16(dst + i, vqaddq_s16(d, s));
+	}
+#endif
+
+	for (; i<count; i++) {
+		int sample = (gain != 32767)?((src[i]*gain) >> 15):src[i];
+
+		dst[i] = (int16_t)std::clamp(dst[i] + sample, -32768, 32767);
+	}
+}
+
+AlsaAudio::AlsaAudio(std::shared_ptr<AudioClip> clip):
+	Audio()
+{
+	_clip = clip;
+}
+
+AlsaAudio::~AlsaAudio()
+{
+	// the voices still playing keep their own reference to the clip
+	AudioMixer::GetInstance()->Stop(_clip);
+}
+
+std::shared_ptr<AudioClip> AlsaAudio::GetClip()
+{
+	return _clip;
+}
+
+bool AlsaAudio::IsLoopEnabled()
+{
+	return _clip->loop;
+}
+
+float AlsaAudio::GetVolume()
+{
+	return _clip->volume;
+}
+
+void AlsaAudio::SetLoopEnabled(bool enabled)
+{
+	_clip->loop = enabled;
+}
+
+void AlsaAudio::SetVolume(float volume)
+{
+	_clip->volume = std::clamp(volume, 0.0f, 1.0f);
+}
+
+AudioMixer::AudioMixer():
+	_volume(ALSA_MIXER_RATE*ALSA_MIXER_RAMP/1000)
+{
+	_handle = nullptr;
+	_period_size = 0;
+	_serial = 0;
+	_is_blocked = false;
+	_is_running = true;
+
+	_voices.reserve(ALSA_MIXER_VOICES);
+	_released.reserve(4*ALSA_MIXER_VOICES);
+
+	_thread = std::thread(&AudioMixer::Run, this);
+}
+
+AudioMixer::~AudioMixer()
+{
+	_mutex.lock();
+	_is_running = false;
+	_condition.notify_one();
+	_mutex.unlock();
+
+	_thread.join();
+
+	if (_handle != nullptr) {
+		snd_pcm_close(_handle);
+	}
+}
+
+AudioMixer * AudioMixer::GetInstance()
+{
+	static AudioMixer mixer;
+
+	return &mixer;
+}
+
+int AudioMixer::GetSampleRate()
+{
+	return ALSA_MIXER_RATE;
+}
+
+int AudioMixer::GetChannels()
+{
+	return ALSA_MIXER_CHANNELS;
+}
+
+SoftwareVolumeControl * AudioMixer::GetVolumeControl()
+{
+	return &_volume;
+}
+
+std::shared_ptr<AudioClip> AudioMixer::CreateClip(std::istream &stream, jaudio_format_t format, int frequency, int channels)
+{
+	std::vector<uint8_t> data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+	return DecodeClip(data.data(), data.size(), format, frequency, channels);
+}
+
+std::shared_ptr<AudioClip> AudioMixer::CreateClip(std::string filename)
+{
+	std::ifstream stream(filename, std::ios::binary);
+
+	if (!stream) {
+		return nullptr;
+	}
+
+	std::vector<uint8_t> data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+	WaveInfo info;
+
+	if (ParseWave(data.data(), data.size(), &info) == false) {
+		return nullptr;
+	}
+
+	jaudio_format_t format;
+
+	if (info.tag == 0x0001 and info.bits_per_sample == 8) {
+		format = jaudio_format_t::U8;
+	} else if (info.tag == 0x0001 and info.bits_per_sample == 16) {
+		format = jaudio_format_t::S16LSB;
+	} else if (info.tag == 0x0001 and info.bits_per_sample == 32) {
+		format = jaudio_format_t::S32LSB;
+	} else if (info.tag == 0x0003 and info.bits_per_sample == 32) {
+		format = jaudio_format_t::F32LSB;
+	} else {
+		return nullptr;
+	}
+
+	return DecodeClip(data.data() + info.data_offset, info.data_size, format, info.sample_rate, info.channels);
+}
+
+void AudioMixer::Start(std::shared_ptr<AudioClip> clip)
+{
+	std::vector<std::shared_ptr<AudioClip>> released;
+
+	if (clip == nullptr) {
+		return;
+	}
+
+	_mutex.lock();
+
+	_commands.push_back({clip, true});
+
+	// the mixer thread never frees memory, so the last references of its clips are dropped here
+	for (auto &released_clip : _released) {
+		released.push_back(std::move(released_clip));
+	}
+
+	_released.clear();
+
+	_condition.notify_one();
+
+	_mutex.unlock();
+}
+
+void AudioMixer::Stop(std::shared_ptr<AudioClip> clip)
+{
+	std::vector<std::shared_ptr<AudioClip>> released;
+
+	if (clip == nullptr) {
+		return;
+	}
+
+	_mutex.lock();
+
+	_commands.push_back({clip, false});
+
+	for (auto &released_clip : _released) {
+		released.push_back(std::move(released_clip));
+	}
+
+	_released.clear();
+
+	_condition.notify_one();
+
+	_mutex.unlock();
+}
+
+bool AudioMixer::Open()
+{
+	if (snd_pcm_open(&_handle, ALSA_MIXER_DEVICE_NAME, SND_PCM_STREAM_PLAYBACK, 0) < 0) {
+		_handle = nullptr;
+
+		return false;
+	}
+
+	// the latency bounds the samples queued ahead of the device, so it bounds the time to start a sound
+	if (snd_pcm_set_params(_handle, SND_PCM_FORMAT_S16, SND_PCM_ACCESS_RW_INTERLEAVED, ALSA_MIXER_CHANNELS, ALSA_MIXER_RATE, 1, ALSA_MIXER_LATENCY) < 0) {
+		snd_pcm_close(_handle);
+
+		_handle = nullptr;
+
+		return false;
+	}
+
+	snd_pcm_uframes_t buffer_size;
+
+	if (snd_pcm_get_params(_handle, &buffer_size, &_period_size) < 0 or _period_size == 0) {
+		snd_pcm_close(_handle);
+
+		_handle = nullptr;
+
+		return false;
+	}
+
+	_period.resize(_period_size*ALSA_MIXER_CHANNELS);
+
+	return true;
+}
+
+bool AudioMixer::Update()
+{
+	std::unique_lock<std::mutex> lock(_mutex, std::try_to_lock);
+
+	// the commands wait for the next period instead of blocking the stream
+	if (lock.owns_lock() == false) {
+		return _voices.empty() == false;
+	}
+
+	// _released never grows past its reserve, so a finished voice that does not fit waits for the next period
+	for (auto i=_voices.begin(); i!=_voices.end(); ) {
+		if (i->position >= i->clip->frames and _released.size() < _released.capacity()) {
+			_released.push_back(std::move(i->clip));
+
+			i = _voices.erase(i);
+		} else {
+			i++;
+		}
+	}
+
+	std::size_t count = 0;
+
+	for (auto &command : _commands) {
+		// a command releases its own clip and, at most, every voice; the others wait for the next period
+		if (_released.size() + _voices.size() + 1 > _released.capacity()) {
+			break;
+		}
+
+		count = count + 1;
+
+		if (command.start == true) {
+			if (_voices.size() >= ALSA_MIXER_VOICES) {
+				auto oldest = std::min_element(_voices.begin(), _voices.end(), [](const Voice &a, const Voice &b) {
+					return a.serial < b.serial;
+				});
+
+				_released.push_back(std::move(oldest->clip));
+
+				_voices.erase(oldest);
+			}
+
+			_voices.push_back({command.clip, 0, _serial++});
+		} else {
+			for (auto i=_voices.begin(); i!=_voices.end(); ) {
+				if (i->clip == command.clip) {
+					_released.push_back(std::move(i->clip));
+
+					i = _voices.erase(i);
+				} else {
+					i++;
+				}
+			}
+		}
+
+		_released.push_back(std::move(command.clip));
+	}
+
+	_commands.erase(_commands.begin(), _commands.begin() + count);
+
+	_is_blocked = (_commands.empty() == false);
+
+	// the commands that did not fit wait for a call of Start() or Stop() to take the released clips, or for the
+	// stream to stop, and a finished voice that waits for room does not keep it running
+	return std::any_of(_voices.begin(), _voices.end(), [](const Voice &voice) {
+		return voice.position < voice.clip->frames;
+	});
+}
+
+void AudioMixer::Mix()
+{
+	std::fill(_period.begin(), _period.end(), 0);
+
+	for (auto &voice : _voices) {
+		AudioClip *clip = voice.clip.get();
+		int16_t gain = (int16_t)(std::clamp(clip->volume.load(std::memory_order_relaxed), 0.0f, 1.0f)*32767.0f);
+		bool loop = clip->loop.load(std::memory_order_relaxed);
+		uint32_t offset = 0;
+
+		while (offset < _period_size and voice.position < clip->frames) {
+			uint32_t count = std::min<uint32_t>(_period_size - offset, clip->frames - voice.position);
+
+			if (gain > 0) {
+				MixSamples(&_period[offset*ALSA_MIXER_CHANNELS], &clip->samples[voice.position*ALSA_MIXER_CHANNELS], count*ALSA_MIXER_CHANNELS, gain);
+			}
+
+			offset = offset + count;
+			voice.position = voice.position + count;
+
+			if (voice.position >= clip->frames and loop == true) {
+				voice.position = 0;
+			}
+		}
+	}
+
+	_volume.Apply(_period.data(), _period_size, ALSA_MIXER_CHANNELS);
+}
+
+void AudioMixer::Run()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	while (_is_running == true) {
+		while (_is_running == true and _commands.empty() == true) {
+			_condition.wait(lock);
+		}
+
+		if (_is_running == false) {
+			break;
+		}
+
+		lock.unlock();
+
+		if (_handle == nullptr and Open() == false) {
+			lock.lock();
+
+			// without a device the sounds are discarded, as a late sound is worse than none, and no stream is
+			// running, so their clips can be freed here
+			_commands.clear();
+
+			continue;
+		}
+
+		snd_pcm_prepare(_handle);
+
+		uint64_t idle = 0;
+
+		while (_is_running == true and idle < (uint64_t)ALSA_MIXER_RATE*ALSA_MIXER_IDLE/1000) {
+			if (Update() == false) {
+				// nothing sounds, so the stream stops at once and the clips blocking the commands are freed
+				if (_is_blocked == true) {
+					break;
+				}
+
+				idle = idle + _period_size;
+			} else {
+				idle = 0;
+			}
+
+			Mix();
+
+			snd_pcm_sframes_t r = snd_pcm_writei(_handle, _period.data(), _period_size);
+
+			if (r < 0) {
+				r = snd_pcm_recover(_handle, r, 1);
+			}
+
+			if (r < 0) {
+				break;
+			}
+		}
+
+		// the stream stays stopped while there is nothing to play
+		snd_pcm_drop(_handle);
+
+		lock.lock();
+
+		// the stream is stopped, so the clips released by a burst of commands can be freed here
+		if (_commands.empty() == false) {
+			_released.clear();
+		}
+
+		// the stream is stopped, so the clips that do not fit in _released can be freed here
+		for (auto &voice : _voices) {
+			if (_released.size() < _released.capacity()) {
+				_released.push_back(std::move(voice.clip));
+			}
+		}
+
+		_voices.clear();
+	}
+}
+
+}
@@ -0,0 +1,220 @@
+#pragma once
+
+#include "jmedia/jaudiomixercontrol.h"
+#include "jmedia/jsoftwarevolumecontrol.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <memory>
+#include <atomic>
+
+#include <alsa/asoundlib.h>
+
+namespace jmedia {
+
+/**
+ * \brief Samples of a sound already in the format of the mixer, shared by the audio and the
+ * voices that play it, so an audio can be released while it is still sounding.
+ *
+ */
+struct AudioClip {
+	std::vector<int16_t> samples;
+	uint32_t frames;
+	std::atomic<float> volume;
+	std::atomic<bool> loop;
+};
+
+/**
+ * \brief
+ *
+ */
+class AlsaAudio : public Audio {
+
+	private:
+		/** \brief */
+		std::shared_ptr<AudioClip> _clip;
+
+	public:
+		/**
+		 * \brief
+		 *
+		 */
+		AlsaAudio(std::shared_ptr<AudioClip> clip);
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual ~AlsaAudio();
+
+		/**
+		 * \brief
+		 *
+		 */
+		std::shared_ptr<AudioClip> GetClip();
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual bool IsLoopEnabled();
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual float GetVolume();
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual void SetLoopEnabled(bool enabled);
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual void SetVolume(float volume);
+
+};
+
+/**
+ * \brief Plays the sounds of the application through a single pcm stream. The sounds are decoded
+ * when they are created, and a single thread sums the active voices once per period, so a sound
+ * starts within the latency of the stream.
+ *
+ */
+class AudioMixer {
+
+	private:
+		struct Voice {
+			std::shared_ptr<AudioClip> clip;
+			uint32_t position;
+			uint64_t serial;
+		};
+
+		struct Command {
+			std::shared_ptr<AudioClip> clip;
+			bool start;
+		};
+
+	private:
+		/** \brief */
+    std::thread _thread;
+		/** \brief */
+    std::mutex _mutex;
+		/** \brief */
+    std::condition_variable _condition;
+		/** \brief commands waiting for the next period */
+		std::vector<Command> _commands;
+		/** \brief clips released by the mixer thread, freed outside of it, never past its reserve */
+		std::vector<std::shared_ptr<AudioClip>> _released;
+		/** \brief owned by the mixer thread */
+		std::vector<Voice> _voices;
+		/** \brief owned by the mixer thread */
+		std::vector<int16_t> _period;
+		/** \brief volume of the sum of the voices */
+		SoftwareVolumeControl _volume;
+		/** \brief */
+		snd_pcm_t *_handle;
+		/** \brief */
+		snd_pcm_uframes_t _period_size;
+		/** \brief */
+		uint64_t _serial;
+		/** \brief commands wait for room in _released, owned by the mixer thread */
+		bool _is_blocked;
+		/** \brief */
+		std::atomic<bool> _is_running;
+
+	private:
+		/**
+		 * \brief
+		 *
+		 */
+		AudioMixer();
+
+		/**
+		 * \brief
+		 *
+		 */
+		bool Open();
+
+		/**
+		 * \brief Applies the pending commands and returns false when there is nothing to play.
+		 *
+		 */
+		bool Update();
+
+		/**
+		 * \brief
+		 *
+		 */
+		void Mix();
+
+		/**
+		 * \brief
+		 *
+		 */
+		void Run();
+
+	public:
+		/**
+		 * \brief
+		 *
+		 */
+		virtual ~AudioMixer();
+
+		/**
+		 * \brief
+		 *
+		 */
+		static AudioMixer * GetInstance();
+
+		/**
+		 * \brief
+		 *
+		 */
+		static int GetSampleRate();
+
+		/**
+		 * \brief
+		 *
+		 */
+		static int GetChannels();
+
+		/**
+		 * \brief
+		 *
+		 */
+		SoftwareVolumeControl * GetVolumeControl();
+
+		/**
+		 * \brief Decodes the samples to the format of the mixer.
+		 *
+		 */
+		static std::shared_ptr<AudioClip> CreateClip(std::istream &stream, jaudio_format_t format, int frequency, int channels);
+
+		/**
+		 * \brief Decodes a pcm wav file to the format of the mixer.
+		 *
+		 */
+		static std::shared_ptr<AudioClip> CreateClip(std::string filename);
+
+		/**
+		 * \brief
+		 *
+		 */
+		void Start(std::shared_ptr<AudioClip> clip);
+
+		/**
+		 * \brief Stops every voice of the clip.
+		 *
+		 */
+		void Stop(std::shared_ptr<AudioClip> clip);
+
+};
+
+}
@@ -18,319 +18,472 @@
  *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
  ***************************************************************************/
 #include "../providers/alsa/bind.h"
+#include "../providers/alsa/audiomixer.h"
+#include "../providers/alsa/wavefile.h"
 
 #include "jmedia/jvolumecontrol.h"
+#include "jmedia/jaudiostatisticscontrol.h"
 
 #include "jdemux/jurl.h"
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <pthread.h>
+#include <poll.h>
+
 #define ALSA_PLAYER_DEVICE_NAME "default"
-#define ALSA_PLAYER_MIXER_NAME "Master"
-#define ALSA_PLAYER_MIXER_INDEX 0
 #define ALSA_PLAYER_BUFFER 1024
+#define ALSA_PLAYER_WAIT 1000
+#define ALSA_PLAYER_PREFETCH 500
+#define ALSA_PLAYER_RAMP 10
+#define ALSA_PLAYER_PRIORITY 50
 
 namespace jmedia {
 
-class AlsaVolumeControlImpl : public VolumeControl {
+class AlsaMixerVolumeControlImpl : public VolumeControl {
+	
+	public:
+		AlsaMixerVolumeControlImpl():
+			VolumeControl()
+		{
+		}
+
+		virtual ~AlsaMixerVolumeControlImpl()
+		{
+		}
+
+		virtual int GetLevel()
+		{
+			return AudioMixer::GetInstance()->GetVolumeControl()->GetLevel();
+		}
+
+		virtual void SetLevel(int level)
+		{
+			AudioMixer::GetInstance()->GetVolumeControl()->SetLevel(level);
+		}
+		
+		virtual bool IsMute()
+		{
+			return AudioMixer::GetInstance()->GetVolumeControl()->IsMute();
+		}
+
+		virtual void SetMute(bool b)
+		{
+			AudioMixer::GetInstance()->GetVolumeControl()->SetMute(b);
+		}
+
+};
+
+class AlsaAudioMixerControlImpl : public AudioMixerControl {
 	
 	private:
 		/** \brief */
 		AlsaLightPlayer *_player;
-		/** \brief */
-		int _level;
-		/** \brief */
-		bool _is_muted;
-		/** \brief */
-		snd_mixer_t *_mixer;
-		/** \brief */
-		snd_mixer_elem_t *_elem;
-		/** \brief */
-		snd_mixer_selem_id_t *_sid;
 
 	public:
-		AlsaVolumeControlImpl(AlsaLightPlayer *player):
-			VolumeControl()
+		AlsaAudioMixerControlImpl(AlsaLightPlayer *player):
+			AudioMixerControl()
 		{
 			_player = player;
-			_level = 50;
-			_is_muted = false;
-			
-			snd_mixer_selem_id_alloca(&_sid);
-
-			// sets simple-mixer index and name
-			snd_mixer_selem_id_set_index(_sid, ALSA_PLAYER_MIXER_INDEX);
-			snd_mixer_selem_id_set_name(_sid, ALSA_PLAYER_MIXER_NAME);
-
-			if ((snd_mixer_open(&_mixer, 0)) < 0) {
-				_mixer = nullptr;
-				return;
-			}
-
-			if ((snd_mixer_attach(_mixer, ALSA_PLAYER_DEVICE_NAME)) < 0) {
-				snd_mixer_close(_mixer);
-				_mixer = nullptr;
+		}
 
-				return;
-			}
+		virtual ~AlsaAudioMixerControlImpl()
+		{
+		}
 
-			if ((snd_mixer_selem_register(_mixer, nullptr, nullptr)) < 0) {
-				snd_mixer_close(_mixer);
-				_mixer = nullptr;
+		virtual Audio * CreateAudio(std::string filename)
+		{
+			std::shared_ptr<AudioClip> clip = AudioMixer::CreateClip(filename);
 
-				return;
+			if (clip == nullptr) {
+				return nullptr;
 			}
 
-			if (snd_mixer_load(_mixer) < 0) {
-				snd_mixer_close(_mixer);
-				_mixer = nullptr;
-			
-				return;
-			}
+			return new AlsaAudio(clip);
+		}
 
-			_elem = snd_mixer_find_selem(_mixer, _sid);
-			
-			if (!_elem) {
-				snd_mixer_close(_mixer);
-				_mixer = nullptr;
+		virtual Audio * CreateAudio(std::istream &stream, jaudio_format_t format, int frequency, int channels)
+		{
+			std::shared_ptr<AudioClip> clip = AudioMixer::CreateClip(stream, format, frequency, channels);
 
-				return;
+			if (clip == nullptr) {
+				return nullptr;
 			}
 
-			SetLevel(100);
+			return new AlsaAudio(clip);
 		}
 
-		virtual ~AlsaVolumeControlImpl()
+		virtual void StartSound(Audio *audio)
 		{
-			snd_mixer_close(_mixer);
+			AlsaAudio *alsa = dynamic_cast<AlsaAudio *>(audio);
+
+			if (alsa != nullptr) {
+				AudioMixer::GetInstance()->Start(alsa->GetClip());
+			}
 		}
 
-		virtual int GetLevel()
+		virtual void StopSound(Audio *audio)
 		{
-			long level = 0;
-			
-      std::unique_lock<std::mutex> lock(_player->_mutex);
+			AlsaAudio *alsa = dynamic_cast<AlsaAudio *>(audio);
 
-			if (_mixer != nullptr) {
-				long minv, maxv;
+			if (alsa != nullptr) {
+				AudioMixer::GetInstance()->Stop(alsa->GetClip());
+			}
+		}
 
-				snd_mixer_selem_get_playback_volume_range(_elem, &minv, &maxv);
+};
 
-				printf("Volume range <%ld,%ld>\n", minv, maxv);
+static uint64_t get_buffer_time(AlsaLightPlayer *player, size_t periods)
+{
+	if (player->_device_rate == 0) {
+		return 0;
+	}
 
-				if (snd_mixer_selem_get_playback_volume(_elem, SND_MIXER_SCHN_MONO, &level) >= 0) {
-					level = (100*(level-minv))/(maxv-minv); // make the value bound from 0 to 100
-				}
-			}
+	return (uint64_t)periods*player->_frames*1000/player->_device_rate;
+}
 
-			return (int)level;
+class AlsaAudioStatisticsControlImpl : public AudioStatisticsControl {
+	
+	private:
+		/** \brief */
+		AlsaLightPlayer *_player;
+
+	public:
+		AlsaAudioStatisticsControlImpl(AlsaLightPlayer *player):
+			AudioStatisticsControl()
+		{
+			_player = player;
 		}
 
-		virtual void SetLevel(int level)
+		virtual ~AlsaAudioStatisticsControlImpl()
 		{
-      std::unique_lock<std::mutex> lock(_player->_mutex);
+		}
 
-			_level = (level < 0)?0:(level > 100)?100:level;
+		virtual uint64_t GetUnderruns()
+		{
+			return _player->_underruns;
+		}
 
-			if (_mixer != nullptr) {
-				long minv, maxv;
+		virtual uint64_t GetBufferLevel()
+		{
+			if (_player->_ring == nullptr) {
+				return 0;
+			}
 
-				snd_mixer_selem_get_playback_volume_range(_elem, &minv, &maxv);
+			return get_buffer_time(_player, _player->_ring->GetLevel());
+		}
 
-				printf("Volume range <%ld,%ld>\n", minv, maxv);
-				
-				level = (level * (maxv - minv) / (100 - 1)) + minv;
+		virtual uint64_t GetMinimumBufferLevel()
+		{
+			return get_buffer_time(_player, _player->_minimum_level);
+		}
 
-				if (snd_mixer_selem_set_playback_volume_all(_elem, level) < 0) {
-					return;
-				}
+		virtual uint64_t GetBufferCapacity()
+		{
+			if (_player->_ring == nullptr) {
+				return 0;
 			}
+
+			return get_buffer_time(_player, _player->_ring->GetCapacity());
 		}
-		
-		virtual bool IsMute()
+
+		virtual uint64_t GetLatency()
 		{
-			return _is_muted;
+			if (_player->_device_rate == 0) {
+				return 0;
+			}
+
+			return (uint64_t)_player->_delay*1000/_player->_device_rate;
 		}
 
-		virtual void SetMute(bool b)
+		virtual void Reset()
 		{
-      std::unique_lock<std::mutex> lock(_player->_mutex);
-	
-			_is_muted = b;
-			
-			if (_is_muted == true) {
-				int level = _level;
+			_player->_underruns = 0;
 
-				SetLevel(0);
-
-				_level = level;
-			} else {
-				SetLevel(_level);
+			if (_player->_ring != nullptr) {
+				_player->_minimum_level = _player->_ring->GetCapacity();
 			}
 		}
 
 };
 
-static bool load_wave_params(const char *file, uint32_t *channels_, uint32_t *bits_per_sample_, uint32_t *sample_rate_)
+static snd_pcm_format_t get_pcm_format(uint32_t tag, uint32_t bit_depth)
 {
-	int fd;
-
-	fd = open(file, O_RDONLY);
-
-	if (fd < 0) {
-		printf("Unable to open file\n");
-
-		return false;
+	if (tag == 0x0003) {
+		return (bit_depth == 32)?SND_PCM_FORMAT_FLOAT_LE:SND_PCM_FORMAT_UNKNOWN;
 	}
 
-	uint32_t size, format_length, sample_rate, avg_bytes_sec; // our 32 bit values
-	uint16_t format_tag, channels, block_align, bits_per_sample; // our 16 values
-	uint8_t id[4];
-
-	if (read(fd, id, sizeof(uint8_t)*4) <= 0) { // read in first four bytes
-		return false;
-	}
-	if (!strcmp((const char *)id, (const char *)"RIFF")) { // we had 'RIFF' let's continue
-		if (read(fd, &size, sizeof(uint32_t)) <= 0) { // read in 32bit size value
-			return false;
-		}
-		if (read(fd, id, sizeof(uint8_t)*4) <= 0) { // read in 4 byte string now
-			return false;
-		}
-		if (!strcmp((const char *)id, (const char *)"WAVE")) { // this is probably a wave file since it contained "WAVE"
-			if (read(fd, id, sizeof(uint8_t)*4) <= 0) { // read in 4 bytes "fmt ";
-				return false;
-			}
-			if (read(fd, &format_length, sizeof(uint32_t)) <= 0) {
-				return false;
-			}
-			if (read(fd, &format_tag, sizeof(uint16_t)) <= 0) { // check mmreg.h (i think?) for other
-				return false;
-			}
-			if (format_tag == 0x0001) { // WAVE_FORMAT_PCM
-				// that's ok !
-			} else if (format_tag == 0x0003) { // WAVE_FORMAT_IEEE_FLOAT
-				return false;
-			} else if (format_tag == 0x0006) { // WAVE_FORMAT_ALAW
-				return false;
-			} else if (format_tag == 0x0007) { // WAVE_FORMAT_MULAW
-				return false;
-			} else if (format_tag == 0xfffe) { // WAVE_FORMAT_EXTENSIBLE
-				return false;
-			} else {
-				return false;
-			}
-			// possible format tags like ADPCM
-			if (read(fd, &channels, sizeof(uint16_t)) <= 0) { // 1 mono, 2 stereo
-				return false;
-			}
-			if (read(fd, &sample_rate, sizeof(uint32_t)) <= 0) { // like 44100, 22050, etc...
-				return false;
-			}
-			if (read(fd, &avg_bytes_sec, sizeof(uint32_t)) <= 0) { // probably won't need this
-				return false;
-			}
-			if (read(fd, &block_align, sizeof(uint16_t)) <= 0) { // probably won't need this
-				return false;
-			}
-			if (read(fd, &bits_per_sample, sizeof(uint16_t)) <= 0) { // 8 bit or 16 bit file?
-				return false;
-			}
-			if (read(fd, id, sizeof(uint8_t)*2) <= 0) { // size of the extension (0 or 22)
-				return false;
-			}
-			if (read(fd, id, sizeof(uint8_t)*2) <= 0) { // number of valid bits
-				return false;
-			}
-			if (read(fd, id, sizeof(uint8_t)*4) <= 0) { // channel position mask
-				return false;
-			}
-
-			*channels_ = channels;
-			*bits_per_sample_ = bits_per_sample;
-			*sample_rate_ = sample_rate;
-
-			return true;
-		} else {
-			// printf("Error: RIFF file but not a wave file\n");
-		}
-	} else {
-		// printf("Error: not a RIFF file\n");
+	if (bit_depth == 8) {
+		return SND_PCM_FORMAT_U8;
+	} else if (bit_depth == 16) {
+		return SND_PCM_FORMAT_S16_LE;
+	} else if (bit_depth == 24) {
+		return SND_PCM_FORMAT_S24_3LE;
+	} else if (bit_depth == 32) {
+		return SND_PCM_FORMAT_S32_LE;
 	}
 
-	return false;
+	return SND_PCM_FORMAT_UNKNOWN;
 }
 
-AlsaLightPlayer::AlsaLightPlayer(std::string uri):
+AlsaLightPlayer::AlsaLightPlayer(std::string uri, jaudio_latency_t latency):
 	Player()
 {
-	_file = jdemux::Url{uri}.Path();
+	jdemux::Url url{uri};
+
+	_file = url.Path();
+	_data = nullptr;
+	_stream_size = 0;
+	_data_offset = 0;
+	_data_size = 0;
+	_position = 0;
+	_ring = nullptr;
+	_latency = latency;
+	_wakeup = -1;
+	_delay = 0;
+	_converter = nullptr;
+	_volume = nullptr;
+	_device_format = SND_PCM_FORMAT_UNKNOWN;
+	_device_channels = 0;
+	_device_rate = 0;
+	_device_frame_size = 0;
+	_seek_position = 0;
+	_seek_serial = 0;
+	_eof_serial = UINT64_MAX;
+	_underruns = 0;
+	_minimum_level = 0;
 	_media_time = 0LL;
 	_decode_rate = 1.0;
 	_is_loop = false;
 	_pcm_handle = nullptr;
 	_params = nullptr;
-	_buffer = nullptr;
-	_buffer_length = 0;
+	_format = SND_PCM_FORMAT_UNKNOWN;
 	_sample_rate = 0;
 	_bit_depth = 0;
 	_channels = 0;
+	_frame_size = 0;
+	_is_mmap = false;
 	_is_closed = false;
 	_is_playing = false;
 
-	_stream.open(_file);
+	// "alsa://" opens no media, it only carries the controls of the device, as the mixer of the sounds of the application
+	if (url.Protocol() == "alsa" and _file.empty() == true) {
+		_component = new jcanvas::Component();
+
+		_controls.push_back(new AlsaMixerVolumeControlImpl());
+		_controls.push_back(new AlsaAudioMixerControlImpl(this));
 
-  if (!_stream) {
+		return;
+	}
+
+	int fd = open(_file.c_str(), O_RDONLY);
+	struct stat st;
+
+	if (fd < 0) {
 		throw std::runtime_error("Unable to open the file");
-  }
+	}
+
+	if (fstat(fd, &st) < 0 or st.st_size == 0) {
+		close(fd);
+
+		throw std::runtime_error("Unable to open the file");
+	}
+
+	_data = (uint8_t *)mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
 
-  _stream.seekg(0, _stream.end);
-  _stream_size = _stream.tellg();
-  _stream.seekg(0, _stream.beg);
+	close(fd);
+
+	if (_data == MAP_FAILED) {
+		_data = nullptr;
+
+		throw std::runtime_error("Unable to map the file");
+	}
+
+	madvise(_data, st.st_size, MADV_SEQUENTIAL);
+
+	_stream_size = st.st_size;
+
+	WaveInfo info;
+
+	if (ParseWave(_data, _stream_size, &info) == false) {
+		munmap(_data, _stream_size);
 
-	if (load_wave_params(_file.c_str(), &_channels, &_bit_depth, &_sample_rate) == false) {
 		throw std::runtime_error("Unable to open a wav file");
 	}
 
+	_format = get_pcm_format(info.tag, info.bits_per_sample);
+
+	if (_format == SND_PCM_FORMAT_UNKNOWN) {
+		munmap(_data, _stream_size);
+
+		throw std::runtime_error("Unsupported sample format");
+	}
+
+	_channels = info.channels;
+	_bit_depth = info.bits_per_sample;
+	_sample_rate = info.sample_rate;
+	_frame_size = info.block_align;
+	_data_offset = info.data_offset;
+	_data_size = info.data_size;
+	_position = _data_offset;
+
 	int pcm;
 
-	if ((pcm = snd_pcm_open(&_pcm_handle, ALSA_PLAYER_DEVICE_NAME, SND_PCM_STREAM_PLAYBACK, 0)) < 0) {
+	// the writer waits for the device in poll(), so a stop wakes it up at once
+	if ((pcm = snd_pcm_open(&_pcm_handle, ALSA_PLAYER_DEVICE_NAME, SND_PCM_STREAM_PLAYBACK, SND_PCM_NONBLOCK)) < 0) {
+		munmap(_data, _stream_size);
+
 		throw std::runtime_error("Unable to open the default pcm device");
 	}
 
 	snd_pcm_hw_params_alloca(&_params);
 	snd_pcm_hw_params_any(_pcm_handle, _params);
 
-	if ((pcm = snd_pcm_hw_params_set_access(_pcm_handle, _params, SND_PCM_ACCESS_RW_INTERLEAVED)) < 0) {
+	// the mapped access writes the samples in the ring buffer of the device, the devices without it are written with copies
+	if ((pcm = snd_pcm_hw_params_set_access(_pcm_handle, _params, SND_PCM_ACCESS_MMAP_INTERLEAVED)) == 0) {
+		_is_mmap = true;
+	} else if ((pcm = snd_pcm_hw_params_set_access(_pcm_handle, _params, SND_PCM_ACCESS_RW_INTERLEAVED)) < 0) {
+		Close();
+
 		throw std::runtime_error("Cannot set interleaved mode");
 	}
 
-	if ((pcm = snd_pcm_hw_params_set_format(_pcm_handle, _params, SND_PCM_FORMAT_S16_LE)) < 0) {
-		throw std::runtime_error("Cannot set the PCM_S16_LE format");
+	// the device keeps its own rate, the conversions are done by the converter instead of the plug layer
+	snd_pcm_hw_params_set_rate_resample(_pcm_handle, _params, 0);
+
+	// the software volume scales the samples in the formats below, a media in another one is converted to them
+	_device_format = _format;
+
+	if ((_device_format != SND_PCM_FORMAT_FLOAT_LE and _device_format != SND_PCM_FORMAT_S32_LE and _device_format != SND_PCM_FORMAT_S16_LE) or 
+			snd_pcm_hw_params_test_format(_pcm_handle, _params, _device_format) < 0) {
+		_device_format = SND_PCM_FORMAT_UNKNOWN;
+
+		for (snd_pcm_format_t format : {SND_PCM_FORMAT_FLOAT_LE, SND_PCM_FORMAT_S32_LE, SND_PCM_FORMAT_S16_LE}) {
+			if (snd_pcm_hw_params_test_format(_pcm_handle, _params, format) == 0) {
+				_device_format = format;
+
+				break;
+			}
+		}
+	}
+
+	if (_device_format == SND_PCM_FORMAT_UNKNOWN or (pcm = snd_pcm_hw_params_set_format(_pcm_handle, _params, _device_format)) < 0) {
+		Close();
+
+		throw std::runtime_error("Cannot set the sample format");
 	}
 
-	if ((pcm = snd_pcm_hw_params_set_channels(_pcm_handle, _params, _channels)) < 0) {
+	_device_channels = _channels;
+
+	if ((pcm = snd_pcm_hw_params_set_channels_near(_pcm_handle, _params, &_device_channels)) < 0) {
+		Close();
+
 		throw std::runtime_error("Cannot set the channels number");
 	}
 
-	if ((pcm = snd_pcm_hw_params_set_rate_near(_pcm_handle, _params, &_sample_rate, 0)) < 0) {
+	_device_rate = _sample_rate;
+
+	if ((pcm = snd_pcm_hw_params_set_rate_near(_pcm_handle, _params, &_device_rate, 0)) < 0) {
+		Close();
+
 		throw std::runtime_error("Cannot set the rate");
 	}
 
+	if (_latency.buffer_size > 0) {
+		snd_pcm_uframes_t frames = _latency.buffer_size;
+
+		if ((pcm = snd_pcm_hw_params_set_buffer_size_near(_pcm_handle, _params, &frames)) < 0) {
+			Close();
+
+			throw std::runtime_error("Cannot set the buffer size");
+		}
+	}
+
+	if (_latency.period_size > 0) {
+		snd_pcm_uframes_t frames = _latency.period_size;
+
+		if ((pcm = snd_pcm_hw_params_set_period_size_near(_pcm_handle, _params, &frames, 0)) < 0) {
+			Close();
+
+			throw std::runtime_error("Cannot set the period size");
+		}
+	}
+
 	if ((pcm = snd_pcm_hw_params(_pcm_handle, _params)) < 0) {
+		Close();
+
 		throw std::runtime_error("Cannot set the hardware parameters");
 	}
 
 	snd_pcm_hw_params_get_period_size(_params, &_frames, 0);
 
-	printf("Alsa Player:: dev-name:[%s], dev-state:[%s], channels:[%d], bit-depth:[%d], sample-rate:[%d]\n", 
-			snd_pcm_name(_pcm_handle), snd_pcm_state_name(snd_pcm_state(_pcm_handle)), _channels, _bit_depth, _sample_rate);
+	if (_frames == 0) {
+		Close();
+
+		throw std::runtime_error("Cannot get the period size");
+	}
+
+	snd_pcm_sw_params_t *swparams;
+
+	snd_pcm_sw_params_alloca(&swparams);
+	snd_pcm_sw_params_current(_pcm_handle, swparams);
+
+	if (_latency.start_threshold > 0) {
+		snd_pcm_sw_params_set_start_threshold(_pcm_handle, swparams, _latency.start_threshold);
+	}
+
+	if (_latency.avail_min > 0) {
+		snd_pcm_sw_params_set_avail_min(_pcm_handle, swparams, _latency.avail_min);
+	}
+
+	if ((pcm = snd_pcm_sw_params(_pcm_handle, swparams)) < 0) {
+		Close();
+
+		throw std::runtime_error("Cannot set the software parameters");
+	}
+
+	int count = snd_pcm_poll_descriptors_count(_pcm_handle);
+
+	_wakeup = eventfd(0, EFD_NONBLOCK);
+
+	if (count < 0 or _wakeup < 0) {
+		Close();
+
+		throw std::runtime_error("Cannot get the poll descriptors");
+	}
 
-	_buffer_length = _frames * _channels * _bit_depth / 8;
+	_descriptors.resize(count + 1);
 
-	_buffer = (uint8_t *)malloc(_buffer_length);
+	snd_pcm_poll_descriptors(_pcm_handle, _descriptors.data(), count);
+
+	_descriptors[count] = {_wakeup, POLLIN, 0};
+
+	_device_frame_size = _device_channels*snd_pcm_format_physical_width(_device_format)/8;
+
+	if (_device_format != _format or _device_channels != _channels or _device_rate != _sample_rate) {
+		_converter = new AudioConverter(_format, _channels, _sample_rate, _device_format, _device_channels, _device_rate);
+	}
+
+	_ring = new PeriodRing(std::max<size_t>(2, ((uint64_t)_device_rate*ALSA_PLAYER_PREFETCH/1000 + _frames - 1)/_frames), _frames*_device_frame_size);
+	_minimum_level = _ring->GetCapacity();
+
+	// the periods are read by the writer, a page fault there is as late as a slow storage
+	if (_latency.realtime == true) {
+		_ring->Lock();
+	}
+
+	printf("Alsa Player:: dev-name:[%s], dev-state:[%s], channels:[%d -> %d], format:[%s -> %s], sample-rate:[%d -> %d], mmap:[%d]\n", 
+			snd_pcm_name(_pcm_handle), snd_pcm_state_name(snd_pcm_state(_pcm_handle)), _channels, _device_channels, snd_pcm_format_name(_format), snd_pcm_format_name(_device_format), _sample_rate, _device_rate, _is_mmap);
 
 	_component = new jcanvas::Component();
 
-	_controls.push_back(new AlsaVolumeControlImpl(this));
+	// the volume of each player scales its own samples, the volume of the system is left to the user
+	_volume = new SoftwareVolumeControl(_device_rate*ALSA_PLAYER_RAMP/1000);
+
+	_controls.push_back(_volume);
+	_controls.push_back(new AlsaAudioMixerControlImpl(this));
+	_controls.push_back(new AlsaAudioStatisticsControlImpl(this));
 }
 
 AlsaLightPlayer::~AlsaLightPlayer()
@@ -353,6 +506,21 @@ void AlsaLightPlayer::Play()
   std::unique_lock<std::mutex> lock(_mutex);
 
 	if (_pcm_handle != nullptr && _is_playing == false) {
+		if (_thread.joinable() == true) {
+			_thread.join();
+		}
+
+		if (_prefetch_thread.joinable() == true) {
+			_prefetch_thread.join();
+		}
+
+		_ring->Reset();
+
+		_seek_position = _position.load();
+		_seek_serial = _seek_serial + 1;
+		_is_playing = true;
+
+    _prefetch_thread = std::thread(&AlsaLightPlayer::Prefetch, this);
     _thread = std::thread(&AlsaLightPlayer::Run, this);
 		
 		DispatchPlayerEvent(new jmedia::PlayerEvent(this, jmedia::jplayerevent_type_t::Start));
@@ -385,6 +553,16 @@ void AlsaLightPlayer::Stop()
 {
   std::unique_lock<std::mutex> lock(_mutex);
 
+	_is_playing = false;
+
+	if (_wakeup >= 0) {
+		uint64_t value = 1;
+
+		if (write(_wakeup, &value, sizeof(value)) < 0) {
+			// the counter is already signaled
+		}
+	}
+
 	if (_pcm_handle != nullptr) {
 		snd_pcm_state_t state = snd_pcm_state(_pcm_handle);
 		
@@ -404,17 +582,21 @@ void AlsaLightPlayer::Stop()
 		}
 	}
 
-	if (_is_playing == true) {
-		_is_playing = false;
-
+	if (_thread.joinable() == true) {
     _thread.join();
 	}
 
-	_stream.seekg(0);
+	if (_prefetch_thread.joinable() == true) {
+    _prefetch_thread.join();
+	}
+
+	_position = _data_offset;
 }
 
 void AlsaLightPlayer::Close()
 {
+	Stop();
+
   std::unique_lock<std::mutex> lock(_mutex);
 
 	if (_is_closed == true) {
@@ -423,54 +605,85 @@ void AlsaLightPlayer::Close()
 
 	_is_closed = true;
 
-  _stream.close();
-
 	if (_pcm_handle != nullptr) {
 		snd_pcm_close(_pcm_handle);
+
+		_pcm_handle = nullptr;
+	}
+
+	if (_wakeup >= 0) {
+		close(_wakeup);
+
+		_wakeup = -1;
+	}
+
+	if (_data != nullptr) {
+		munmap(_data, _stream_size);
+
+		_data = nullptr;
+	}
+
+	if (_converter != nullptr) {
+		delete _converter;
+
+		_converter = nullptr;
+	}
+
+	if (_ring != nullptr) {
+		delete _ring;
+
+		_ring = nullptr;
 	}
 }
 
 void AlsaLightPlayer::SetCurrentTime(uint64_t time)
 {
-	double period;
-	
   std::unique_lock<std::mutex> lock(_mutex);
 
-	period = _channels * _sample_rate * _bit_depth * 60.0 / 8;
-
-	if (period != 0) {
-		_stream.seekg(time*period/(60*1000LL), _stream.beg);
+	if (_sample_rate == 0) {
+		return;
 	}
+
+	// the position stays in the boundary of a frame, or the channels are swapped
+	uint64_t frame = std::min<uint64_t>(time*_sample_rate/1000LL, _data_size/_frame_size);
+
+	_position = _data_offset + frame*_frame_size;
+	_seek_position = _position.load();
+	_seek_serial = _seek_serial + 1;
 }
 
 uint64_t AlsaLightPlayer::GetCurrentTime()
 {
-	uint64_t time = 0LL;
-	double period;
-
   std::unique_lock<std::mutex> lock(_mutex);
 
-	period = _channels * _sample_rate * _bit_depth * 60.0 / 8;
+	if (_sample_rate == 0) {
+		return 0LL;
+	}
+
+	int64_t 
+		frames = _data_size/_frame_size,
+		frame = (_position - _data_offset)/_frame_size;
+	snd_pcm_sframes_t delay = 0;
 
-	if (period != 0) {
-		time = (int)(60.0*(_stream_size - _stream.tellg())/period) * 1000LL;
+	// the samples written but still queued in the device were not heard yet
+	if (_is_playing == true and snd_pcm_delay(_pcm_handle, &delay) == 0 and delay > 0) {
+		frame = frame - (int64_t)delay*_sample_rate/_device_rate;
+
+		if (frame < 0 and _is_loop == true) {
+			frame = frame + frames;
+		}
 	}
 
-	return time;
+	return (uint64_t)std::clamp<int64_t>(frame, 0, frames)*1000LL/_sample_rate;
 }
 
 uint64_t AlsaLightPlayer::GetMediaTime()
 {
-	uint64_t time = 0LL;
-	double period;
-	
-	period = _channels * _sample_rate * _bit_depth * 60.0 / 8;
-
-	if (period != 0) {
-		time = (int)(60.0*_stream_size/period) * 1000LL;
+	if (_sample_rate == 0) {
+		return 0LL;
 	}
 
-	return time;
+	return (_data_size/_frame_size)*1000LL/_sample_rate;
 }
 
 void AlsaLightPlayer::SetLoop(bool b)
@@ -487,8 +700,6 @@ bool AlsaLightPlayer::IsLoop()
 
 void AlsaLightPlayer::SetDecodeRate(double rate)
 {
-  std::unique_lock<std::mutex> lock(_mutex);
-
 	_decode_rate = rate;
 
 	if (_decode_rate == 0.0) {
@@ -508,45 +719,326 @@ jcanvas::Component * AlsaLightPlayer::GetVisualComponent()
 	return _component;
 }
 
+snd_pcm_sframes_t AlsaLightPlayer::WriteMapped(const uint8_t *data, snd_pcm_uframes_t frames)
+{
+	snd_pcm_uframes_t written = 0;
+
+	while (written < frames and _is_playing == true) {
+		snd_pcm_sframes_t avail = snd_pcm_avail_update(_pcm_handle);
+
+		if (avail < 0) {
+			return avail;
+		}
+
+		if ((snd_pcm_uframes_t)avail < std::min(frames - written, _frames)) {
+			// a full ring buffer that was never started is waiting for the first wakeup
+			if (snd_pcm_state(_pcm_handle) == SND_PCM_STATE_PREPARED) {
+				snd_pcm_start(_pcm_handle);
+			}
+
+			int r = Wait();
+
+			if (r < 0) {
+				return r;
+			}
+
+			continue;
+		}
+
+		const snd_pcm_channel_area_t *areas;
+		snd_pcm_uframes_t 
+			offset,
+			count = frames - written;
+
+		int r = snd_pcm_mmap_begin(_pcm_handle, &areas, &offset, &count);
+
+		if (r < 0) {
+			return r;
+		}
+
+		// the channels of an interleaved ring share the area of the first one
+		uint8_t *ring = (uint8_t *)areas[0].addr + areas[0].first/8 + offset*areas[0].step/8;
+
+		memcpy(ring, data + written*_device_frame_size, count*_device_frame_size);
+
+		snd_pcm_sframes_t committed = snd_pcm_mmap_commit(_pcm_handle, offset, count);
+
+		if (committed < 0) {
+			return committed;
+		}
+
+		if ((snd_pcm_uframes_t)committed != count) {
+			return -EPIPE;
+		}
+
+		written = written + count;
+	}
+
+	return written;
+}
+
+int AlsaLightPlayer::Wait()
+{
+	std::size_t count = _descriptors.size() - 1;
+	int r = poll(_descriptors.data(), _descriptors.size(), ALSA_PLAYER_WAIT);
+
+	if (r < 0) {
+		return (errno == EINTR)?0:-errno;
+	}
+
+	if ((_descriptors[count].revents & POLLIN) != 0) {
+		uint64_t value;
+
+		if (read(_wakeup, &value, sizeof(value)) < 0) {
+			// the counter was read by a previous wakeup
+		}
+
+		return 0;
+	}
+
+	unsigned short revents = 0;
+
+	if ((r = snd_pcm_poll_descriptors_revents(_pcm_handle, _descriptors.data(), count, &revents)) < 0) {
+		return r;
+	}
+
+	// the device left the running state, as after an underrun
+	if ((revents & POLLERR) != 0) {
+		snd_pcm_state_t state = snd_pcm_state(_pcm_handle);
+
+		if (state == SND_PCM_STATE_XRUN) {
+			return -EPIPE;
+		} else if (state == SND_PCM_STATE_SUSPENDED) {
+			return -ESTRPIPE;
+		}
+
+		return -EIO;
+	}
+
+	return ((revents & POLLOUT) != 0)?1:0;
+}
+
+void AlsaLightPlayer::Prefetch()
+{
+	uint64_t serial = UINT64_MAX;
+	std::size_t 
+		end = _data_offset + _data_size,
+		position = _data_offset;
+	bool flushed = false;
+
+	while (_is_playing == true) {
+		uint64_t requested = _seek_serial.load();
+
+		if (requested != serial) {
+			serial = requested;
+			position = _seek_position;
+			flushed = false;
+
+			if (_converter != nullptr) {
+				_converter->Reset();
+			}
+		}
+
+		if (position >= end) {
+			if (_is_loop == true) {
+				position = _data_offset;
+
+				continue;
+			}
+
+			if (_converter == nullptr or flushed == true) {
+				_eof_serial = serial;
+
+				std::this_thread::sleep_for(std::chrono::milliseconds(ALSA_PLAYER_PREFETCH/10));
+
+				continue;
+			}
+		}
+
+		uint8_t *period = _ring->BeginWrite();
+
+		if (period == nullptr) {
+			std::this_thread::sleep_for(std::chrono::microseconds(500000ULL*_frames/_device_rate));
+
+			continue;
+		}
+
+		// the pages of the file are faulted here, in a thread that the device does not wait for
+		std::size_t 
+			available = (end - std::min(position, end))/_frame_size,
+			frames = 0;
+
+		if (_converter == nullptr) {
+			frames = std::min<std::size_t>(_frames, available);
+
+			memcpy(period, _data + position, frames*_frame_size);
+
+			position = position + frames*_frame_size;
+		} else {
+			while (frames < _frames) {
+				std::size_t consumed, produced;
+
+				if (available > 0) {
+					produced = _converter->Convert(_data + position, available, &consumed, period + frames*_device_frame_size, _frames - frames);
+				} else {
+					// the resampler still holds the last frames of the media
+					produced = _converter->Convert(nullptr, 0, &consumed, period + frames*_device_frame_size, _frames - frames);
+
+					flushed = true;
+				}
+
+				position = position + consumed*_frame_size;
+				available = available - consumed;
+				frames = frames + produced;
+
+				if (produced == 0 and consumed == 0) {
+					break;
+				}
+			}
+		}
+
+		if (frames > 0) {
+			_ring->EndWrite(frames*_device_frame_size, position, serial);
+		}
+	}
+}
+
 void AlsaLightPlayer::Run()
 {
-	// CHANGE:: skip initial noise
-	_stream.seekg(128, _stream.beg);
+	if (_latency.realtime == true) {
+		struct sched_param param;
+
+		param.sched_priority = ALSA_PLAYER_PRIORITY;
 
-	_is_playing = true;
+		// without the permission the writer keeps the policy of the process
+		pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+	}
 
 	snd_pcm_prepare(_pcm_handle);
-	snd_pcm_reset(_pcm_handle);
-	snd_pcm_start(_pcm_handle);
 
-	int r;
+	bool 
+		finished = false,
+		failed = false;
+	uint64_t start_serial = UINT64_MAX;
+	std::size_t start = _data_offset;
+
+	while (_is_playing == true and failed == false) {
+		uint64_t 
+			eof = _eof_serial.load(),
+			serial = _seek_serial.load(),
+			period_serial;
+		std::size_t
+			size,
+			position;
+		uint8_t *period = _ring->BeginRead(&size, &position, &period_serial);
+
+		// a seek that lands after the first load keeps the first period of its position
+		serial = _seek_serial.load();
+
+		if (period == nullptr) {
+			if (eof == serial) {
+				finished = true;
+
+				break;
+			}
+
+			// the reading is late, the device plays the periods already queued meanwhile
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
 
-	do {
-		_stream.read((char *)_buffer, _buffer_length);
+			continue;
+		}
 
-		if (!_stream) {
-			snd_pcm_drain(_pcm_handle);
+		// only the periods of an older seek are stale
+		if (period_serial < serial) {
+			_ring->EndRead();
 
-			if (_is_loop == true) {
-				_stream.seekg(0);
+			continue;
+		}
+
+		if (serial != start_serial) {
+			start = _seek_position;
+			start_serial = serial;
+		} else if (position < start) {
+			start = _data_offset;
+		}
+
+		std::size_t level = _ring->GetLevel();
+
+		// the ring empties at the end of the media, which is not a late reading
+		if (eof != serial and level < _minimum_level) {
+			_minimum_level = level;
+		}
+
+		// the volume is applied as the period leaves the ring, so a change is not delayed by the prefetch
+		if (_device_format == SND_PCM_FORMAT_S16_LE) {
+			_volume->Apply((int16_t *)period, size/_device_frame_size, _device_channels);
+		} else if (_device_format == SND_PCM_FORMAT_S32_LE) {
+			_volume->Apply((int32_t *)period, size/_device_frame_size, _device_channels);
+		} else if (_device_format == SND_PCM_FORMAT_FLOAT_LE) {
+			_volume->Apply((float *)period, size/_device_frame_size, _device_channels);
+		}
+
+		std::size_t offset = 0;
+
+		while (offset < size and _is_playing == true) {
+			snd_pcm_sframes_t r;
+
+			if (_is_mmap == true) {
+				r = WriteMapped(period + offset, (size - offset)/_device_frame_size);
+			} else if ((r = snd_pcm_writei(_pcm_handle, period + offset, (size - offset)/_device_frame_size)) == -EAGAIN) {
+				// the device is full, the writer sleeps until a period is free
+				if ((r = Wait()) >= 0) {
+					continue;
+				}
+			}
+
+			if (r < 0) {
+				if (r == -EPIPE) {
+					_underruns = _underruns + 1;
+				}
+
+				if (snd_pcm_recover(_pcm_handle, r, 1) < 0) {
+					failed = true;
+
+					break;
+				}
 
 				continue;
 			}
 
-			break;
+			offset = offset + r*_device_frame_size;
+
+			// the periods carry the media position after them, the samples written are interpolated in it
+			if (serial == _seek_serial.load()) {
+				_position = start + (position - start)/_frame_size*offset/size*_frame_size;
+			}
 		}
 
-		if ((r = snd_pcm_writei(_pcm_handle, _buffer, _frames)) == -EPIPE) {
-			snd_pcm_prepare(_pcm_handle);
+		start = position;
+
+		snd_pcm_sframes_t delay;
+
+		if (snd_pcm_delay(_pcm_handle, &delay) == 0) {
+			_delay = delay;
 		}
 
-		if (r < 0) {
-			break;
+		_ring->EndRead();
+	}
+
+	if (finished == true) {
+		if (_is_mmap == true and snd_pcm_state(_pcm_handle) == SND_PCM_STATE_PREPARED) {
+			snd_pcm_start(_pcm_handle);
 		}
-	} while (_is_playing == true);
+
+		// the drain of a nonblocking device does not wait for the last samples
+		snd_pcm_nonblock(_pcm_handle, 0);
+		snd_pcm_drain(_pcm_handle);
+		snd_pcm_nonblock(_pcm_handle, 1);
+	}
+
+	_is_playing = false;
 
 	DispatchPlayerEvent(new jmedia::PlayerEvent(this, jmedia::jplayerevent_type_t::Finish));
 }
 
 }
-
@@ -20,12 +20,18 @@
 #pragma once
 
 #include "jmedia/jplayer.h"
+#include "jmedia/jsoftwarevolumecontrol.h"
+#include "jmedia/jaudiolatency.h"
+
+#include "periodring.h"
+#include "audioconverter.h"
 
 #include "jcanvas/widgets/jcomponent.h"
 
 #include <thread>
 #include <mutex>
-#include <fstream>
+#include <atomic>
+#include <vector>
 
 #include <alsa/asoundlib.h>
 
@@ -37,13 +43,15 @@ class AlsaLightPlayer : public Player {
 		/** \brief */
     std::thread _thread;
 		/** \brief */
+    std::thread _prefetch_thread;
+		/** \brief */
     std::mutex _mutex;
 		/** \brief */
 		std::string _file;
 		/** \brief */
     jcanvas::Component *_component;
-		/** \brief */
-    std::ifstream _stream;
+		/** \brief the file mapped in memory, so the samples go to the device without an intermediate copy */
+		uint8_t *_data;
 		/** \brief */
 		double _decode_rate;
 		/** \brief */
@@ -55,9 +63,15 @@ class AlsaLightPlayer : public Player {
 		/** \brief */
 		snd_pcm_uframes_t _frames;
 		/** \brief */
-		uint8_t *_buffer;
+		jaudio_latency_t _latency;
+		/** \brief descriptors of the device followed by _wakeup */
+		std::vector<struct pollfd> _descriptors;
+		/** \brief wakes up a writer waiting for the device, as when the player stops */
+		int _wakeup;
+		/** \brief frames queued in the device after the last write */
+		std::atomic<snd_pcm_sframes_t> _delay;
 		/** \brief */
-		uint32_t _buffer_length;
+		snd_pcm_format_t _format;
 		/** \brief */
 		uint32_t _sample_rate;
 		/** \brief */
@@ -65,20 +79,74 @@ class AlsaLightPlayer : public Player {
 		/** \brief */
 		uint32_t _channels;
 		/** \brief */
+		uint32_t _frame_size;
+		/** \brief */
     std::size_t _stream_size;
 		/** \brief */
+    std::size_t _data_offset;
+		/** \brief */
+    std::size_t _data_size;
+		/** \brief offset of the next sample written to the device */
+    std::atomic<std::size_t> _position;
+		/** \brief converts the media to the parameters of the device, or nullptr when they match */
+		AudioConverter *_converter;
+		/** \brief owned by the controls */
+		SoftwareVolumeControl *_volume;
+		/** \brief */
+		snd_pcm_format_t _device_format;
+		/** \brief */
+		uint32_t _device_channels;
+		/** \brief */
+		uint32_t _device_rate;
+		/** \brief */
+		uint32_t _device_frame_size;
+		/** \brief periods read ahead of the device, so a stall of the storage does not reach it */
+		PeriodRing *_ring;
+		/** \brief */
+    std::atomic<std::size_t> _seek_position;
+		/** \brief incremented by each seek, the periods read before it are discarded */
+		std::atomic<uint64_t> _seek_serial;
+		/** \brief serial of the seek whose samples were read to the end of the media */
+		std::atomic<uint64_t> _eof_serial;
+		/** \brief */
+		std::atomic<uint64_t> _underruns;
+		/** \brief */
+    std::atomic<std::size_t> _minimum_level;
+		/** \brief */
+		bool _is_mmap;
+		/** \brief */
 		bool _is_closed;
 		/** \brief */
-		bool _is_playing;
+		std::atomic<bool> _is_playing;
 		/** \brief */
 		bool _is_loop;
 
+	private:
+		/**
+		 * \brief Copies the frames straight to the ring buffer of the device.
+		 *
+		 */
+		snd_pcm_sframes_t WriteMapped(const uint8_t *data, snd_pcm_uframes_t frames);
+
+		/**
+		 * \brief Waits until the device accepts a period. It returns 1 when the device is ready, 0 when
+		 * the wait was interrupted or timed out, and the error of the device otherwise.
+		 *
+		 */
+		int Wait();
+
+		/**
+		 * \brief Reads the media ahead of the device.
+		 *
+		 */
+		void Prefetch();
+
 	public:
 		/**
 		 * \brief
 		 *
 		 */
-		AlsaLightPlayer(std::string uri);
+		AlsaLightPlayer(std::string uri, jaudio_latency_t latency = jaudio_latency_t());
 
 		/**
 		 * \brief
@@ -0,0 +1,93 @@
+#include "periodring.h"
+
+#include <sys/mman.h>
+
+namespace jmedia {
+
+PeriodRing::PeriodRing(size_t periods, size_t period_size)
+{
+	_period_size = period_size;
+	_is_locked = false;
+	_data.resize(periods*period_size);
+	_slots.resize(periods);
+	_head = 0;
+	_tail = 0;
+}
+
+PeriodRing::~PeriodRing()
+{
+	if (_is_locked == true) {
+		munlock(_data.data(), _data.size());
+	}
+}
+
+bool PeriodRing::Lock()
+{
+	if (_is_locked == false and mlock(_data.data(), _data.size()) == 0) {
+		_is_locked = true;
+	}
+
+	return _is_locked;
+}
+
+uint8_t * PeriodRing::BeginWrite()
+{
+	uint64_t head = _head.load(std::memory_order_relaxed);
+
+	if (head - _tail.load(std::memory_order_acquire) >= _slots.size()) {
+		return nullptr;
+	}
+
+	return _data.data() + (head % _slots.size())*_period_size;
+}
+
+void PeriodRing::EndWrite(size_t size, size_t position, uint64_t serial)
+{
+	uint64_t head = _head.load(std::memory_order_relaxed);
+
+	_slots[head % _slots.size()] = {size, position, serial};
+
+	_head.store(head + 1, std::memory_order_release);
+}
+
+uint8_t * PeriodRing::BeginRead(size_t *size, size_t *position, uint64_t *serial)
+{
+	uint64_t tail = _tail.load(std::memory_order_relaxed);
+
+	if (tail == _head.load(std::memory_order_acquire)) {
+		return nullptr;
+	}
+
+	Slot &slot = _slots[tail % _slots.size()];
+
+	*size = slot.size;
+	*position = slot.position;
+	*serial = slot.serial;
+
+	return _data.data() + (tail % _slots.size())*_period_size;
+}
+
+void PeriodRing::EndRead()
+{
+	_tail.store(_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+size_t PeriodRing::GetLevel()
+{
+	uint64_t tail = _tail.load(std::memory_order_acquire);
+
+	return _head.load(std::memory_order_acquire) - tail;
+}
+
+size_t PeriodRing::GetCapacity()
+{
+	return _slots.size();
+}
+
+void PeriodRing::Reset()
+{
+	_head = 0;
+	_tail = 0;
+}
+
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+namespace jmedia {
+
+/**
+ * \brief Ring of pcm periods with a single producer and a single consumer. Neither side takes a
+ * lock, so a producer stalled on the storage never delays the thread that feeds the device.
+ *
+ */
+class PeriodRing {
+
+	private:
+		struct Slot {
+			size_t size;
+			size_t position;
+			uint64_t serial;
+		};
+
+	private:
+		/** \brief */
+		std::vector<uint8_t> _data;
+		/** \brief */
+		std::vector<Slot> _slots;
+		/** \brief */
+		size_t _period_size;
+		/** \brief */
+		bool _is_locked;
+		/** \brief written only by the producer */
+		alignas(64) std::atomic<uint64_t> _head;
+		/** \brief written only by the consumer */
+		alignas(64) std::atomic<uint64_t> _tail;
+
+	public:
+		/**
+		 * \brief
+		 *
+		 */
+		PeriodRing(size_t periods, size_t period_size);
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual ~PeriodRing();
+
+		/**
+		 * \brief Locks the periods in memory, so they are never paged out under the consumer.
+		 *
+		 */
+		bool Lock();
+
+		/**
+		 * \brief Returns the next free period, or nullptr when the ring is full.
+		 *
+		 */
+		uint8_t * BeginWrite();
+
+		/**
+		 * \brief Publishes the period with the size of its samples, the offset of the samples in the
+		 * media and the serial of the seek that produced them.
+		 *
+		 */
+		void EndWrite(size_t size, size_t position, uint64_t serial);
+
+		/**
+		 * \brief Returns the oldest period, which the consumer may change until it releases it, or nullptr
+		 * when the ring is empty.
+		 *
+		 */
+		uint8_t * BeginRead(size_t *size, size_t *position, uint64_t *serial);
+
+		/**
+		 * \brief Releases the oldest period to the producer.
+		 *
+		 */
+		void EndRead();
+
+		/**
+		 * \brief Returns the periods waiting for the consumer.
+		 *
+		 */
+		size_t GetLevel();
+
+		/**
+		 * \brief
+		 *
+		 */
+		size_t GetCapacity();
+
+		/**
+		 * \brief Discards every period. It must not be called while any side is running.
+		 *
+		 */
+		void Reset();
+
+};
+
+}
@@ -0,0 +1,111 @@
+#include "wavefile.h"
+
+#include <cstring>
+
+#define WAVE_FORMAT_PCM 0x0001
+#define WAVE_FORMAT_IEEE_FLOAT 0x0003
+#define WAVE_FORMAT_EXTENSIBLE 0xfffe
+
+namespace jmedia {
+
+static uint32_t ReadLE(const uint8_t *data, int size)
+{
+	uint32_t word = 0;
+
+	for (int i=0; i<size; i++) {
+		word = word | ((uint32_t)data[i] << (8*i));
+	}
+
+	return word;
+}
+
+bool ParseWave(const uint8_t *data, size_t size, WaveInfo *info)
+{
+	if (data == nullptr or info == nullptr or size < 12) {
+		return false;
+	}
+
+	if (memcmp(data, "RIFF", 4) != 0 or memcmp(data + 8, "WAVE", 4) != 0) {
+		return false;
+	}
+
+	bool 
+		has_format = false,
+		has_data = false;
+
+	memset(info, 0, sizeof(WaveInfo));
+
+	for (size_t offset = 12; offset + 8 <= size; ) {
+		const uint8_t *chunk = data + offset;
+		uint64_t 
+			length = ReadLE(chunk + 4, 4),
+			available = size - offset - 8;
+
+		if (memcmp(chunk, "fmt ", 4) == 0) {
+			if (length < 16 or length > available) {
+				return false;
+			}
+
+			info->tag = ReadLE(chunk + 8, 2);
+			info->channels = ReadLE(chunk + 10, 2);
+			info->sample_rate = ReadLE(chunk + 12, 4);
+			info->block_align = ReadLE(chunk + 20, 2);
+			info->bits_per_sample = ReadLE(chunk + 22, 2);
+
+			// the sub format of an extensible format starts with the tag of the real format
+			if (info->tag == WAVE_FORMAT_EXTENSIBLE) {
+				if (length < 40) {
+					return false;
+				}
+
+				info->tag = ReadLE(chunk + 32, 2);
+			}
+
+			has_format = true;
+		} else if (memcmp(chunk, "fact", 4) == 0) {
+			if (length >= 4 and length <= available) {
+				info->fact_frames = ReadLE(chunk + 8, 4);
+			}
+		} else if (memcmp(chunk, "data", 4) == 0) {
+			info->data_offset = offset + 8;
+			info->data_size = (length > available)?available:length;
+
+			has_data = true;
+
+			// the samples are the last thing read, and a truncated file has nothing after them
+			if (length >= available) {
+				break;
+			}
+		}
+
+		// every chunk starts at an even offset
+		offset = offset + 8 + length + (length & 1);
+	}
+
+	if (has_format == false or has_data == false) {
+		return false;
+	}
+
+	if (info->tag != WAVE_FORMAT_PCM and info->tag != WAVE_FORMAT_IEEE_FLOAT) {
+		return false;
+	}
+
+	if (info->channels == 0 or info->sample_rate == 0 or info->bits_per_sample == 0 or info->bits_per_sample > 32) {
+		return false;
+	}
+
+	// some writers leave the block align empty, so the frame is derived from the sample width
+	uint32_t block_align = info->channels*((info->bits_per_sample + 7)/8);
+
+	if (block_align == 0 or block_align > UINT16_MAX) {
+		return false;
+	}
+
+	info->block_align = block_align;
+
+	info->data_size = info->data_size - info->data_size % info->block_align;
+
+	return true;
+}
+
+}
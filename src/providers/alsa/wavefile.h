@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace jmedia {
+
+/**
+ * \brief Layout of the samples of a RIFF/WAVE file, with the offsets relative to the start of
+ * the file.
+ *
+ */
+struct WaveInfo {
+	uint16_t tag; // 0x0001 pcm, 0x0003 ieee float, already resolved from an extensible format
+	uint16_t channels;
+	uint32_t sample_rate;
+	uint16_t block_align;
+	uint16_t bits_per_sample;
+	uint64_t data_offset;
+	uint64_t data_size; // always a multiple of block_align
+	uint64_t fact_frames; // 0 when the file has no fact chunk
+};
+
+/**
+ * \brief Walks the chunks of a wave file in memory. Chunks like LIST are skipped, and a data
+ * chunk larger than the file, as left by an interrupted recording, is truncated to the samples
+ * present.
+ *
+ */
+bool ParseWave(const uint8_t *data, size_t size, WaveInfo *info);
+
+}
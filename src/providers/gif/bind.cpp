@@ -52,6 +52,9 @@
 #include "jmedia/jvideoformatcontrol.h"
 #include "jmedia/jvolumecontrol.h"
 #include "jmedia/jaudioconfigurationcontrol.h"
+#include "jmedia/jplayermanager.h"
+#include "jmedia/jcolorconversion.h"
+#include "jmedia/jframemailbox.h"
 
 #include "jcanvas/core/jbufferedimage.h"
 
@@ -60,8 +63,11 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
-
-#include <cairo.h>
+#include <algorithm>
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <map>
 
 #define MAXCOLORMAPSIZE 256
 
@@ -78,21 +84,85 @@
 
 #define LM_to_uint(a,b) (((b)<<8)|(a))
 
+#define GIF_PLAYER_CACHE_LIMIT (16*1024*1024)
+#define GIF_PLAYER_KEYFRAME_INTERVAL 8
+#define GIF_PLAYER_KEYFRAME_LIMIT (32*1024*1024)
+#define GIF_PLAYER_QUEUE_SIZE 4
+#define GIF_PLAYER_MAX_LATENESS 100000
+
 namespace jmedia {
 
+enum class GIFCacheState {
+	Disabled,
+	Filling,
+	Ready
+};
+
+struct GIFCachedFrame {
+	jcanvas::jrect_t<int> bounds;
+	jcanvas::jrect_t<int> damage;
+	uint32_t  delay;
+	int       disposal;
+	int       transparent;
+
+	// indexed form: the lzw output of the frame and its local colormap (empty when the global one is used)
+	std::vector<uint8_t> indices;
+	std::vector<uint32_t> palette;
+
+	// rgb32 form: the composed canvas inside the damaged area
+	std::vector<uint32_t> pixels;
+};
+
+struct GIFFrameInfo {
+	std::streamoff offset;
+	jcanvas::jrect_t<int> bounds;
+	uint64_t  start;
+	uint32_t  delay;
+	int       disposal;
+	int       transparent;
+};
+
+struct GIFQueuedFrame {
+	// index of the frame in the stream, -1 marks its end
+	int       index;
+	uint32_t  delay;
+	jcanvas::jrect_t<int> damage;
+	// the composed canvas inside the damaged area
+	std::vector<uint32_t> pixels;
+};
+
+struct GIFPresentedFrame {
+	std::shared_ptr<jcanvas::Image> image;
+	// area that changed since the previous frame acquired by the component
+	jcanvas::jrect_t<int> damage;
+};
+
 struct AnimatedGIFData {
   std::ifstream stream;
 
+  // decoder: 'decoder_mutex' guards the stream and the composition state
   std::thread thread;
+  std::mutex decoder_mutex;
+  std::condition_variable decoder_condition;
+
+  // presentation: 'mutex' guards the queue of composed frames
   std::mutex mutex;
   std::condition_variable condition;
 
 	uint32_t  *image;
+	uint32_t  *frame;
+
+	// 8bpp canvas: the indices of the global colormap, where 'canvas_clear' marks the cleared pixels
+	uint8_t   *canvas;
+	uint32_t  canvas_palette[MAXCOLORMAPSIZE];
+	int       canvas_clear;
 
 	char      Version[4];
 	uint32_t  Width;
 	uint32_t  Height;
-	uint8_t   ColorMap[3][MAXCOLORMAPSIZE];
+	uint32_t  ColorMap[MAXCOLORMAPSIZE];
+	uint32_t  LocalColorMap[MAXCOLORMAPSIZE];
+	bool      HasColorMap;
 	uint32_t  BitPixel;
 	uint32_t  ColorResolution;
 	uint32_t  Background;
@@ -115,6 +185,32 @@ struct AnimatedGIFData {
 	int       stack[(1<<(MAX_LWZ_BITS))*2], *sp;
 
 	int       ZeroDataBlock;
+
+	std::vector<uint8_t> indices;
+	jcanvas::jrect_t<int> bounds;
+	jcanvas::jrect_t<int> damage;
+	jcanvas::jrect_t<int> previous;
+	int       previous_disposal;
+	uint32_t *palette;
+
+	GIFCacheState cache_state;
+	std::vector<GIFCachedFrame> cache;
+	std::size_t cache_size;
+	bool      cache_indexed;
+
+	std::vector<GIFFrameInfo> frames;
+	std::vector<std::vector<uint8_t>> keyframes;
+	uint64_t  duration;
+	int       keyframe_interval;
+	int       frame_index;
+	bool      refresh;
+
+	std::deque<GIFQueuedFrame> queue;
+	std::vector<std::vector<uint32_t>> spare;
+	uint64_t  generation;
+	int       presented;
+	bool      decoding;
+	bool      resync;
 };
 
 static int FetchData(std::istream &stream, void *data, uint32_t len)
@@ -133,27 +229,21 @@ static int FetchData(std::istream &stream, void *data, uint32_t len)
 	return 0;
 }
 
-static int ReadColorMap(std::istream &stream, int number, uint8_t buf[3][MAXCOLORMAPSIZE])
+static int ReadColorMap(std::istream &stream, int number, uint32_t palette[MAXCOLORMAPSIZE])
 {
-	uint8_t *rgb = new uint8_t[3*number];
+	uint8_t rgb[3*MAXCOLORMAPSIZE];
 	int i;
 
-	if (FetchData(stream, rgb, sizeof(rgb))) {
+	if (FetchData(stream, rgb, 3*number)) {
 		printf("bad colormap");
 
-    delete [] rgb;
-
 		return -1;
 	}
 
 	for (i=0; i<number; ++i) {
-		buf[CM_RED][i] = rgb[i*3+0];
-		buf[CM_GREEN][i] = rgb[i*3+1];
-		buf[CM_BLUE][i] = rgb[i*3+2];
+		palette[i] = 0xFF000000 | rgb[i*3+CM_RED] << 16 | rgb[i*3+CM_GREEN] << 8 | rgb[i*3+CM_BLUE];
 	}
 
-  delete [] rgb;
-
 	return 0;
 }
 
@@ -387,10 +477,10 @@ static int LWZReadByte( AnimatedGIFData *data, int flag, int input_code_size )
 	return code;
 }
 
-static int ReadImage( AnimatedGIFData *data, int left, int top, int width, int height, uint8_t cmap[3][MAXCOLORMAPSIZE], bool interlace, bool ignore )
+static int ReadImage( AnimatedGIFData *data, int width, int height, bool interlace, bool ignore )
 {
 	int v, xpos = 0, ypos = 0, pass = 0;
-	uint32_t *image, *dst;
+	uint8_t *image, *dst;
 	uint8_t c;
 
 	//  Initialize the decompression routines
@@ -403,34 +493,23 @@ static int ReadImage( AnimatedGIFData *data, int left, int top, int width, int h
 	}
 
 	// If this is an "uninteresting picture" ignore it.
-	if (ignore) {
-		printf("skipping image...");
-
+	if (ignore || width <= 0 || height <= 0) {
 		while (LWZReadByte(data, false, c) >= 0);
 
+		data->indices.clear();
+
 		return 0;
 	}
 
-	switch (data->disposal) {
-		case 2:
-			printf("restoring to background color...");
-			memset( data->image, 0, data->Width * data->Height * 4 );
-			break;
-		case 3:
-			printf("restoring to previous frame is unsupported");
-			break;
-		default:
-			break;
-	}
+	// pixels missing in a truncated stream keep the transparent index
+	data->indices.assign(width*height, (data->transparent < 0)?0:data->transparent);
 
-	dst = image = data->image + (top * data->Width + left);
+	dst = image = data->indices.data();
 
-	// printf("reading %dx%d at %dx%d %sGIF image", width, height, left, top, interlace ? " interlaced " : "" );
+	// printf("reading %dx%d %sGIF image", width, height, interlace ? " interlaced " : "" );
 
 	while ((v = LWZReadByte( data, false, c )) >= 0 ) {
-		if (v != data->transparent) {
-			dst[xpos] = (0xFF000000 | cmap[CM_RED][v] << 16 | cmap[CM_GREEN][v] << 8 | cmap[CM_BLUE][v]);
-		}
+		dst[xpos] = v;
 
 		++xpos;
 
@@ -470,7 +549,7 @@ static int ReadImage( AnimatedGIFData *data, int left, int top, int width, int h
 				++ypos;
 			}
 
-			dst = image + ypos * data->Width;
+			dst = image + ypos * width;
 		}
 
 		if (ypos >= height) {
@@ -487,6 +566,199 @@ fini:
 	return 0;
 }
 
+static jcanvas::jrect_t<int> GIFClip( AnimatedGIFData *data, jcanvas::jrect_t<int> rect )
+{
+	int x0 = std::max(rect.point.x, 0),
+			y0 = std::max(rect.point.y, 0),
+			x1 = std::min(rect.point.x + rect.size.x, (int)data->Width),
+			y1 = std::min(rect.point.y + rect.size.y, (int)data->Height);
+
+	if (x1 <= x0 or y1 <= y0) {
+		return {0, 0, 0, 0};
+	}
+
+	return {x0, y0, x1 - x0, y1 - y0};
+}
+
+static jcanvas::jrect_t<int> GIFUnion( jcanvas::jrect_t<int> a, jcanvas::jrect_t<int> b )
+{
+	if (a.size.x <= 0 or a.size.y <= 0) {
+		return b;
+	}
+
+	if (b.size.x <= 0 or b.size.y <= 0) {
+		return a;
+	}
+
+	int x0 = std::min(a.point.x, b.point.x),
+			y0 = std::min(a.point.y, b.point.y),
+			x1 = std::max(a.point.x + a.size.x, b.point.x + b.size.x),
+			y1 = std::max(a.point.y + a.size.y, b.point.y + b.size.y);
+
+	return {x0, y0, x1 - x0, y1 - y0};
+}
+
+static jcanvas::jrect_t<int> GIFDisposeFrame( AnimatedGIFData *data )
+{
+	jcanvas::jrect_t<int> rect = data->previous;
+
+	data->previous = {0, 0, 0, 0};
+
+	if (rect.size.x <= 0 or rect.size.y <= 0) {
+		return {0, 0, 0, 0};
+	}
+
+	switch (data->previous_disposal) {
+		case 2: // restore to background
+			for (int j=rect.point.y; j<rect.point.y + rect.size.y; j++) {
+				if (data->canvas != nullptr) {
+					memset(data->canvas + j*data->Width + rect.point.x, data->canvas_clear, rect.size.x);
+				} else {
+					memset(data->image + j*data->Width + rect.point.x, 0, rect.size.x*sizeof(uint32_t));
+				}
+			}
+
+			return rect;
+		case 3: // restore to previous is unsupported
+		default:
+			break;
+	}
+
+	return {0, 0, 0, 0};
+}
+
+static jcanvas::jrect_t<int> GIFComposeFrame( AnimatedGIFData *data, jcanvas::jrect_t<int> bounds, const uint8_t *indices, const uint32_t *palette, int transparent, int disposal )
+{
+	jcanvas::jrect_t<int> 
+		damage = GIFDisposeFrame(data),
+		rect = GIFClip(data, bounds);
+
+	for (int j=0; j<rect.size.y; j++) {
+		const uint8_t *src = indices + (rect.point.y - bounds.point.y + j)*bounds.size.x + (rect.point.x - bounds.point.x);
+
+		if (data->canvas != nullptr) {
+			uint8_t *dst = data->canvas + (rect.point.y + j)*data->Width + rect.point.x;
+
+			for (int i=0; i<rect.size.x; i++) {
+				if (src[i] != transparent) {
+					dst[i] = src[i];
+				}
+			}
+		} else {
+			uint32_t *dst = data->image + (rect.point.y + j)*data->Width + rect.point.x;
+
+			for (int i=0; i<rect.size.x; i++) {
+				if (src[i] != transparent) {
+					dst[i] = palette[src[i]];
+				}
+			}
+		}
+	}
+
+	data->previous = rect;
+	data->previous_disposal = disposal;
+
+	return GIFUnion(damage, rect);
+}
+
+static uint8_t * GIFCanvas( AnimatedGIFData *data )
+{
+	if (data->canvas != nullptr) {
+		return data->canvas;
+	}
+
+	return (uint8_t *)data->image;
+}
+
+static std::size_t GIFCanvasSize( AnimatedGIFData *data )
+{
+	return data->Width*data->Height*((data->canvas != nullptr)?sizeof(uint8_t):sizeof(uint32_t));
+}
+
+static void GIFCopyRegion( AnimatedGIFData *data, jcanvas::jrect_t<int> rect, uint32_t *pixels )
+{
+	uint32_t *palette = data->canvas_palette;
+
+	for (int j=0; j<rect.size.y; j++) {
+		uint32_t *dst = pixels + j*rect.size.x;
+
+		if (data->canvas != nullptr) {
+			// expands only the requested area of the indexed canvas
+			uint8_t *src = data->canvas + (rect.point.y + j)*data->Width + rect.point.x;
+
+			ColorConversion::GetRGB32FromPalette(&src, &palette, &dst, rect.size.x, 1);
+		} else {
+			memcpy(dst, data->image + (rect.point.y + j)*data->Width + rect.point.x, rect.size.x*sizeof(uint32_t));
+		}
+	}
+}
+
+static void GIFCacheFrame( AnimatedGIFData *data )
+{
+	GIFCachedFrame frame;
+
+	frame.bounds = data->bounds;
+	frame.damage = data->damage;
+	frame.delay = data->delayTime;
+	frame.disposal = data->disposal;
+	frame.transparent = data->transparent;
+
+	if (data->cache_indexed == true) {
+		frame.indices = data->indices;
+
+		if (data->palette == data->LocalColorMap) {
+			frame.palette.assign(data->LocalColorMap, data->LocalColorMap + MAXCOLORMAPSIZE);
+		}
+	} else {
+		jcanvas::jrect_t<int> rect = data->damage;
+
+		frame.pixels.resize(rect.size.x*rect.size.y);
+
+		GIFCopyRegion(data, rect, frame.pixels.data());
+	}
+
+	data->cache_size = data->cache_size + sizeof(frame) + 
+		frame.indices.size()*sizeof(uint8_t) + frame.palette.size()*sizeof(uint32_t) + frame.pixels.size()*sizeof(uint32_t);
+
+	if (data->cache_size > GIF_PLAYER_CACHE_LIMIT) {
+		// the animation does not fit in memory, so it keeps being decoded on every loop
+		data->cache.clear();
+		data->cache.shrink_to_fit();
+		data->cache_size = 0;
+		data->cache_state = GIFCacheState::Disabled;
+
+		return;
+	}
+
+	data->cache.push_back(std::move(frame));
+}
+
+static void GIFReplayFrame( AnimatedGIFData *data, const GIFCachedFrame &frame )
+{
+	data->bounds = frame.bounds;
+	data->delayTime = frame.delay;
+	data->disposal = frame.disposal;
+	data->transparent = frame.transparent;
+
+	if (frame.pixels.empty() == false) {
+		jcanvas::jrect_t<int> rect = frame.damage;
+
+		for (int j=0; j<rect.size.y; j++) {
+			memcpy(data->image + (rect.point.y + j)*data->Width + rect.point.x, frame.pixels.data() + j*rect.size.x, rect.size.x*sizeof(uint32_t));
+		}
+
+		data->previous = GIFClip(data, frame.bounds);
+		data->previous_disposal = frame.disposal;
+		data->damage = frame.damage;
+
+		return;
+	}
+
+	const uint32_t *palette = (frame.palette.empty() == true)?data->ColorMap:frame.palette.data();
+
+	data->damage = GIFComposeFrame(data, frame.bounds, frame.indices.data(), palette, frame.transparent, frame.disposal);
+}
+
 static void GIFReset( AnimatedGIFData *data )
 {
 	data->transparent = -1;
@@ -494,8 +766,13 @@ static void GIFReset( AnimatedGIFData *data )
 	data->inputFlag   = -1;
 	data->disposal    = 0;
 
-	if (data->image) {
-		memset(data->image, 0, data->Width*data->Height*4);
+	data->previous = {0, 0, 0, 0};
+	data->previous_disposal = 0;
+
+	if (data->image != nullptr or data->canvas != nullptr) {
+		// the next composed frame clears the canvas and reports all of it as damaged
+		data->previous = {0, 0, (int)data->Width, (int)data->Height};
+		data->previous_disposal = 2;
 	}
 }
 
@@ -540,6 +817,8 @@ static int GIFReadHeader( AnimatedGIFData *data )
 		data->AspectRatio = (data->Width << 8) / data->Height;
 	}
 
+	data->HasColorMap = BitSet(buf[4], LOCALCOLORMAP);
+
 	if (BitSet(buf[4], LOCALCOLORMAP)) { // Global Colormap
 		if (ReadColorMap( data->stream, data->BitPixel, data->ColorMap )) {
 			printf("error reading global colormap");
@@ -554,7 +833,6 @@ static int GIFReadHeader( AnimatedGIFData *data )
 static int GIFReadFrame(AnimatedGIFData *data)
 {
 	int top, left, width, height;
-	uint8_t localColorMap[3][MAXCOLORMAPSIZE];
 	bool useGlobalColormap;
 	uint8_t buf[16], c;
 
@@ -611,33 +889,280 @@ static int GIFReadFrame(AnimatedGIFData *data)
 
 		useGlobalColormap = !BitSet( buf[8], LOCALCOLORMAP );
 
+		data->palette = data->ColorMap;
+
 		if (!useGlobalColormap) {
 			int bitPixel = 2 << (buf[8] & 0x07);
 
-			if (ReadColorMap( data->stream, bitPixel, localColorMap )) {
+			if (ReadColorMap( data->stream, bitPixel, data->LocalColorMap )) {
 				printf("error reading local colormap");
 			}
+
+			data->palette = data->LocalColorMap;
 		}
 
-		if (ReadImage(data, left, top, width, height, (useGlobalColormap?data->ColorMap:localColorMap), BitSet(buf[8], INTERLACE), 0)) {
+		if (ReadImage(data, width, height, BitSet(buf[8], INTERLACE), 0)) {
 			printf("error reading image");
 
 			return -1;
 		}
 
+		data->bounds = {left, top, width, height};
+		data->damage = GIFComposeFrame(data, data->bounds, data->indices.data(), data->palette, data->transparent, data->disposal);
+
 		break;
 	}
 
 	return 0;
 }
 
+static void GIFSkipBlocks( AnimatedGIFData *data )
+{
+	uint8_t count;
+
+	while (FetchData(data->stream, &count, 1) == 0 and count != 0) {
+		data->stream.ignore(count);
+	}
+}
+
+static void GIFBuildIndex( AnimatedGIFData *data )
+{
+	std::streamoff 
+		origin = data->stream.tellg(),
+		offset = origin;
+	uint32_t delay = 1000000;
+	int disposal = 0;
+	int transparent = -1;
+	int clear = -1;
+	bool indexed = data->HasColorMap;
+	uint8_t buf[256], c;
+
+	data->frames.clear();
+	data->duration = 0;
+
+	// walks the blocks without running the lzw decoder, tracking the graphic control state the same way DoExtension does
+	while (FetchData(data->stream, &c, 1) == 0 and c != ';') {
+		if (c == '!') {
+			if (FetchData(data->stream, &c, 1)) {
+				break;
+			}
+
+			if (c == 0xf9) {
+				int count = GetDataBlock(data, buf);
+
+				if (count >= 4) {
+					disposal = (buf[0] >> 2) & 0x7;
+
+					if (LM_to_uint( buf[1], buf[2] )) {
+						delay = LM_to_uint( buf[1], buf[2] ) * 10000;
+					}
+
+					transparent = ((buf[0] & 0x1) != 0)?buf[3]:-1;
+				}
+
+				if (count <= 0) {
+					continue;
+				}
+			}
+
+			GIFSkipBlocks(data);
+
+			continue;
+		}
+
+		if (c != ',') {
+			continue;
+		}
+
+		if (FetchData(data->stream, buf, 9)) {
+			break;
+		}
+
+		if (BitSet( buf[8], LOCALCOLORMAP )) {
+			data->stream.ignore(3*(2 << (buf[8] & 0x07)));
+
+			indexed = false;
+		}
+
+		// every frame must skip the same index, otherwise it could be an opaque color in another frame
+		if (data->frames.size() == 0 or clear == transparent) {
+			clear = transparent;
+		} else {
+			clear = -1;
+		}
+
+		data->stream.ignore(1); // lzw minimum code size
+
+		GIFSkipBlocks(data);
+
+		if (!data->stream) {
+			break;
+		}
+
+		GIFFrameInfo frame;
+
+		frame.offset = offset;
+		frame.bounds = {LM_to_uint( buf[0], buf[1] ), LM_to_uint( buf[2], buf[3] ), LM_to_uint( buf[4], buf[5] ), LM_to_uint( buf[6], buf[7] )};
+		frame.start = data->duration;
+		frame.delay = delay;
+		frame.disposal = disposal;
+		frame.transparent = transparent;
+
+		data->frames.push_back(frame);
+		data->duration = data->duration + delay;
+
+		offset = data->stream.tellg();
+	}
+
+	// the frames share the global colormap, so the canvas keeps indices and a spare one marks the cleared pixels
+	data->canvas_clear = -1;
+
+	if (indexed == true and data->cache_indexed == true) {
+		if (clear >= 0) {
+			data->canvas_clear = clear;
+		} else if (data->BitPixel < MAXCOLORMAPSIZE) {
+			data->canvas_clear = data->BitPixel;
+		}
+	}
+
+	// keeps at most GIF_PLAYER_KEYFRAME_LIMIT bytes of keyframes by spreading them when the animation is large
+	std::size_t 
+		frames = data->frames.size(),
+		canvas = std::max<std::size_t>(data->Width*data->Height*((data->canvas_clear >= 0)?sizeof(uint8_t):sizeof(uint32_t)), 1),
+		count = std::max<std::size_t>(GIF_PLAYER_KEYFRAME_LIMIT/canvas, 1);
+
+	data->keyframe_interval = std::max<std::size_t>(GIF_PLAYER_KEYFRAME_INTERVAL, (frames + count - 1)/count);
+	data->keyframes.clear();
+	data->keyframes.resize((frames + data->keyframe_interval - 1)/data->keyframe_interval);
+
+	data->stream.clear();
+	data->stream.seekg(origin);
+}
+
+static int GIFNextFrame( AnimatedGIFData *data )
+{
+	int index = data->frame_index + 1;
+
+	if (data->cache_state == GIFCacheState::Ready) {
+		if (index >= (int)data->cache.size()) {
+			return -1;
+		}
+
+		GIFReplayFrame(data, data->cache[index]);
+	} else {
+		if (GIFReadFrame(data) != 0) {
+			if (data->cache_state == GIFCacheState::Filling and index == (int)data->cache.size() and index > 0) {
+				data->cache_state = GIFCacheState::Ready;
+			}
+
+			return -1;
+		}
+
+		// a seek leaves holes in the cache, so it only grows while the frames come in order
+		if (data->cache_state == GIFCacheState::Filling and index == (int)data->cache.size()) {
+			GIFCacheFrame(data);
+		}
+	}
+
+	data->frame_index = index;
+
+	if (data->refresh == true) {
+		data->refresh = false;
+		data->damage = {0, 0, (int)data->Width, (int)data->Height};
+	}
+
+	if ((index % data->keyframe_interval) == 0 and index/data->keyframe_interval < (int)data->keyframes.size()) {
+		std::vector<uint8_t> &keyframe = data->keyframes[index/data->keyframe_interval];
+
+		if (keyframe.empty() == true) {
+			keyframe.assign(GIFCanvas(data), GIFCanvas(data) + GIFCanvasSize(data));
+		}
+	}
+
+	return 0;
+}
+
+static int GIFRewind( AnimatedGIFData *data )
+{
+	GIFReset(data);
+
+	data->frame_index = -1;
+
+	if (data->cache_state == GIFCacheState::Ready) {
+		return 0;
+	}
+
+	data->stream.clear();
+	data->stream.seekg(0);
+
+	return GIFReadHeader(data);
+}
+
+static int GIFSeekFrame( AnimatedGIFData *data, int frame )
+{
+	// composes the frames before 'frame', so it is the next one to be presented. the keyframes are recorded as the
+	// frames are composed, so the first seek past the decoded point rolls forward from the last keyframe once, and
+	// any later seek there costs at most keyframe_interval decodes
+	int target = std::min(frame, (int)data->frames.size() - 1) - 1;
+
+	if (target < 0) {
+		return GIFRewind(data);
+	}
+
+	int key = target/data->keyframe_interval;
+
+	while (key >= 0 and data->keyframes[key].empty() == true) {
+		key = key - 1;
+	}
+
+	int index = key*data->keyframe_interval;
+
+	if (data->frame_index > target or data->frame_index < index) {
+		if (key < 0) {
+			if (GIFRewind(data) != 0) {
+				return -1;
+			}
+		} else {
+			const GIFFrameInfo &info = data->frames[index];
+
+			std::copy(data->keyframes[key].begin(), data->keyframes[key].end(), GIFCanvas(data));
+
+			data->frame_index = index;
+			data->delayTime = info.delay;
+			data->disposal = info.disposal;
+			data->transparent = info.transparent;
+			data->previous = GIFClip(data, info.bounds);
+			data->previous_disposal = info.disposal;
+
+			if (data->cache_state != GIFCacheState::Ready) {
+				data->stream.clear();
+				data->stream.seekg(data->frames[index + 1].offset);
+			}
+		}
+	}
+
+	while (data->frame_index < target) {
+		if (GIFNextFrame(data) != 0) {
+			return -1;
+		}
+	}
+
+	data->refresh = true;
+
+	return 0;
+}
+
 class GifPlayerComponentImpl : public jcanvas::Component {
 
 	public:
 		/** \brief */
 		Player *_player;
 		/** \brief */
-		cairo_surface_t *_surface;
+		FrameMailbox<GIFPresentedFrame> _mailbox;
+		/** \brief area of each presentation image that is behind the canvas, owned by the presenter */
+		std::map<jcanvas::Image *, jcanvas::jrect_t<int>> _stale;
+		/** \brief */
+		jcanvas::jrect_t<int> _published;
 		/** \brief */
     std::mutex _mutex;
 		/** \brief */
@@ -651,7 +1176,6 @@ class GifPlayerComponentImpl : public jcanvas::Component {
 		GifPlayerComponentImpl(Player *player, int x, int y, int w, int h):
 			jcanvas::Component({x, y, w, h})
 		{
-			_surface = nullptr;
 			_player = player;
 			
 			_frame_size.x = w;
@@ -665,18 +1189,15 @@ class GifPlayerComponentImpl : public jcanvas::Component {
         0, 0, w, h
       };
 
+			_published = {
+        0, 0, 0, 0
+      };
+
 			SetVisible(true);
 		}
 
 		virtual ~GifPlayerComponentImpl()
 		{
-			_mutex.lock();
-
-      if (_surface != nullptr) {
-        cairo_surface_destroy(_surface);
-      }
-
-			_mutex.unlock();
 		}
 
 		virtual jcanvas::jpoint_t<int> GetPreferredSize()
@@ -684,49 +1205,97 @@ class GifPlayerComponentImpl : public jcanvas::Component {
 			return _frame_size;
 		}
 
-		virtual void UpdateComponent(uint32_t *data)
+		virtual void UpdateComponent(uint32_t *data, jcanvas::jrect_t<int> damage, const uint32_t *pixels)
 		{
 			int sw = _frame_size.x;
 			int sh = _frame_size.y;
 
-			_mutex.lock();
+      for (int j=0; j<damage.size.y; j++) {
+        memcpy(data + (damage.point.y + j)*sw + damage.point.x, pixels + j*damage.size.x, damage.size.x*sizeof(uint32_t));
+      }
 
-			_surface = cairo_image_surface_create_for_data(
-					(uint8_t *)data, CAIRO_FORMAT_RGB24, sw, sh, cairo_format_stride_for_width(CAIRO_FORMAT_RGB24, sw));
+      GIFPresentedFrame &frame = _mailbox.GetWriteBuffer();
+
+      if (frame.image == nullptr) {
+        frame.image = std::make_shared<jcanvas::BufferedImage>(jcanvas::jpixelformat_t::RGB32, jcanvas::jpoint_t<int>{sw, sh});
+
+        _stale[frame.image.get()] = {
+          0, 0, sw, sh
+        };
+      }
+
+      for (auto &i : _stale) {
+        i.second = GIFUnion(i.second, damage);
+      }
+
+      // the image of the slot lags behind the canvas by every damage published since it was last written
+      jcanvas::jrect_t<int> &stale = _stale[frame.image.get()];
+      uint32_t *dst = (uint32_t *)frame.image->LockData();
+
+      for (int j=0; j<stale.size.y; j++) {
+        int offset = (stale.point.y + j)*sw + stale.point.x;
+
+        memcpy(dst + offset, data + offset, stale.size.x*sizeof(uint32_t));
+      }
+
+      frame.image->UnlockData();
+
+      stale = {
+        0, 0, 0, 0
+      };
+
+      // a frame that was never acquired is replaced, so its damage is carried to the next one
+      if (_mailbox.IsPending() == true) {
+        damage = GIFUnion(damage, _published);
+      }
+
+      frame.damage = damage;
+      _published = damage;
+
+      _mailbox.Publish();
 
       Repaint();
     }
 
 		virtual void Paint(jcanvas::Graphics *g)
 		{
-			jcanvas::Component::Paint(g);
+      bool 
+        is_damaged = _mailbox.Acquire();
+      GIFPresentedFrame 
+        &frame = _mailbox.GetReadBuffer();
+
+			if (frame.image == nullptr) {
+        jcanvas::Component::Paint(g);
 
-			if (_surface == nullptr) {
         return;
 			}
 
+      _mutex.lock();
+
+      jcanvas::jrect_t<int>
+        area = _src;
+
+      _mutex.unlock();
+
       jcanvas::jpoint_t<int>
         size = GetSize();
 
-      std::shared_ptr<jcanvas::Image> image = std::make_shared<jcanvas::BufferedImage>(_surface);
+      // the damage only tells the grabbers what changed, as jcanvas repaints the whole component
+      if (is_damaged == true) {
+			  _player->DispatchFrameGrabberEvent(new jmedia::FrameGrabberEvent(frame.image, jmedia::jframeevent_type_t::Grab, frame.damage));
+      }
 
-			_player->DispatchFrameGrabberEvent(new jmedia::FrameGrabberEvent(image, jmedia::jframeevent_type_t::Grab));
+      jcanvas::Component::Paint(g);
 
 	    g->SetAntialias(jcanvas::jantialias_t::None);
 	    g->SetCompositeFlags(jcanvas::jcomposite_flags_t::Src);
 	    g->SetBlittingFlags(jcanvas::jblitting_flags_t::Nearest);
 
-      if (_src.point.x == 0 and _src.point.y == 0 and _src.size.x == _frame_size.x and _src.size.y == _frame_size.y) {
-			  g->DrawImage(image, {0, 0, size.x, size.y});
-      } else {
-			  g->DrawImage(image, _src, {0, 0, size.x, size.y});
+      if (area.point.x == 0 and area.point.y == 0 and area.size.x == _frame_size.x and area.size.y == _frame_size.y) {
+			  g->DrawImage(frame.image, {0, 0, size.x, size.y});
+      } else if (area.size.x > 0 and area.size.y > 0) {
+			  g->DrawImage(frame.image, area, {0, 0, size.x, size.y});
       }
-		
-      cairo_surface_destroy(_surface);
-
-      _surface = nullptr;
-
-			_mutex.unlock();
 		}
 
 		virtual Player * GetPlayer()
@@ -815,6 +1384,10 @@ GIFLightPlayer::GIFLightPlayer(std::string uri):
 	data->stream.open(_file);
 
 	data->image = nullptr;
+	data->frame = nullptr;
+	data->canvas = nullptr;
+	data->canvas_clear = -1;
+	data->HasColorMap = false;
 	data->Width = -1;
 	data->Height = -1;
 	data->BitPixel = 0;
@@ -839,16 +1412,51 @@ GIFLightPlayer::GIFLightPlayer(std::string uri):
 	data->clear_code = 0;
 	data->end_code = 0;
 	data->ZeroDataBlock = 0;
+	data->bounds = {0, 0, 0, 0};
+	data->damage = {0, 0, 0, 0};
+	data->palette = data->ColorMap;
+	data->cache_state = GIFCacheState::Disabled;
+	data->cache_size = 0;
+	data->cache_indexed = PlayerManager::GetHint(jplayer_hints_t::Lightweight);
+
+	if (PlayerManager::GetHint(jplayer_hints_t::Caching) == true) {
+		data->cache_state = GIFCacheState::Filling;
+	}
 
 	GIFReset(data);
 
+	data->duration = 0;
+	data->keyframe_interval = GIF_PLAYER_KEYFRAME_INTERVAL;
+	data->frame_index = -1;
+	data->refresh = false;
+	data->generation = 0;
+	data->presented = -1;
+	data->decoding = false;
+	data->resync = true;
+
 	if (GIFReadHeader(data) != 0) {
 		delete data;
 
 		throw std::runtime_error("Unable to process gif header");
 	}
 
-	data->image = new uint32_t[data->Width*data->Height];
+	GIFBuildIndex(data);
+
+	if (data->canvas_clear >= 0) {
+		data->canvas = new uint8_t[data->Width*data->Height];
+
+		std::copy(data->ColorMap, data->ColorMap + MAXCOLORMAPSIZE, data->canvas_palette);
+
+		data->canvas_palette[data->canvas_clear] = 0x00000000;
+	} else {
+		data->image = new uint32_t[data->Width*data->Height];
+	}
+
+	data->frame = new uint32_t[data->Width*data->Height];
+
+	memset(data->frame, 0, data->Width*data->Height*sizeof(uint32_t));
+
+	GIFReset(data);
 
 	_controls.push_back(new GifVideoSizeControlImpl(this));
 
@@ -876,58 +1484,153 @@ GIFLightPlayer::~GIFLightPlayer()
 	delete data;
 }
 
-void GIFLightPlayer::Run()
+void GIFLightPlayer::Decode()
 {
 	AnimatedGIFData *data = (AnimatedGIFData *)_provider;
 
-	while (_is_playing == true) {
-		bool skip = false;
+	std::unique_lock<std::mutex> lock(data->mutex);
+
+	while (data->decoding == true) {
+		if (data->queue.size() >= GIF_PLAYER_QUEUE_SIZE) {
+			data->decoder_condition.wait(lock);
 
-    std::unique_lock<std::mutex> lock(data->mutex);
+			continue;
+		}
 
-		if (GIFReadFrame(data) != 0) { 
-			GIFReset(data);
+		GIFQueuedFrame frame;
 
-			if (_is_loop == true) {
-				skip = true;
+		if (data->spare.empty() == false) {
+			frame.pixels = std::move(data->spare.back());
 
-				data->stream.seekg(0);
-				
-				if (GIFReadHeader(data) != 0) {
-					break;
-				}
-			} else {
-				DispatchPlayerEvent(new jmedia::PlayerEvent(this, jmedia::jplayerevent_type_t::Finish));
+			data->spare.pop_back();
+		}
 
-				data->mutex.unlock();
+		uint64_t generation = data->generation;
 
-				break;
+		lock.unlock();
+
+		// composes the next frame while the presentation keeps releasing the queued ones
+		data->decoder_mutex.lock();
+
+		int r = GIFNextFrame(data);
+
+		if (r != 0 and _is_loop == true) {
+			if (GIFRewind(data) == 0) {
+				r = GIFNextFrame(data);
 			}
 		}
 
-		if (skip == false) {
-      dynamic_cast<GifPlayerComponentImpl *>(_component)->UpdateComponent(data->image);
+		frame.index = -1;
+		frame.delay = 0;
+		frame.damage = {0, 0, 0, 0};
 
-			try {
-				if (_decode_rate == 0) {
-					data->condition.wait(lock);
-				} else {
-					uint64_t us;
+		if (r == 0) {
+			jcanvas::jrect_t<int> rect = data->damage;
 
-					us = data->delayTime;
+			frame.index = data->frame_index;
+			frame.delay = data->delayTime;
+			frame.damage = rect;
+			frame.pixels.resize(rect.size.x*rect.size.y);
 
-					if (_decode_rate != 1.0) {
-						us = ((double)us / _decode_rate + 0.5);
-					}
+			GIFCopyRegion(data, rect, frame.pixels.data());
+		}
 
-          data->condition.wait_for(lock, std::chrono::microseconds(us));
-				}
-			} catch (std::runtime_error &e) {
+		data->decoder_mutex.unlock();
+
+		lock.lock();
+
+		// a seek happened during the composition, so the frame belongs to the old position
+		if (generation != data->generation) {
+			data->spare.push_back(std::move(frame.pixels));
+
+			continue;
+		}
+
+		data->queue.push_back(std::move(frame));
+		data->condition.notify_one();
+
+		if (r != 0) {
+			// waits for a seek or the end of the playback
+			while (data->decoding == true and generation == data->generation) {
+				data->decoder_condition.wait(lock);
 			}
 		}
 	}
 }
 
+void GIFLightPlayer::Run()
+{
+	AnimatedGIFData *data = (AnimatedGIFData *)_provider;
+
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now();
+
+	std::unique_lock<std::mutex> lock(data->mutex);
+
+	data->decoding = true;
+	data->thread = std::thread(&GIFLightPlayer::Decode, this);
+
+	while (_is_playing == true) {
+		if (data->queue.empty() == true or _decode_rate == 0.0) {
+			data->condition.wait(lock);
+
+			continue;
+		}
+
+		if (data->resync == true) {
+			data->resync = false;
+
+			deadline = std::chrono::steady_clock::now();
+		}
+
+		// seeks and rate changes wake up the wait, so the head of the queue is evaluated again
+		if (data->condition.wait_until(lock, deadline) == std::cv_status::no_timeout) {
+			continue;
+		}
+
+		GIFQueuedFrame frame = std::move(data->queue.front());
+
+		data->queue.pop_front();
+		data->decoder_condition.notify_one();
+
+		if (frame.index < 0) {
+			lock.unlock();
+
+			DispatchPlayerEvent(new jmedia::PlayerEvent(this, jmedia::jplayerevent_type_t::Finish));
+
+			lock.lock();
+
+			break;
+		}
+
+		double rate = _decode_rate;
+
+		lock.unlock();
+
+    dynamic_cast<GifPlayerComponentImpl *>(_component)->UpdateComponent(data->frame, frame.damage, frame.pixels.data());
+
+		lock.lock();
+
+		data->presented = frame.index;
+		data->spare.push_back(std::move(frame.pixels));
+
+		// the deadlines are absolute, so the time spent to present a frame does not accumulate
+		deadline = deadline + std::chrono::microseconds((uint64_t)(frame.delay/rate + 0.5));
+
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+		if (deadline + std::chrono::microseconds(GIF_PLAYER_MAX_LATENESS) < now) {
+			deadline = now;
+		}
+	}
+
+	data->decoding = false;
+	data->decoder_condition.notify_one();
+
+	lock.unlock();
+
+	data->thread.join();
+}
+
 void GIFLightPlayer::Play()
 {
   _mutex.lock();
@@ -980,7 +1683,12 @@ void GIFLightPlayer::Stop()
   _mutex.lock();
 
   if (_is_playing == true) {
+		AnimatedGIFData *data = (AnimatedGIFData *)_provider;
+
+		data->mutex.lock();
 	  _is_playing = false;
+		data->condition.notify_one();
+		data->mutex.unlock();
 
     _thread.join();
   }
@@ -1002,25 +1710,31 @@ void GIFLightPlayer::Close()
 
   _mutex.lock();
 
-	_is_playing = false;
 	_is_closed = true;
 	
 	AnimatedGIFData *data = (AnimatedGIFData *)_provider;
 
-	data->condition.notify_one();
-
   if (_is_playing == true) {
+		data->mutex.lock();
     _is_playing = false;
+		data->condition.notify_one();
+		data->mutex.unlock();
 
     _thread.join();
   }
 
-	_is_playing = false;
-
 	if (data->image != nullptr) {
 		delete [] data->image;
 	}
 
+	if (data->frame != nullptr) {
+		delete [] data->frame;
+	}
+
+	if (data->canvas != nullptr) {
+		delete [] data->canvas;
+	}
+
 	delete data;
 
 	_provider = nullptr;
@@ -1028,18 +1742,63 @@ void GIFLightPlayer::Close()
   _mutex.unlock();
 }
 
-void GIFLightPlayer::SetCurrentTime(uint64_t)
+void GIFLightPlayer::SetCurrentTime(uint64_t time)
 {
+	AnimatedGIFData *data = (AnimatedGIFData *)_provider;
+
+	if (data == nullptr or data->frames.size() == 0) {
+		return;
+	}
+
+	std::unique_lock<std::mutex> decoder_lock(data->decoder_mutex);
+
+	auto i = std::upper_bound(data->frames.begin(), data->frames.end(), time*1000LL, [](uint64_t us, const GIFFrameInfo &frame) {
+		return us < frame.start;
+	});
+
+	GIFSeekFrame(data, std::max<int>(std::distance(data->frames.begin(), i) - 1, 0));
+
+	std::unique_lock<std::mutex> lock(data->mutex);
+
+	// drops the frames composed ahead of the old position
+	for (GIFQueuedFrame &frame : data->queue) {
+		data->spare.push_back(std::move(frame.pixels));
+	}
+
+	data->queue.clear();
+	data->generation = data->generation + 1;
+	data->resync = true;
+
+	data->decoder_condition.notify_one();
+	data->condition.notify_one();
 }
 
 uint64_t GIFLightPlayer::GetCurrentTime()
 {
-	return -1LL;
+	AnimatedGIFData *data = (AnimatedGIFData *)_provider;
+
+	if (data == nullptr) {
+		return -1LL;
+	}
+
+	std::unique_lock<std::mutex> lock(data->mutex);
+
+	if (data->presented < 0 or data->presented >= (int)data->frames.size()) {
+		return 0LL;
+	}
+
+	return data->frames[data->presented].start/1000LL;
 }
 
 uint64_t GIFLightPlayer::GetMediaTime()
 {
-	return -1LL;
+	AnimatedGIFData *data = (AnimatedGIFData *)_provider;
+
+	if (data == nullptr) {
+		return -1LL;
+	}
+
+	return data->duration/1000LL;
 }
 
 void GIFLightPlayer::SetLoop(bool b)
@@ -1056,15 +1815,21 @@ void GIFLightPlayer::SetDecodeRate(double rate)
 {
   _mutex.lock();
 
+	AnimatedGIFData *data = (AnimatedGIFData *)_provider;
+
+	data->mutex.lock();
+
 	_decode_rate = rate;
 
 	if (_decode_rate != 0.0) {
-		AnimatedGIFData *data = (AnimatedGIFData *)_provider;
-		
 		_is_paused = false;
-			
+		
+		// the next deadline is anchored again using the new rate
+		data->resync = true;
 		data->condition.notify_one();
 	}
+
+	data->mutex.unlock();
   
   _mutex.unlock();
 }
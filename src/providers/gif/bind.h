@@ -155,6 +155,12 @@ class GIFLightPlayer : public Player {
 		 *
 		 */
 		virtual void Run();
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual void Decode();
 };
 
 }
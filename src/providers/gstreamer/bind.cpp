@@ -24,6 +24,7 @@
 #include "jmedia/jvolumecontrol.h"
 #include "jmedia/jaudioconfigurationcontrol.h"
 #include "jmedia/jvideodevicecontrol.h"
+#include "jmedia/jframemailbox.h"
 
 #include "jcanvas/core/jbufferedimage.h"
 
@@ -31,8 +32,6 @@
 
 #include <filesystem>
 
-#include <cairo.h>
-
 namespace jmedia {
 
 class GStreamerPlayerComponentImpl : public jcanvas::Component {
@@ -45,9 +44,7 @@ class GStreamerPlayerComponentImpl : public jcanvas::Component {
 		/** \brief */
 		jcanvas::jrect_t<int> _src;
 		/** \brief */
-		uint32_t **_buffer;
-		/** \brief */
-		int _buffer_index;
+		FrameMailbox<std::shared_ptr<jcanvas::Image>> _mailbox;
 		/** \brief */
 		jcanvas::jpoint_t<int> _frame_size;
 
@@ -55,10 +52,6 @@ class GStreamerPlayerComponentImpl : public jcanvas::Component {
 		GStreamerPlayerComponentImpl(Player *player, int x, int y, int width, int height):
 			jcanvas::Component({x, y, width, height})
 		{
-			_buffer = nullptr;
-			
-			_buffer_index = 0;
-
 			_player = player;
 			
 			_frame_size.x = width;
@@ -73,13 +66,6 @@ class GStreamerPlayerComponentImpl : public jcanvas::Component {
 
 		virtual ~GStreamerPlayerComponentImpl()
 		{
-			if (_buffer != nullptr) {
-				delete [] _buffer[0];
-				delete [] _buffer[1];
-
-				delete [] _buffer;
-				_buffer = nullptr;
-			}
 		}
 
 		virtual jcanvas::jpoint_t<int> GetPreferredSize()
@@ -91,22 +77,10 @@ class GStreamerPlayerComponentImpl : public jcanvas::Component {
 		{
 			_mutex.lock();
 
-      if (_buffer == nullptr or _frame_size.x != width or _frame_size.y != height) {
+      if (_frame_size.x != width or _frame_size.y != height) {
 			  _frame_size.x = width;
 			  _frame_size.y = height;
 			
-        if (_buffer != nullptr) {
-          delete [] _buffer[0];
-          delete [] _buffer[1];
-
-          delete [] _buffer;
-        }
-
-        _buffer = new uint32_t*[2];
-
-        _buffer[0] = new uint32_t[width*height];
-        _buffer[1] = new uint32_t[width*height];
-
         if (_src.size.x < 0) {
 			    _src.size.x = _frame_size.x;
         }
@@ -116,10 +90,20 @@ class GStreamerPlayerComponentImpl : public jcanvas::Component {
         }
       }
 
-      memcpy(_buffer[(_buffer_index++)%2], data, width*height*4);
-
       _mutex.unlock();
 
+      std::shared_ptr<jcanvas::Image> &image = _mailbox.GetWriteBuffer();
+
+      if (image == nullptr or image->GetSize().x != width or image->GetSize().y != height) {
+        image = std::make_shared<jcanvas::BufferedImage>(jcanvas::jpixelformat_t::RGB32, jcanvas::jpoint_t<int>{width, height});
+      }
+
+      memcpy(image->LockData(), data, width*height*4);
+
+      image->UnlockData();
+
+      _mailbox.Publish();
+
       Repaint();
 		}
 
@@ -130,36 +114,36 @@ class GStreamerPlayerComponentImpl : public jcanvas::Component {
       jcanvas::jpoint_t<int>
         size = GetSize();
 
-			_mutex.lock();
+      _mailbox.Acquire();
 
-      if (_buffer == nullptr or _frame_size.x < 0 or _frame_size.y < 0) {
-        _mutex.unlock();
+      std::shared_ptr<jcanvas::Image> image = _mailbox.GetReadBuffer();
 
+      if (image == nullptr) {
         return;
       }
 
-			cairo_surface_t *surface = cairo_image_surface_create_for_data(
-					(uint8_t *)_buffer[(_buffer_index)%2], CAIRO_FORMAT_RGB24, _frame_size.x, _frame_size.y, cairo_format_stride_for_width(CAIRO_FORMAT_RGB24, _frame_size.x));
-			
-      std::shared_ptr<jcanvas::Image> image = std::make_shared<jcanvas::BufferedImage>(surface);
+      jcanvas::jpoint_t<int>
+        frame = image->GetSize();
+      jcanvas::jrect_t<int>
+        src;
 
-			_player->DispatchFrameGrabberEvent(new jmedia::FrameGrabberEvent(image, jmedia::jframeevent_type_t::Grab));
+      _mutex.lock();
+
+      src = _src;
 
-			cairo_surface_mark_dirty(surface);
+      _mutex.unlock();
+
+			_player->DispatchFrameGrabberEvent(new jmedia::FrameGrabberEvent(image, jmedia::jframeevent_type_t::Grab));
 
 	    g->SetAntialias(jcanvas::jantialias_t::None);
 	    g->SetCompositeFlags(jcanvas::jcomposite_flags_t::Src);
 	    g->SetBlittingFlags(jcanvas::jblitting_flags_t::Nearest);
 
-      if (_src.point.x == 0 and _src.point.y == 0 and _src.size.x == _frame_size.x and _src.size.y == _frame_size.y) {
+      if (src.point.x == 0 and src.point.y == 0 and src.size.x == frame.x and src.size.y == frame.y) {
 			  g->DrawImage(image, {0, 0, size.x, size.y});
       } else {
-			  g->DrawImage(image, _src, {0, 0, size.x, size.y});
+			  g->DrawImage(image, src, {0, 0, size.x, size.y});
       }
-
-			cairo_surface_destroy(surface);
-
-			_mutex.unlock();
 		}
 
 		virtual Player * GetPlayer()
@@ -23,6 +23,8 @@
 #include "jmedia/jvideoformatcontrol.h"
 #include "jmedia/jvolumecontrol.h"
 #include "jmedia/jaudioconfigurationcontrol.h"
+#include "jmedia/jimagepack.h"
+#include "jmedia/jframemailbox.h"
 
 #include "jcanvas/core/jbufferedimage.h"
 
@@ -30,19 +32,272 @@
 
 #include <algorithm>
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <filesystem>
+#include <unordered_map>
 
 #include <cairo.h>
 
+#if defined(ILIST_LIBJPEG)
+#include <jpeglib.h>
+#include <setjmp.h>
+#endif
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define ILIST_PLAYER_PREFETCH_DEPTH 4
+#define ILIST_PLAYER_PREFETCH_WORKERS 2
+#define ILIST_PLAYER_PREFETCH_BUDGET (64*1024*1024)
+#define ILIST_PLAYER_FRAME_DURATION 1000000
+#define ILIST_PLAYER_MAX_LATENESS 100000
+#define ILIST_PLAYER_MANIFEST "manifest"
+
 namespace jmedia {
 
+class PackStreamBuffer : public std::streambuf {
+
+	public:
+		PackStreamBuffer(const uint8_t *data, std::size_t size)
+		{
+			char *begin = (char *)data;
+
+			setg(begin, begin, begin + size);
+		}
+
+	protected:
+		virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode)
+		{
+			char *pos = gptr();
+
+			if (dir == std::ios_base::beg) {
+				pos = eback() + off;
+			} else if (dir == std::ios_base::cur) {
+				pos = gptr() + off;
+			} else if (dir == std::ios_base::end) {
+				pos = egptr() + off;
+			}
+
+			if (pos < eback() or pos > egptr()) {
+				return pos_type(off_type(-1));
+			}
+
+			setg(eback(), pos, egptr());
+
+			return pos_type(pos - eback());
+		}
+
+		virtual pos_type seekpos(pos_type pos, std::ios_base::openmode mode)
+		{
+			return seekoff(off_type(pos), std::ios_base::beg, mode);
+		}
+
+};
+
+struct PNGSource {
+	const uint8_t *data;
+	std::size_t size;
+};
+
+static cairo_status_t ReadPNG(void *closure, unsigned char *data, unsigned int length)
+{
+	PNGSource *source = (PNGSource *)closure;
+
+	if (length > source->size) {
+		return CAIRO_STATUS_READ_ERROR;
+	}
+
+	memcpy(data, source->data, length);
+
+	source->data = source->data + length;
+	source->size = source->size - length;
+
+	return CAIRO_STATUS_SUCCESS;
+}
+
+static cairo_surface_t * DecodePNG(const uint8_t *data, std::size_t size)
+{
+	PNGSource source {data, size};
+
+	cairo_surface_t *surface = cairo_image_surface_create_from_png_stream(ReadPNG, &source);
+
+	if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) {
+		cairo_surface_destroy(surface);
+
+		return nullptr;
+	}
+
+	return surface;
+}
+
+#if defined(ILIST_LIBJPEG)
+
+struct JPEGError {
+	struct jpeg_error_mgr manager;
+	jmp_buf jump;
+};
+
+static void ExitJPEG(j_common_ptr info)
+{
+	longjmp(((JPEGError *)info->err)->jump, 1);
+}
+
+static cairo_surface_t * DecodeJPEG(const uint8_t *data, std::size_t size, jcanvas::jpoint_t<int> target)
+{
+	struct jpeg_decompress_struct info;
+	JPEGError error;
+	cairo_surface_t * volatile surface = nullptr;
+
+	info.err = jpeg_std_error(&error.manager);
+	error.manager.error_exit = ExitJPEG;
+
+	if (setjmp(error.jump)) {
+		jpeg_destroy_decompress(&info);
+
+		if (surface != nullptr) {
+			cairo_surface_destroy(surface);
+		}
+
+		return nullptr;
+	}
+
+	jpeg_create_decompress(&info);
+	jpeg_mem_src(&info, (unsigned char *)data, size);
+	jpeg_read_header(&info, TRUE);
+
+	// scales in the dct domain by the largest factor that keeps the image above the target
+	info.scale_num = 1;
+	info.scale_denom = 1;
+
+	if (target.x > 0 and target.y > 0) {
+		for (int denom = 8; denom > 1; denom = denom/2) {
+			if ((int)((info.image_width + denom - 1)/denom) >= target.x and (int)((info.image_height + denom - 1)/denom) >= target.y) {
+				info.scale_denom = denom;
+
+				break;
+			}
+		}
+	}
+
+#if defined(JCS_EXTENSIONS) and __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	info.out_color_space = JCS_EXT_BGRX;
+#elif defined(JCS_EXTENSIONS)
+	info.out_color_space = JCS_EXT_XRGB;
+#else
+	info.out_color_space = JCS_RGB;
+#endif
+
+	jpeg_start_decompress(&info);
+
+	surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24, info.output_width, info.output_height);
+
+	cairo_surface_flush(surface);
+
+	uint8_t *pixels = cairo_image_surface_get_data(surface);
+	int stride = cairo_image_surface_get_stride(surface);
+
+	while (info.output_scanline < info.output_height) {
+		JSAMPROW row = pixels + info.output_scanline*stride;
+
+		jpeg_read_scanlines(&info, &row, 1);
+
+#if !defined(JCS_EXTENSIONS)
+		uint32_t *dst = (uint32_t *)row;
+
+		for (int i=info.output_width - 1; i>=0; i--) {
+			dst[i] = 0xff000000 | (row[3*i + 0] << 16) | (row[3*i + 1] << 8) | row[3*i + 2];
+		}
+#endif
+	}
+
+	jpeg_finish_decompress(&info);
+	jpeg_destroy_decompress(&info);
+
+	cairo_surface_mark_dirty(surface);
+
+	return surface;
+}
+
+#endif
+
+static cairo_surface_t * ReduceImage(cairo_surface_t *surface, jcanvas::jpoint_t<int> target)
+{
+	int 
+		sw = cairo_image_surface_get_width(surface),
+		sh = cairo_image_surface_get_height(surface),
+		factor = std::min(sw/std::max(target.x, 1), sh/std::max(target.y, 1));
+
+	if (target.x <= 0 or target.y <= 0 or factor < 2) {
+		return surface;
+	}
+
+	// averages each factor x factor block of the source in a single pass
+	int 
+		dw = sw/factor,
+		dh = sh/factor,
+		area = factor*factor;
+	cairo_surface_t *reduced = cairo_image_surface_create(cairo_image_surface_get_format(surface), dw, dh);
+
+	cairo_surface_flush(surface);
+	cairo_surface_flush(reduced);
+
+	const uint8_t *src = cairo_image_surface_get_data(surface);
+	uint8_t *dst = cairo_image_surface_get_data(reduced);
+	int 
+		sstride = cairo_image_surface_get_stride(surface),
+		dstride = cairo_image_surface_get_stride(reduced);
+	std::vector<uint32_t> sums(dw*4);
+
+	for (int j=0; j<dh; j++) {
+		std::fill(sums.begin(), sums.end(), 0);
+
+		for (int k=0; k<factor; k++) {
+			const uint8_t *line = src + (j*factor + k)*sstride;
+
+			for (int i=0; i<dw*factor; i++) {
+				uint32_t *sum = sums.data() + (i/factor)*4;
+
+				sum[0] += line[4*i + 0];
+				sum[1] += line[4*i + 1];
+				sum[2] += line[4*i + 2];
+				sum[3] += line[4*i + 3];
+			}
+		}
+
+		uint8_t *line = dst + j*dstride;
+
+		for (int i=0; i<dw*4; i++) {
+			line[i] = (uint8_t)((sums[i] + area/2)/area);
+		}
+	}
+
+	cairo_surface_mark_dirty(reduced);
+	cairo_surface_destroy(surface);
+
+	return reduced;
+}
+
+static std::size_t GetFrameBytes(std::shared_ptr<jcanvas::Image> frame)
+{
+	if (frame == nullptr) {
+		return 0;
+	}
+
+	jcanvas::jpoint_t<int> size = frame->GetSize();
+
+	return size.x*size.y*sizeof(uint32_t);
+}
+
 class IlistPlayerComponentImpl : public jcanvas::Component {
 
 	public:
 		/** \brief */
 		Player *_player;
 		/** \brief */
-    std::shared_ptr<jcanvas::Image> _image;
+		FrameMailbox<std::shared_ptr<jcanvas::Image>> _mailbox;
 		/** \brief */
     std::mutex _mutex;
 		/** \brief */
@@ -51,17 +306,20 @@ class IlistPlayerComponentImpl : public jcanvas::Component {
 		jcanvas::jrect_t<int> _dst;
 		/** \brief */
 		jcanvas::jpoint_t<int> _frame_size;
+		/** \brief */
+		bool _is_source_set;
 
 	public:
 		IlistPlayerComponentImpl(Player *player, int x, int y, int w, int h):
 			jcanvas::Component({x, y, w, h})
 		{
-			_image = nullptr;
 			_player = player;
 			
 			_frame_size.x = w;
 			_frame_size.y = h;
 
+			_is_source_set = false;
+
 			_src = {
         0, 0, w, h
       };
@@ -75,7 +333,6 @@ class IlistPlayerComponentImpl : public jcanvas::Component {
 
 		virtual ~IlistPlayerComponentImpl()
 		{
-			_image = nullptr;
 		}
 
 		virtual jcanvas::jpoint_t<int> GetPreferredSize()
@@ -87,19 +344,23 @@ class IlistPlayerComponentImpl : public jcanvas::Component {
 		{
 			jcanvas::jpoint_t<int> isize = frame->GetSize();
 
+			_mutex.lock();
+
 			if (_frame_size.x != isize.x || _frame_size.y != isize.y) {
-				if (_frame_size.x < 0 || _frame_size.y < 0) {
-					_src.size = isize;
+				// the frames follow the size of the component, so the source follows them until it is set
+				if (_frame_size.x < 0 || _frame_size.y < 0 || _is_source_set == false) {
+					_src = {0, 0, isize.x, isize.y};
 				}
 
 				_frame_size = isize;
 			}
 
-			_player->DispatchFrameGrabberEvent(new jmedia::FrameGrabberEvent(frame, jmedia::jframeevent_type_t::Grab));
+			_mutex.unlock();
 
-			_mutex.lock();
+			_player->DispatchFrameGrabberEvent(new jmedia::FrameGrabberEvent(frame, jmedia::jframeevent_type_t::Grab));
 
-			_image = frame;
+			_mailbox.GetWriteBuffer() = frame;
+			_mailbox.Publish();
 
 			Repaint();
 		}
@@ -108,22 +369,35 @@ class IlistPlayerComponentImpl : public jcanvas::Component {
 		{
 			jcanvas::Component::Paint(g);
 
+      _mailbox.Acquire();
+
+      std::shared_ptr<jcanvas::Image> image = _mailbox.GetReadBuffer();
+
+      if (image == nullptr) {
+        return;
+      }
+
       jcanvas::jpoint_t<int>
-        size = GetSize();
+        size = GetSize(),
+        frame = image->GetSize();
+      jcanvas::jrect_t<int>
+        src;
+
+      _mutex.lock();
+
+      src = _src;
+
+      _mutex.unlock();
 
 	    g->SetAntialias(jcanvas::jantialias_t::None);
 	    g->SetCompositeFlags(jcanvas::jcomposite_flags_t::Src);
 	    g->SetBlittingFlags(jcanvas::jblitting_flags_t::Nearest);
 
-      if (_src.point.x == 0 and _src.point.y == 0 and _src.size.x == _frame_size.x and _src.size.y == _frame_size.y) {
-			  g->DrawImage(_image, {0, 0, size.x, size.y});
+      if (src.point.x == 0 and src.point.y == 0 and src.size.x == frame.x and src.size.y == frame.y) {
+			  g->DrawImage(image, {0, 0, size.x, size.y});
       } else {
-			  g->DrawImage(_image, _src, {0, 0, size.x, size.y});
+			  g->DrawImage(image, src, {0, 0, size.x, size.y});
       }
-				
-      _image = nullptr;
-
-			_mutex.unlock();
 		}
 
 		virtual Player * GetPlayer()
@@ -159,6 +433,8 @@ class IlistVideoSizeControlImpl : public VideoSizeControl {
         x, y, w, h
       };
 
+			impl->_is_source_set = true;
+
       impl->_mutex.unlock();
 		}
 
@@ -199,6 +475,17 @@ ImageListLightPlayer::ImageListLightPlayer(std::string uri):
 	_media_time = 0LL;
 	_decode_rate = 1.0;
 	_frame_index = 0;
+	_ready_bytes = 0;
+	_prefetch_budget = ILIST_PLAYER_PREFETCH_BUDGET;
+	_prefetch_depth = ILIST_PLAYER_PREFETCH_DEPTH;
+	_prefetch_sequence = 0;
+	_present_sequence = 0;
+	_generation = 0;
+	_is_prefetching = false;
+	_frame_duration = ILIST_PLAYER_FRAME_DURATION;
+	_current_time = 0LL;
+	_seek_offset = 0LL;
+	_is_resync = true;
 	
   std::filesystem::directory_entry entry {_directory};
 
@@ -206,21 +493,29 @@ ImageListLightPlayer::ImageListLightPlayer(std::string uri):
 		throw std::runtime_error("Media directory no exists");
 	}
 
-  for (auto const &entry : std::filesystem::directory_iterator(_directory)) {
-    _image_list.push_back(entry.path().string());
-  }
+	if (entry.is_regular_file() == true) {
+		OpenPack(_directory);
+	} else {
+		for (auto const &entry : std::filesystem::directory_iterator(_directory)) {
+			if (entry.path().filename() == ILIST_PLAYER_MANIFEST) {
+				continue;
+			}
 
-	if (_image_list.size() == 0) {
-		throw std::runtime_error("There is no file in the directory");
-	}
+			_image_list.push_back(entry.path().string());
+		}
+
+		if (_image_list.size() == 0) {
+			throw std::runtime_error("There is no file in the directory");
+		}
+
+		std::sort(_image_list.begin(), _image_list.end());
 
-	std::sort(_image_list.begin(), _image_list.end(), [](std::string a, std::string b) {
-    if (a < b) {
-      return true;
-    }
+		_durations.assign(_image_list.size(), 0LL);
 
-    return false;
-  });
+		LoadManifest((std::filesystem::path(_directory) / ILIST_PLAYER_MANIFEST).string());
+	}
+
+	UpdateTimeline();
 
 	_controls.push_back(new IlistVideoSizeControlImpl(this));
 
@@ -233,6 +528,10 @@ ImageListLightPlayer::~ImageListLightPlayer()
 	
 	_component = nullptr;
 
+	if (_pack != nullptr) {
+		munmap(_pack, _pack_size);
+	}
+
   while (_controls.size() > 0) {
     Control *control = *_controls.begin();
 
@@ -244,58 +543,418 @@ ImageListLightPlayer::~ImageListLightPlayer()
 
 void ImageListLightPlayer::ResetFrames()
 {
-	_frame_index = 0;
+	SetCurrentTime(0LL);
 }
 
-std::shared_ptr<jcanvas::Image> ImageListLightPlayer::GetFrame()
+void ImageListLightPlayer::LoadManifest(std::string file)
 {
-  std::string file = _image_list[_frame_index++];
+	std::ifstream stream(file);
+	std::string line;
+	std::unordered_map<std::string, std::size_t> indexes;
 
-  if (_frame_index >= (int)_image_list.size()) {
-    _frame_index = 0;
-  }
+	// the images are looked up by name, so a manifest costs one pass over the list and one over its lines
+	indexes.reserve(_image_list.size());
+
+	for (std::size_t i=0; i<_image_list.size(); i++) {
+		indexes[std::filesystem::path(_image_list[i]).filename().string()] = i;
+	}
 
-  return std::make_shared<jcanvas::BufferedImage>(file);
+	// each line has the name of an image and how long it is presented, in milliseconds
+	while (std::getline(stream, line)) {
+		std::istringstream tokens(line);
+		std::string name;
+		double ms;
+
+		if (!(tokens >> name) or name[0] == '#' or !(tokens >> ms) or ms < 0.0) {
+			continue;
+		}
+
+		auto i = indexes.find(name);
+
+		if (i != indexes.end()) {
+			_durations[i->second] = (uint64_t)(ms*1000.0);
+		}
+	}
+}
+
+void ImageListLightPlayer::UpdateTimeline()
+{
+	_timeline.resize(_image_list.size() + 1);
+	_timeline[0] = 0LL;
+
+	for (std::size_t i=0; i<_image_list.size(); i++) {
+		_timeline[i + 1] = _timeline[i] + ((_durations[i] != 0LL)?_durations[i]:_frame_duration);
+	}
+}
+
+void ImageListLightPlayer::SetFrameRate(double fps)
+{
+	if (fps <= 0.0) {
+		return;
+	}
+
+  std::unique_lock<std::mutex> lock(_mutex);
+
+	_frame_duration = (uint64_t)(1000000.0/fps);
+
+	UpdateTimeline();
+}
+
+double ImageListLightPlayer::GetFrameRate()
+{
+	return 1000000.0/_frame_duration;
+}
+
+void ImageListLightPlayer::OpenPack(std::string file)
+{
+	int fd = open(file.c_str(), O_RDONLY);
+
+	if (fd < 0) {
+		throw std::runtime_error("Unable to open the image pack");
+	}
+
+	struct stat st;
+
+	if (fstat(fd, &st) < 0 or (std::size_t)st.st_size < sizeof(jimagepack_header_t)) {
+		close(fd);
+
+		throw std::runtime_error("This file is not a valid image pack");
+	}
+
+	// only the pages of the images being decoded are read, so opening does not depend on the number of images
+	void *ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	close(fd);
+
+	if (ptr == MAP_FAILED) {
+		throw std::runtime_error("Unable to map the image pack");
+	}
+
+	const jimagepack_header_t *header = (const jimagepack_header_t *)ptr;
+
+	// the pack is mapped as it is, so the version read in the wrong byte order rejects it
+	if (memcmp(header->magic, JMEDIA_IMAGEPACK_MAGIC, 4) != 0 or header->version != JMEDIA_IMAGEPACK_VERSION or 
+			header->count == 0 or header->count > (st.st_size - sizeof(jimagepack_header_t))/sizeof(jimagepack_entry_t)) {
+		munmap(ptr, st.st_size);
+
+		throw std::runtime_error("This file is not a valid image pack");
+	}
+
+	_pack = (uint8_t *)ptr;
+	_pack_size = st.st_size;
+}
+
+uint64_t ImageListLightPlayer::GetFrameCount()
+{
+	if (_pack != nullptr) {
+		return ((const jimagepack_header_t *)_pack)->count;
+	}
+
+	return _image_list.size();
+}
+
+uint64_t ImageListLightPlayer::GetFrameStart(uint64_t index)
+{
+	if (_pack != nullptr) {
+		const jimagepack_header_t *header = (const jimagepack_header_t *)_pack;
+
+		if (index >= header->count) {
+			return header->duration;
+		}
+
+		// the pack is not scanned when it is opened, so a corrupt start is clamped where it is read
+		return std::min(((const jimagepack_entry_t *)(header + 1))[index].start, header->duration);
+	}
+
+	return _timeline[index];
+}
+
+std::shared_ptr<jcanvas::Image> ImageListLightPlayer::GetFrame(int index, jcanvas::jpoint_t<int> size)
+{
+	std::vector<uint8_t> content;
+	const uint8_t *data = nullptr;
+	std::size_t length = 0;
+
+	if (_pack != nullptr) {
+		const jimagepack_entry_t *entry = (const jimagepack_entry_t *)(_pack + sizeof(jimagepack_header_t)) + index;
+
+		if (entry->offset > _pack_size or entry->size > _pack_size - entry->offset) {
+			return nullptr;
+		}
+
+		data = _pack + entry->offset;
+		length = entry->size;
+	} else {
+		std::ifstream stream(_image_list[index], std::ios::binary);
+
+		content.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+
+		data = content.data();
+		length = content.size();
+	}
+
+	// jpeg and png are decoded here, reduced to the size of the component, so the frames are kept at display resolution
+	cairo_surface_t *surface = nullptr;
+
+#if defined(ILIST_LIBJPEG)
+	if (length > 3 and data[0] == 0xff and data[1] == 0xd8 and data[2] == 0xff) {
+		surface = DecodeJPEG(data, length, size);
+	}
+#endif
+
+	if (length > 8 and memcmp(data, "\x89PNG\r\n\x1a\n", 8) == 0) {
+		surface = DecodePNG(data, length);
+	}
+
+	if (surface != nullptr) {
+		surface = ReduceImage(surface, size);
+
+		std::shared_ptr<jcanvas::Image> image = std::make_shared<jcanvas::BufferedImage>(surface);
+
+		cairo_surface_destroy(surface);
+
+		return image;
+	}
+
+	try {
+		PackStreamBuffer buffer(data, length);
+		std::istream stream(&buffer);
+
+		std::shared_ptr<jcanvas::Image> image = std::make_shared<jcanvas::BufferedImage>(stream);
+		jcanvas::jpoint_t<int> isize = image->GetSize();
+
+		// the other formats are decoded at full size by jcanvas, and go through the same reduction before they are cached
+		uint8_t *pixels = image->LockData();
+		cairo_surface_t *reduced = nullptr;
+
+		if (pixels != nullptr) {
+			cairo_surface_t *surface = cairo_image_surface_create_for_data(pixels, CAIRO_FORMAT_ARGB32, isize.x, isize.y, isize.x*sizeof(uint32_t));
+
+			reduced = ReduceImage(surface, size);
+
+			if (reduced == surface) {
+				cairo_surface_destroy(surface);
+
+				reduced = nullptr;
+			}
+		}
+
+		image->UnlockData();
+
+		if (reduced != nullptr) {
+			image = std::make_shared<jcanvas::BufferedImage>(reduced);
+
+			cairo_surface_destroy(reduced);
+		}
+
+		return image;
+	} catch (std::runtime_error &e) {
+	}
+
+	return nullptr;
+}
+
+void ImageListLightPlayer::SetPrefetchDepth(int depth)
+{
+  std::unique_lock<std::mutex> lock(_mutex);
+
+	_prefetch_depth = std::max(depth, 1);
+
+	_prefetch_condition.notify_all();
+}
+
+int ImageListLightPlayer::GetPrefetchDepth()
+{
+	return _prefetch_depth;
+}
+
+void ImageListLightPlayer::SetPrefetchBudget(std::size_t bytes)
+{
+  std::unique_lock<std::mutex> lock(_mutex);
+
+	_prefetch_budget = bytes;
+
+	_prefetch_condition.notify_all();
+}
+
+std::size_t ImageListLightPlayer::GetPrefetchBudget()
+{
+	return _prefetch_budget;
+}
+
+void ImageListLightPlayer::Prefetch()
+{
+  std::unique_lock<std::mutex> lock(_mutex);
+
+	uint64_t size = GetFrameCount();
+
+	while (_is_prefetching == true) {
+		// the budget always allows one image, otherwise a large one would stall the playback
+		if ((_is_loop == false and _prefetch_sequence >= size) or 
+				(_prefetch_sequence - _present_sequence) >= (uint64_t)_prefetch_depth or 
+				(_ready_bytes >= _prefetch_budget and _ready.empty() == false)) {
+			_prefetch_condition.wait(lock);
+
+			continue;
+		}
+
+		uint64_t 
+			sequence = _prefetch_sequence++,
+			generation = _generation;
+		IlistPlayerComponentImpl 
+			*impl = dynamic_cast<IlistPlayerComponentImpl *>(_component);
+		jcanvas::jpoint_t<int> 
+			target = {-1, -1};
+
+		// a source area is given in pixels of the original image, so it disables the reduction
+		if (impl->_is_source_set == false) {
+			target = impl->GetSize();
+		}
+
+		lock.unlock();
+
+		std::shared_ptr<jcanvas::Image> frame = GetFrame(sequence % size, target);
+
+		lock.lock();
+
+		if (generation != _generation) {
+			continue;
+		}
+
+		_ready[sequence] = frame;
+		_ready_bytes = _ready_bytes + GetFrameBytes(frame);
+
+		_condition.notify_all();
+	}
 }
 
 void ImageListLightPlayer::Run()
 {
-  std::shared_ptr<jcanvas::Image> frame;
+  std::unique_lock<std::mutex> lock(_mutex);
 
-	while (_is_playing == true) {
-    std::unique_lock<std::mutex> lock(_mutex);
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now();
+	std::chrono::duration<double, std::micro> remaining {0.0};
+	uint64_t size = GetFrameCount();
+	double rate = (_is_paused == true)?0.0:_decode_rate;
+	bool finished = false;
 
-		frame = GetFrame();
+	_is_prefetching = true;
 
-		if (frame == nullptr) { 
-			ResetFrames();
+	for (int i=0; i<std::min(_prefetch_depth, ILIST_PLAYER_PREFETCH_WORKERS); i++) {
+		_workers.emplace_back(&ImageListLightPlayer::Prefetch, this);
+	}
 
-			if (_is_loop == false) {
-				DispatchPlayerEvent(new jmedia::PlayerEvent(this, jmedia::jplayerevent_type_t::Finish));
+	while (_is_playing == true) {
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		double current = (_is_paused == true)?0.0:_decode_rate;
 
-				break;
+		// keeps the media time left to the next image when the rate changes or the playback is paused
+		if (current != rate) {
+			if (rate != 0.0) {
+				remaining = (deadline - now)*rate;
 			}
+
+			if (current != 0.0) {
+				deadline = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(remaining/current);
+			}
+
+			rate = current;
+		}
+
+		if (_is_resync == true) {
+			_is_resync = false;
+
+			deadline = now;
+		}
+
+		if (rate == 0.0) {
+			_condition.wait(lock);
+
+			continue;
+		}
+
+		if (now < deadline) {
+			_condition.wait_until(lock, deadline);
+
+			continue;
+		}
+
+		if (_is_loop == false and _present_sequence >= size) {
+			finished = true;
+
+			break;
+		}
+
+		// the images are decoded by the workers, so only the presentation time is waited here
+		auto i = _ready.find(_present_sequence);
+
+		if (i == _ready.end()) {
+			_condition.wait(lock);
+
+			continue;
+		}
+
+		std::shared_ptr<jcanvas::Image> frame = i->second;
+		uint64_t 
+			index = _present_sequence % size,
+			generation = _generation;
+
+		_ready_bytes = _ready_bytes - GetFrameBytes(frame);
+		_ready.erase(i);
+		_frame_index = index;
+		_present_sequence = _present_sequence + 1;
+
+		_prefetch_condition.notify_all();
+
+		if (frame == nullptr) {
+			continue;
 		}
 
+		lock.unlock();
+
     dynamic_cast<IlistPlayerComponentImpl *>(_component)->UpdateComponent(frame);
 
-		try {
-			if (_decode_rate == 0) {
-				_condition.wait(lock);
-			} else {
-				uint64_t us;
+		lock.lock();
 
-				us = 1000000; // 1.0 frame/sec
+		if (generation != _generation) {
+			continue;
+		}
 
-				if (_decode_rate != 1.0) {
-					us = ((double)us / _decode_rate + 0.);
-				}
+		uint64_t 
+			start = GetFrameStart(index),
+			end = GetFrameStart(index + 1),
+			// starts that go back, as in a corrupt pack, give the image no time instead of an underflow
+			duration = (end > start)?end - start:0,
+			offset = std::min(_seek_offset, duration);
 
-        _condition.wait_for(lock, std::chrono::microseconds(us));
-			}
-		} catch (std::runtime_error &e) {
+		_current_time = start + offset;
+		_seek_offset = 0LL;
+
+		// the deadlines are absolute, so the time spent to present an image does not accumulate
+		deadline = deadline + std::chrono::microseconds((uint64_t)((duration - offset)/rate));
+
+		if (deadline + std::chrono::microseconds(ILIST_PLAYER_MAX_LATENESS) < std::chrono::steady_clock::now()) {
+			deadline = std::chrono::steady_clock::now();
 		}
 	}
+
+	_is_prefetching = false;
+
+	_prefetch_condition.notify_all();
+
+	lock.unlock();
+
+	for (auto &worker : _workers) {
+		worker.join();
+	}
+
+	_workers.clear();
+
+	if (finished == true) {
+		ResetFrames();
+
+		DispatchPlayerEvent(new jmedia::PlayerEvent(this, jmedia::jplayerevent_type_t::Finish));
+	}
 }
 
 void ImageListLightPlayer::Play()
@@ -320,9 +979,8 @@ void ImageListLightPlayer::Pause()
 	if (_is_paused == false) {
 		_is_paused = true;
 		
-		_decode_rate = GetDecodeRate();
-
-		SetDecodeRate(0.0);
+		// the rate is kept, so the presentation clock continues from the same point on resume
+		_condition.notify_all();
 		
 		DispatchPlayerEvent(new jmedia::PlayerEvent(this, jmedia::jplayerevent_type_t::Pause));
 	}
@@ -337,7 +995,7 @@ void ImageListLightPlayer::Resume()
 	if (_is_paused == true) {
 		_is_paused = false;
 		
-		SetDecodeRate(_decode_rate);
+		_condition.notify_all();
 		
 		DispatchPlayerEvent(new jmedia::PlayerEvent(this, jmedia::jplayerevent_type_t::Resume));
 	}
@@ -348,7 +1006,10 @@ void ImageListLightPlayer::Resume()
 void ImageListLightPlayer::Stop()
 {
   if (_is_playing == true) {
+    _mutex.lock();
     _is_playing = false;
+		_condition.notify_all();
+    _mutex.unlock();
 
     _thread.join();
   }
@@ -369,23 +1030,58 @@ void ImageListLightPlayer::Close()
 	_is_closed = true;
 }
 
-void ImageListLightPlayer::SetCurrentTime(uint64_t)
+void ImageListLightPlayer::SetCurrentTime(uint64_t time)
 {
+  std::unique_lock<std::mutex> lock(_mutex);
+
+	uint64_t 
+		count = GetFrameCount(),
+		us = std::min<uint64_t>(time*1000LL, GetFrameStart(count) - 1),
+		index = 0;
+
+	// jumps to the last image starting before the time, the images before it are never decoded
+	for (uint64_t step = count; step > 0; step = step/2) {
+		while (index + step < count and GetFrameStart(index + step) <= us) {
+			index = index + step;
+		}
+	}
+
+	// the images being decoded belong to the old generation and are discarded when they are done
+	_ready.clear();
+	_ready_bytes = 0;
+	_prefetch_sequence = index;
+	_present_sequence = index;
+	_generation = _generation + 1;
+	_frame_index = index;
+	_current_time = us;
+	_seek_offset = us - std::min(us, GetFrameStart(index));
+	_is_resync = true;
+
+	_prefetch_condition.notify_all();
+	_condition.notify_all();
 }
 
 uint64_t ImageListLightPlayer::GetCurrentTime()
 {
-	return -1LL;
+  std::unique_lock<std::mutex> lock(_mutex);
+
+	return _current_time/1000LL;
 }
 
 uint64_t ImageListLightPlayer::GetMediaTime()
 {
-	return -1LL;
+  std::unique_lock<std::mutex> lock(_mutex);
+
+	return GetFrameStart(GetFrameCount())/1000LL;
 }
 
 void ImageListLightPlayer::SetLoop(bool b)
 {
+  std::unique_lock<std::mutex> lock(_mutex);
+
 	_is_loop = b;
+
+	_prefetch_condition.notify_all();
 }
 
 bool ImageListLightPlayer::IsLoop()
@@ -399,9 +1095,9 @@ void ImageListLightPlayer::SetDecodeRate(double rate)
 
 	if (_decode_rate != 0.0) {
 		_is_paused = false;
-			
-		_condition.notify_one();
 	}
+
+	_condition.notify_all();
 }
 
 double ImageListLightPlayer::GetDecodeRate()
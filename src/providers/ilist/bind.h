@@ -26,6 +26,8 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <vector>
+#include <map>
 
 namespace jmedia {
 
@@ -64,6 +66,42 @@ class ImageListLightPlayer : public Player {
 		bool _is_playing;
 		/** \brief */
 		int _frame_index;
+		/** \brief */
+		std::vector<std::thread> _workers;
+		/** \brief */
+    std::condition_variable _prefetch_condition;
+		/** \brief */
+		std::map<uint64_t, std::shared_ptr<jcanvas::Image>> _ready;
+		/** \brief */
+		std::size_t _ready_bytes;
+		/** \brief */
+		std::size_t _prefetch_budget;
+		/** \brief */
+		int _prefetch_depth;
+		/** \brief */
+		uint64_t _prefetch_sequence;
+		/** \brief */
+		uint64_t _present_sequence;
+		/** \brief */
+		uint64_t _generation;
+		/** \brief */
+		bool _is_prefetching;
+		/** \brief */
+		std::vector<uint64_t> _durations;
+		/** \brief */
+		std::vector<uint64_t> _timeline;
+		/** \brief */
+		uint64_t _frame_duration;
+		/** \brief */
+		uint64_t _current_time;
+		/** \brief */
+		uint64_t _seek_offset;
+		/** \brief */
+		bool _is_resync;
+		/** \brief */
+		uint8_t *_pack {nullptr};
+		/** \brief */
+		std::size_t _pack_size {0};
 
 	public:
 		/**
@@ -162,11 +200,85 @@ class ImageListLightPlayer : public Player {
 		 */
 		virtual void ResetFrames();
 
+		/**
+		 * \brief Sets the rate used by the images without a duration in the manifest.
+		 *
+		 */
+		virtual void SetFrameRate(double fps);
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual double GetFrameRate();
+
+		/**
+		 * \brief Reads the durations of the images from the manifest of the directory.
+		 *
+		 */
+		virtual void LoadManifest(std::string file);
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual void UpdateTimeline();
+
+		/**
+		 * \brief Maps a packed image sequence instead of reading a directory.
+		 *
+		 */
+		virtual void OpenPack(std::string file);
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual uint64_t GetFrameCount();
+
+		/**
+		 * \brief Returns when the image 'index' starts, in microseconds. The index
+		 * GetFrameCount() returns the media time.
+		 *
+		 */
+		virtual uint64_t GetFrameStart(uint64_t index);
+
+		/**
+		 * \brief Sets how many images are decoded ahead of the one being presented.
+		 *
+		 */
+		virtual void SetPrefetchDepth(int depth);
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual int GetPrefetchDepth();
+
+		/**
+		 * \brief Sets the maximum size, in bytes, of the decoded images waiting to be presented.
+		 *
+		 */
+		virtual void SetPrefetchBudget(std::size_t bytes);
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual std::size_t GetPrefetchBudget();
+
+		/**
+		 * \brief Decodes the image 'index' of the list. When 'size' is valid, the
+		 * image is reduced while decoded, but never below it.
+		 *
+		 */
+		virtual std::shared_ptr<jcanvas::Image> GetFrame(int index, jcanvas::jpoint_t<int> size = {-1, -1});
+
 		/**
 		 * \brief
 		 *
 		 */
-		virtual std::shared_ptr<jcanvas::Image> GetFrame();
+		virtual void Prefetch();
 
 		/**
 		 * \brief
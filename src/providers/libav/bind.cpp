@@ -23,12 +23,13 @@
 #include "jmedia/jvideosizecontrol.h"
 #include "jmedia/jvideoformatcontrol.h"
 #include "jmedia/jvolumecontrol.h"
+#include "jmedia/jframemailbox.h"
 
 #include "jcanvas/core/jbufferedimage.h"
 
 #include "jdemux/jurl.h"
 
-#include <cairo.h>
+#include <cstring>
 
 namespace jmedia {
 
@@ -38,21 +39,20 @@ class LibavPlayerComponentImpl : public jcanvas::Component {
 		/** \brief */
 		Player *_player;
 		/** \brief */
-		cairo_surface_t *_surface;
-		/** \brief */
     std::mutex _mutex;
 		/** \brief */
 		jcanvas::jrect_t<int> _src;
 		/** \brief */
 		jcanvas::jrect_t<int> _dst;
 		/** \brief */
+		FrameMailbox<std::shared_ptr<jcanvas::Image>> _mailbox;
+		/** \brief */
 		jcanvas::jpoint_t<int> _frame_size;
 
 	public:
 		LibavPlayerComponentImpl(Player *player, int x, int y, int w, int h):
 			jcanvas::Component({x, y, w, h})
 		{
-			_surface = nullptr;
 			_player = player;
 			
 			_frame_size.x = w;
@@ -71,9 +71,6 @@ class LibavPlayerComponentImpl : public jcanvas::Component {
 
 		virtual ~LibavPlayerComponentImpl()
 		{
-      if (_surface != nullptr) {
-        cairo_surface_destroy(_surface);
-      }
 		}
 
 		virtual jcanvas::jpoint_t<int> GetPreferredSize()
@@ -87,6 +84,8 @@ class LibavPlayerComponentImpl : public jcanvas::Component {
 				return;
 			}
 
+			_mutex.lock();
+
 			if (_src.size.x <= 0 || _src.size.y <= 0) {
 				dynamic_cast<LibAVLightPlayer *>(_player)->_aspect = (double)width/(double)height;
 
@@ -94,15 +93,20 @@ class LibavPlayerComponentImpl : public jcanvas::Component {
 				_frame_size.y = _src.size.y = height;
 			}
 
-			int sw = width;
-			int sh = height;
+      _mutex.unlock();
 
-			_mutex.lock();
+      // the decoder reuses its buffer as soon as the callback returns
+      std::shared_ptr<jcanvas::Image> &image = _mailbox.GetWriteBuffer();
 
-			_surface = cairo_image_surface_create_for_data(
-					(uint8_t *)buffer, CAIRO_FORMAT_RGB24, sw, sh, cairo_format_stride_for_width(CAIRO_FORMAT_RGB24, sw));
-			
-      _mutex.unlock();
+      if (image == nullptr or image->GetSize().x != width or image->GetSize().y != height) {
+        image = std::make_shared<jcanvas::BufferedImage>(jcanvas::jpixelformat_t::RGB32, jcanvas::jpoint_t<int>{width, height});
+      }
+
+      memcpy(image->LockData(), buffer, width*height*4);
+
+      image->UnlockData();
+
+      _mailbox.Publish();
 
       Repaint();
 		}
@@ -111,38 +115,37 @@ class LibavPlayerComponentImpl : public jcanvas::Component {
 		{
 			jcanvas::Component::Paint(g);
 
-      jcanvas::jpoint_t<int>
-        size = GetSize();
-
-			_mutex.lock();
+      _mailbox.Acquire();
 
-      if (_surface == nullptr) {
-        _mutex.unlock();
+      std::shared_ptr<jcanvas::Image> image = _mailbox.GetReadBuffer();
 
+      if (image == nullptr) {
         return;
       }
 
-      std::shared_ptr<jcanvas::Image> image = std::make_shared<jcanvas::BufferedImage>(_surface);
+      jcanvas::jpoint_t<int>
+        size = GetSize(),
+        frame = image->GetSize();
+      jcanvas::jrect_t<int>
+        src;
 
-			_player->DispatchFrameGrabberEvent(new jmedia::FrameGrabberEvent(image, jmedia::jframeevent_type_t::Grab));
+      _mutex.lock();
+
+      src = _src;
 
-			cairo_surface_mark_dirty(_surface);
+      _mutex.unlock();
+
+			_player->DispatchFrameGrabberEvent(new jmedia::FrameGrabberEvent(image, jmedia::jframeevent_type_t::Grab));
 
 	    g->SetAntialias(jcanvas::jantialias_t::None);
 	    g->SetCompositeFlags(jcanvas::jcomposite_flags_t::Src);
 	    g->SetBlittingFlags(jcanvas::jblitting_flags_t::Nearest);
 
-      if (_src.point.x == 0 and _src.point.y == 0 and _src.size.x == _frame_size.x and _src.size.y == _frame_size.y) {
+      if (src.point.x == 0 and src.point.y == 0 and src.size.x == frame.x and src.size.y == frame.y) {
 			  g->DrawImage(image, {0, 0, size.x, size.y});
       } else {
-			  g->DrawImage(image, _src, {0, 0, size.x, size.y});
+			  g->DrawImage(image, src, {0, 0, size.x, size.y});
       }
-
-      cairo_surface_destroy(_surface);
-
-      _surface = nullptr;
-
-			_mutex.unlock();
 		}
 
 		virtual Player * GetPlayer()
@@ -23,6 +23,7 @@
 #include "jmedia/jvideoformatcontrol.h"
 #include "jmedia/jvolumecontrol.h"
 #include "jmedia/jaudioconfigurationcontrol.h"
+#include "jmedia/jframemailbox.h"
 
 #include "jcanvas/core/jbufferedimage.h"
 
@@ -30,8 +31,6 @@
 
 #include <vlc/vlc.h>
 
-#include <cairo.h>
-
 namespace jmedia {
 
 static libvlc_event_type_t mi_events[] = {
@@ -106,17 +105,13 @@ class LibvlcPlayerComponentImpl : public jcanvas::Component {
 		/** \brief */
 		Player *_player;
 		/** \brief */
-		cairo_surface_t *_surface;
-		/** \brief */
     std::mutex _mutex;
 		/** \brief */
 		jcanvas::jrect_t<int> _src;
 		/** \brief */
 		jcanvas::jrect_t<int> _dst;
 		/** \brief */
-    std::shared_ptr<jcanvas::Image> _buffer[2];
-		/** \brief */
-		int _buffer_index;
+		FrameMailbox<std::shared_ptr<jcanvas::Image>> _mailbox;
 		/** \brief */
 		jcanvas::jpoint_t<int> _frame_size;
 
@@ -124,12 +119,6 @@ class LibvlcPlayerComponentImpl : public jcanvas::Component {
 		LibvlcPlayerComponentImpl(Player *player, int x, int y, int w, int h):
 			jcanvas::Component({x, y, w, h})
 		{
-			_buffer[0] = std::make_shared<jcanvas::BufferedImage>(jcanvas::jpixelformat_t::RGB32, jcanvas::jpoint_t<int>{w, h});
-			_buffer[1] = std::make_shared<jcanvas::BufferedImage>(jcanvas::jpixelformat_t::RGB32, jcanvas::jpoint_t<int>{w, h});
-
-      _buffer_index = 0;
-
-			_surface = nullptr;
 			_player = player;
 			
 			_frame_size.x = w;
@@ -148,9 +137,6 @@ class LibvlcPlayerComponentImpl : public jcanvas::Component {
 
 		virtual ~LibvlcPlayerComponentImpl()
 		{
-      if (_surface != nullptr) {
-        cairo_surface_destroy(_surface);
-      }
 		}
 
 		virtual jcanvas::jpoint_t<int> GetPreferredSize()
@@ -162,12 +148,24 @@ class LibvlcPlayerComponentImpl : public jcanvas::Component {
 		{
 			// jcanvas::Component::Paint(g);
 
+      _mailbox.Acquire();
+
+      std::shared_ptr<jcanvas::Image> image = _mailbox.GetReadBuffer();
+
+      if (image == nullptr) {
+        return;
+      }
+
       jcanvas::jpoint_t<int>
         size = GetSize();
+      jcanvas::jrect_t<int>
+        src;
+
+      _mutex.lock();
 
-      std::shared_ptr<jcanvas::Image> image = _buffer[(_buffer_index + 1)%2];
+      src = _src;
 
-      image->LockData();
+      _mutex.unlock();
 
 			_player->DispatchFrameGrabberEvent(new jmedia::FrameGrabberEvent(image, jmedia::jframeevent_type_t::Grab));
 
@@ -175,13 +173,11 @@ class LibvlcPlayerComponentImpl : public jcanvas::Component {
 	    g->SetCompositeFlags(jcanvas::jcomposite_flags_t::Src);
 	    g->SetBlittingFlags(jcanvas::jblitting_flags_t::Nearest);
 
-      if (_src.point.x == 0 and _src.point.y == 0 and _src.size.x == _frame_size.x and _src.size.y == _frame_size.y) {
+      if (src.point.x == 0 and src.point.y == 0 and src.size.x == _frame_size.x and src.size.y == _frame_size.y) {
 			  g->DrawImage(image, {0, 0, size.x, size.y});
       } else {
-			  g->DrawImage(image, _src, {0, 0, size.x, size.y});
+			  g->DrawImage(image, src, {0, 0, size.x, size.y});
       }
-      
-      image->UnlockData();
 		}
 
 		virtual Player * GetPlayer()
@@ -195,7 +191,11 @@ static void * LockMediaSurface(void *data, void **p_pixels)
 {
 	LibvlcPlayerComponentImpl *cmp = reinterpret_cast<LibvlcPlayerComponentImpl *>(data);
 	
-  std::shared_ptr<jcanvas::Image> image = cmp->_buffer[(cmp->_buffer_index)%2];
+  std::shared_ptr<jcanvas::Image> &image = cmp->_mailbox.GetWriteBuffer();
+
+  if (image == nullptr) {
+    image = std::make_shared<jcanvas::BufferedImage>(jcanvas::jpixelformat_t::RGB32, cmp->_frame_size);
+  }
 
 	(*p_pixels) = image->LockData();
 
@@ -206,9 +206,8 @@ static void UnlockMediaSurface(void *data, void *, void *const *)
 {
 	LibvlcPlayerComponentImpl *cmp = reinterpret_cast<LibvlcPlayerComponentImpl *>(data);
 
-  std::shared_ptr<jcanvas::Image> image = cmp->_buffer[(cmp->_buffer_index++)%2];
-
-	image->UnlockData();
+	cmp->_mailbox.GetWriteBuffer()->UnlockData();
+	cmp->_mailbox.Publish();
 }
 
 static void DisplayMediaSurface(void *data, void *)
@@ -24,6 +24,7 @@
 #include "jmedia/jvideodevicecontrol.h"
 #include "jmedia/jvolumecontrol.h"
 #include "jmedia/jcolorconversion.h"
+#include "jmedia/jframemailbox.h"
 
 #include "jcanvas/core/jbufferedimage.h"
 
@@ -31,8 +32,6 @@
 
 #include <thread>
 
-#include <cairo.h>
-
 namespace jmedia {
 
 class XinePlayerComponentImpl : public jcanvas::Component {
@@ -41,15 +40,11 @@ class XinePlayerComponentImpl : public jcanvas::Component {
 		/** \brief */
 		Player *_player;
 		/** \brief */
-		cairo_surface_t *_surface;
-		/** \brief */
 		std::mutex _mutex;
 		/** \brief */
 		jcanvas::jrect_t<int> _src;
 		/** \brief */
-    std::shared_ptr<jcanvas::Image> _buffer[2];
-		/** \brief */
-		int _buffer_index;
+		FrameMailbox<std::shared_ptr<jcanvas::Image>> _mailbox;
 		/** \brief */
 		jcanvas::jpoint_t<int> _frame_size;
 
@@ -57,9 +52,6 @@ class XinePlayerComponentImpl : public jcanvas::Component {
 		XinePlayerComponentImpl(Player *player, int x, int y, int w, int h):
 			jcanvas::Component({x, y, w, h})
 		{
-			_buffer_index = 0;
-
-			_surface = nullptr;
 			_player = player;
 			
 			_frame_size.x = -1;
@@ -74,9 +66,6 @@ class XinePlayerComponentImpl : public jcanvas::Component {
 
 		virtual ~XinePlayerComponentImpl()
 		{
-      if (_surface != nullptr) {
-        cairo_surface_destroy(_surface);
-      }
 		}
 
 		virtual jcanvas::jpoint_t<int> GetPreferredSize()
@@ -90,7 +79,9 @@ class XinePlayerComponentImpl : public jcanvas::Component {
 				return;
 			}
 
-			if (_buffer == nullptr or width != _frame_size.x or height != _frame_size.y) {
+      _mutex.lock();
+
+			if (width != _frame_size.x or height != _frame_size.y) {
 				_frame_size.x = width;
 				_frame_size.y = height;
 
@@ -101,12 +92,15 @@ class XinePlayerComponentImpl : public jcanvas::Component {
         if (_src.size.y < 0) {
           _src.size.y = _frame_size.y;
         }
-
-				_buffer[0] = std::make_shared<jcanvas::BufferedImage>(jcanvas::jpixelformat_t::RGB32, jcanvas::jpoint_t<int>{width, height});
-				_buffer[1] = std::make_shared<jcanvas::BufferedImage>(jcanvas::jpixelformat_t::RGB32, jcanvas::jpoint_t<int>{width, height});
 			}
+
+      _mutex.unlock();
 			
-      std::shared_ptr<jcanvas::Image> image = _buffer[(_buffer_index++)%2];
+      std::shared_ptr<jcanvas::Image> &image = _mailbox.GetWriteBuffer();
+
+      if (image == nullptr or image->GetSize().x != width or image->GetSize().y != height) {
+				image = std::make_shared<jcanvas::BufferedImage>(jcanvas::jpixelformat_t::RGB32, jcanvas::jpoint_t<int>{width, height});
+      }
 
 			uint32_t *buffer = (uint32_t *)image->LockData();
 
@@ -120,6 +114,8 @@ class XinePlayerComponentImpl : public jcanvas::Component {
 	
 			image->UnlockData();
 
+      _mailbox.Publish();
+
       Repaint();
 		}
 
@@ -127,16 +123,25 @@ class XinePlayerComponentImpl : public jcanvas::Component {
 		{
 			// jcanvas::Component::Paint(g);
 
-      if (_buffer[0] == nullptr or _buffer[1] == nullptr) {
+      _mailbox.Acquire();
+
+      std::shared_ptr<jcanvas::Image> image = _mailbox.GetReadBuffer();
+
+      if (image == nullptr) {
         return;
       }
 
       jcanvas::jpoint_t<int>
-        size = GetSize();
+        size = GetSize(),
+        frame = image->GetSize();
+      jcanvas::jrect_t<int>
+        src;
+
+      _mutex.lock();
 
-      std::shared_ptr<jcanvas::Image> image = _buffer[(_buffer_index + 1)%2];
+      src = _src;
 
-      image->LockData();
+      _mutex.unlock();
 
 			_player->DispatchFrameGrabberEvent(new jmedia::FrameGrabberEvent(image, jmedia::jframeevent_type_t::Grab));
 
@@ -144,13 +149,11 @@ class XinePlayerComponentImpl : public jcanvas::Component {
 	    g->SetCompositeFlags(jcanvas::jcomposite_flags_t::Src);
 	    g->SetBlittingFlags(jcanvas::jblitting_flags_t::Nearest);
 
-      if (_src.point.x == 0 and _src.point.y == 0 and _src.size.x == _frame_size.x and _src.size.y == _frame_size.y) {
+      if (src.point.x == 0 and src.point.y == 0 and src.size.x == frame.x and src.size.y == frame.y) {
 			  g->DrawImage(image, {0, 0, size.x, size.y});
       } else {
-			  g->DrawImage(image, _src, {0, 0, size.x, size.y});
+			  g->DrawImage(image, src, {0, 0, size.x, size.y});
       }
-      
-      image->UnlockData();
 		}
 
 		virtual Player * GetPlayer()
@@ -20,11 +20,15 @@
 #include "../providers/v4l2/bind.h"
 #include "../providers/v4l2/videocontrol.h"
 #include "../providers/v4l2/videograbber.h"
+#include "../providers/v4l2/mjpegdecoder.h"
+#include "../providers/v4l2/latencyhistogram.h"
 
 #include "jmedia/jvideosizecontrol.h"
 #include "jmedia/jvideoformatcontrol.h"
 #include "jmedia/jvideodevicecontrol.h"
+#include "jmedia/jvideostatisticscontrol.h"
 #include "jmedia/jcolorconversion.h"
+#include "jmedia/jframemailbox.h"
 
 #include "jcanvas/core/jbufferedimage.h"
 
@@ -34,7 +38,8 @@
 #include <mutex>
 #include <condition_variable>
 
-#include <cairo.h>
+#define V4L2_DECODER_THREADS 3
+#define V4L2_DECODER_AREA (1280*720)
 
 namespace jmedia {
 
@@ -48,25 +53,41 @@ class V4l2PlayerComponentImpl : public jcanvas::Component {
 		/** \brief */
 		jcanvas::jrect_t<int> _src;
 		/** \brief */
-		uint32_t **_buffer;
+		FrameMailbox<std::shared_ptr<VideoFrame>> _mailbox;
 		/** \brief */
-		int _buffer_index;
+		std::shared_ptr<jcanvas::Image> _image;
+		/** \brief */
+		std::shared_ptr<VideoFrame> _decoded;
 		/** \brief */
 		jcanvas::jpoint_t<int> _frame_size;
+		/** \brief */
+		jcanvas::jpoint_t<int> _target;
+		/** \brief latencies indexed by jlatency_stage_t */
+		LatencyHistogram _latency[3];
+		/** \brief */
+		uint64_t _sequence;
+		/** \brief */
+		uint64_t _timestamp;
+#if defined(V4L2_MJPEG)
+		/** \brief */
+		MJPEGDecoder _decoder;
+		/** \brief */
+		std::unique_ptr<MJPEGDecodePool> _decoder_pool;
+#endif
 
 	public:
 		V4l2PlayerComponentImpl(Player *player, int x, int y, int w, int h):
 			jcanvas::Component({x, y, w, h})
 		{
-			_buffer = nullptr;
-
-			_buffer_index = 0;
-
 			_player = player;
 			
 			_frame_size.x = w;
 			_frame_size.y = h;
 
+			_target = {-1, -1};
+			_sequence = 0;
+			_timestamp = 0;
+
 			_src = {
         0, 0, w, h
       };
@@ -76,13 +97,9 @@ class V4l2PlayerComponentImpl : public jcanvas::Component {
 
 		virtual ~V4l2PlayerComponentImpl()
 		{
-			if (_buffer != nullptr) {
-				delete [] _buffer[0];
-				delete [] _buffer[1];
-
-				delete [] _buffer;
-        _buffer = nullptr;
-			}
+#if defined(V4L2_MJPEG)
+			_decoder_pool = nullptr;
+#endif
 		}
 
 		virtual jcanvas::jpoint_t<int> GetPreferredSize()
@@ -96,52 +113,127 @@ class V4l2PlayerComponentImpl : public jcanvas::Component {
 			_frame_size.y = _src.size.y = -1;
 		}
 
-		virtual void UpdateComponent(const uint8_t *buffer, int width, int height, jcanvas::jpixelformat_t format)
+		virtual void UpdateComponent(std::shared_ptr<VideoFrame> frame)
 		{
+			int 
+        width = frame->width,
+        height = frame->height;
+
 			if (width <= 0 || height <= 0) {
 				return;
 			}
 
 			_mutex.lock();
 
-      if (_buffer == nullptr or _frame_size.x != width or _frame_size.y != height) {
+      if (_frame_size.x != width or _frame_size.y != height) {
 			  _frame_size.x = width;
 			  _frame_size.y = height;
 			
-        if (_buffer != nullptr) {
-          delete [] _buffer[0];
-          delete [] _buffer[1];
+        if (_src.size.x < 0) {
+			    _src.size.x = _frame_size.x;
+        }
 
-          delete [] _buffer;
+        if (_src.size.y < 0) {
+			    _src.size.y = _frame_size.y;
         }
+      }
 
-        _buffer = new uint32_t*[2];
+      jcanvas::jpoint_t<int>
+        target = _target;
 
-        _buffer[0] = new uint32_t[width*height];
-        _buffer[1] = new uint32_t[width*height];
+      _mutex.unlock();
 
-        if (_src.size.x < 0) {
-			    _src.size.x = _frame_size.x;
+#if defined(V4L2_MJPEG)
+      // a single core does not decode the larger modes at the full rate, so their frames are decoded in parallel
+      if (frame->fourcc == V4L2_PIX_FMT_MJPEG or frame->fourcc == V4L2_PIX_FMT_JPEG) {
+        if (_decoder_pool == nullptr and width*height >= V4L2_DECODER_AREA) {
+          int threads = std::min<int>(V4L2_DECODER_THREADS, (int)std::thread::hardware_concurrency() - 1);
+
+          if (threads > 1) {
+            _decoder_pool = std::make_unique<MJPEGDecodePool>(threads, [this](std::shared_ptr<VideoFrame> decoded) {
+              PublishFrame(decoded);
+            });
+          }
         }
 
-        if (_src.size.y < 0) {
-			    _src.size.y = _frame_size.y;
+        if (_decoder_pool != nullptr) {
+          _decoder_pool->Submit(frame, target);
+
+          return;
         }
       }
+#endif
+
+      PublishFrame(frame);
+		}
+
+		virtual void PublishFrame(std::shared_ptr<VideoFrame> frame)
+		{
+      if (frame->image != nullptr) {
+        _latency[(int)jlatency_stage_t::Convert].RecordSince(frame->timestamp);
+      }
 
-      uint32_t *dst = _buffer[(_buffer_index++)%2];
+      _mailbox.GetWriteBuffer() = frame;
+      _mailbox.Publish();
 
-			if (format == jcanvas::jpixelformat_t::UYVY) {
+      // a frame replaced before being painted goes back to the driver right away
+      _mailbox.GetWriteBuffer() = nullptr;
+
+			Repaint();
+		}
+
+		virtual bool ConvertFrame(std::shared_ptr<VideoFrame> frame, jcanvas::jpoint_t<int> target)
+		{
+      const uint8_t 
+        *buffer = frame->data;
+      int 
+        width = frame->width,
+        height = frame->height;
+
+      // frames decoded by the pool are presented as they are
+      if (frame->image != nullptr) {
+        _image = frame->image;
+        _decoded = frame;
+
+        return true;
+      }
+
+      // the image of a decoded frame goes back to the pool, so it is not written anymore
+      if (_decoded != nullptr) {
+        _image = nullptr;
+        _decoded = nullptr;
+      }
+
+#if defined(V4L2_MJPEG)
+      if (frame->fourcc == V4L2_PIX_FMT_MJPEG or frame->fourcc == V4L2_PIX_FMT_JPEG) {
+        // decodes straight into the image of the component, at the scale that covers its size
+        return _decoder.Decode(frame, target, [this](jcanvas::jpoint_t<int> size) {
+          if (_image == nullptr or _image->GetSize().x != size.x or _image->GetSize().y != size.y) {
+            _image = std::make_shared<jcanvas::BufferedImage>(jcanvas::jpixelformat_t::RGB32, size);
+          }
+
+          return _image;
+        }) != nullptr;
+      }
+#endif
+
+      if (_image == nullptr or _image->GetSize().x != width or _image->GetSize().y != height) {
+        _image = std::make_shared<jcanvas::BufferedImage>(jcanvas::jpixelformat_t::RGB32, jcanvas::jpoint_t<int>{width, height});
+      }
+
+      uint32_t *dst = (uint32_t *)_image->LockData();
+
+			if (frame->format == jcanvas::jpixelformat_t::UYVY) {
 				ColorConversion::GetRGB32FromYUYV((uint8_t **)&buffer, (uint32_t **)&dst, width, height);
-			} else if (format == jcanvas::jpixelformat_t::RGB24) {
+			} else if (frame->format == jcanvas::jpixelformat_t::RGB24) {
 				ColorConversion::GetRGB32FromRGB24((uint8_t **)&buffer, (uint32_t **)&dst, width, height);
-			} else if (format == jcanvas::jpixelformat_t::RGB32) {
+			} else if (frame->format == jcanvas::jpixelformat_t::RGB32) {
 				memcpy(dst, buffer, width*height*4);
 			}
 
-      _mutex.unlock();
+      _image->UnlockData();
 
-			Repaint();
+      return true;
 		}
 
 		virtual void Paint(jcanvas::Graphics *g)
@@ -151,36 +243,96 @@ class V4l2PlayerComponentImpl : public jcanvas::Component {
       jcanvas::jpoint_t<int>
         size = GetSize();
 
-			_mutex.lock();
+      _mutex.lock();
 
-      if (_buffer == nullptr or _frame_size.x < 0 or _frame_size.y < 0) {
-        _mutex.unlock();
+      _target = size;
 
+      _mutex.unlock();
+
+      bool fresh = false;
+
+      // only the frames that are painted are converted, straight from the driver buffer
+      if (_mailbox.Acquire() == true) {
+        std::shared_ptr<VideoFrame> frame = _mailbox.GetReadBuffer();
+
+        _mailbox.GetReadBuffer() = nullptr;
+
+        if (ConvertFrame(frame, size) == true) {
+          if (frame->image == nullptr) {
+            _latency[(int)jlatency_stage_t::Convert].RecordSince(frame->timestamp);
+          }
+
+          _sequence = frame->sequence;
+          _timestamp = frame->timestamp;
+
+          fresh = true;
+        }
+      }
+
+      std::shared_ptr<jcanvas::Image> image = _image;
+
+      if (image == nullptr) {
         return;
       }
 
-			cairo_surface_t *surface = cairo_image_surface_create_for_data(
-					(uint8_t *)_buffer[(_buffer_index)%2], CAIRO_FORMAT_RGB24, _frame_size.x, _frame_size.y, cairo_format_stride_for_width(CAIRO_FORMAT_RGB24, _frame_size.x));
-			
-      std::shared_ptr<jcanvas::Image> image = std::make_shared<jcanvas::BufferedImage>(surface);
+      jcanvas::jpoint_t<int>
+        frame = image->GetSize();
+      jcanvas::jrect_t<int>
+        src;
+      jcanvas::jpoint_t<int>
+        frame_size;
+
+      _mutex.lock();
 
-			_player->DispatchFrameGrabberEvent(new jmedia::FrameGrabberEvent(image, jmedia::jframeevent_type_t::Grab));
+      src = _src;
+      frame_size = _frame_size;
 
-			cairo_surface_mark_dirty(surface);
+      _mutex.unlock();
+
+      if (src.size.x < 0 or src.size.y < 0) {
+        src.size = frame_size;
+      }
+
+      // the source is given in capture coordinates, while the frame may be decoded at a smaller scale
+      if (frame_size.x > 0 and frame_size.y > 0 and (frame.x != frame_size.x or frame.y != frame_size.y)) {
+        src = {
+          src.point.x*frame.x/frame_size.x, src.point.y*frame.y/frame_size.y, src.size.x*frame.x/frame_size.x, src.size.y*frame.y/frame_size.y
+        };
+      }
+
+      if (src.size.x < 0 or src.size.y < 0) {
+        src.size = frame;
+      }
+
+			_player->DispatchFrameGrabberEvent(new jmedia::FrameGrabberEvent(image, jmedia::jframeevent_type_t::Grab, _sequence, _timestamp));
 
 	    g->SetAntialias(jcanvas::jantialias_t::None);
 	    g->SetCompositeFlags(jcanvas::jcomposite_flags_t::Src);
 	    g->SetBlittingFlags(jcanvas::jblitting_flags_t::Nearest);
 
-      if (_src.point.x == 0 and _src.point.y == 0 and _src.size.x == _frame_size.x and _src.size.y == _frame_size.y) {
+      if (src.point.x == 0 and src.point.y == 0 and src.size.x == frame.x and src.size.y == frame.y) {
 			  g->DrawImage(image, {0, 0, size.x, size.y});
       } else {
-			  g->DrawImage(image, _src, {0, 0, size.x, size.y});
+			  g->DrawImage(image, src, {0, 0, size.x, size.y});
       }
 
-			cairo_surface_destroy(surface);
+      // the frame reaches the screen once, the next paints only repeat it
+      if (fresh == true) {
+        _latency[(int)jlatency_stage_t::Paint].RecordSince(_timestamp);
+      }
+		}
+
+		virtual uint64_t GetSkippedFrames()
+		{
+      uint64_t skipped = _mailbox.GetOverwrittenFrames();
 
-			_mutex.unlock();
+#if defined(V4L2_MJPEG)
+      if (_decoder_pool != nullptr) {
+        skipped = skipped + _decoder_pool->GetDroppedFrames();
+      }
+#endif
+
+      return skipped;
 		}
 
 		virtual Player * GetPlayer()
@@ -420,6 +572,76 @@ class V4l2VideoDeviceControlImpl : public VideoDeviceControl {
 
 };
 
+class V4l2VideoStatisticsControlImpl : public VideoStatisticsControl {
+	
+	private:
+		V4L2LightPlayer *_player;
+		uint64_t _dropped;
+		uint64_t _skipped;
+
+	public:
+		V4l2VideoStatisticsControlImpl(V4L2LightPlayer *player):
+			VideoStatisticsControl()
+		{
+			_player = player;
+			_dropped = 0;
+			_skipped = 0;
+		}
+
+		virtual ~V4l2VideoStatisticsControlImpl()
+		{
+		}
+
+		virtual jlatency_statistics_t GetLatency(jlatency_stage_t stage)
+		{
+      LatencyHistogram &histogram = dynamic_cast<V4l2PlayerComponentImpl *>(_player->_component)->_latency[(int)stage];
+
+			return {
+				histogram.GetCount(), histogram.GetPercentile(0.50), histogram.GetPercentile(0.99), histogram.GetMax()
+			};
+		}
+
+		virtual uint64_t GetCapturedFrames()
+		{
+			return dynamic_cast<V4l2PlayerComponentImpl *>(_player->_component)->_latency[(int)jlatency_stage_t::Dequeue].GetCount();
+		}
+
+		virtual uint64_t GetDroppedFrames()
+		{
+      std::unique_lock<std::mutex> lock(_player->_mutex);
+
+			if (_player->_grabber != nullptr) {
+				return _player->_grabber->GetStatistics().dropped - _dropped;
+			}
+
+			return 0;
+		}
+
+		virtual uint64_t GetSkippedFrames()
+		{
+			return dynamic_cast<V4l2PlayerComponentImpl *>(_player->_component)->GetSkippedFrames() - _skipped;
+		}
+
+		virtual void Reset()
+		{
+      V4l2PlayerComponentImpl *impl = dynamic_cast<V4l2PlayerComponentImpl *>(_player->_component);
+
+      for (auto &histogram : impl->_latency) {
+        histogram.Reset();
+      }
+
+			_skipped = impl->GetSkippedFrames();
+			_dropped = 0;
+
+      std::unique_lock<std::mutex> lock(_player->_mutex);
+
+			if (_player->_grabber != nullptr) {
+				_dropped = _player->_grabber->GetStatistics().dropped;
+			}
+		}
+
+};
+
 V4L2LightPlayer::V4L2LightPlayer(std::string uri):
 	Player()
 {
@@ -453,6 +675,7 @@ V4L2LightPlayer::V4L2LightPlayer(std::string uri):
 	_controls.push_back(new V4l2VideoSizeControlImpl(this));
 	_controls.push_back(new V4l2VideoFormatControlImpl(this));
 	_controls.push_back(new V4l2VideoDeviceControlImpl(this));
+	_controls.push_back(new V4l2VideoStatisticsControlImpl(this));
 	
 	_component = new V4l2PlayerComponentImpl(this, 0, 0, -1, -1);
 }
@@ -472,9 +695,12 @@ V4L2LightPlayer::~V4L2LightPlayer()
 	}
 }
 
-void V4L2LightPlayer::ProcessFrame(const uint8_t *buffer, int width, int height, jcanvas::jpixelformat_t format)
+void V4L2LightPlayer::ProcessFrame(std::shared_ptr<VideoFrame> frame)
 {
-  dynamic_cast<V4l2PlayerComponentImpl *>(_component)->UpdateComponent(buffer, width, height, format);
+  V4l2PlayerComponentImpl *impl = dynamic_cast<V4l2PlayerComponentImpl *>(_component);
+
+  impl->_latency[(int)jlatency_stage_t::Dequeue].RecordSince(frame->timestamp);
+  impl->UpdateComponent(frame);
 }
 
 void V4L2LightPlayer::Play()
@@ -540,6 +766,11 @@ void V4L2LightPlayer::Close()
 	_is_closed = true;
 
 	if (_grabber != nullptr) {
+		try {
+			_grabber->Stop();
+		} catch (std::runtime_error &e) {
+		}
+
 		delete _grabber;
 		_grabber = nullptr;
 	}
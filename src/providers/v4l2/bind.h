@@ -64,7 +64,7 @@ class V4L2LightPlayer : public Player, public V4LFrameListener {
 		 * \brief
 		 *
 		 */
-		virtual void ProcessFrame(const uint8_t *buffer, int width, int height, jcanvas::jpixelformat_t format);
+		virtual void ProcessFrame(std::shared_ptr<VideoFrame> frame);
 
 	public:
 		/**
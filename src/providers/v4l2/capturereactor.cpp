@@ -0,0 +1,334 @@
+#include "capturereactor.h"
+#include "videograbber.h"
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#define V4L2_CAPTURE_REACTORS 2
+#define V4L2_CAPTURE_EVENTS 16
+#define V4L2_CAPTURE_TICK 250
+#define V4L2_CAPTURE_TIMEOUT 2000
+#define V4L2_CAPTURE_REARM 10
+
+namespace jmedia {
+
+CaptureReactor::CaptureReactor()
+{
+	_dispatching = nullptr;
+	_is_running = true;
+
+	_epoll = epoll_create1(EPOLL_CLOEXEC);
+
+	if (_epoll == -1) {
+		throw std::runtime_error(std::string("Unable to create the capture reactor: ") + strerror(errno));
+	}
+
+	_wakeup = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+	if (_wakeup == -1) {
+		close(_epoll);
+
+		throw std::runtime_error(std::string("Unable to create the capture reactor: ") + strerror(errno));
+	}
+
+	struct epoll_event event;
+
+	memset(&event, 0, sizeof(event));
+
+	event.events = EPOLLIN;
+	event.data.fd = _wakeup;
+
+	epoll_ctl(_epoll, EPOLL_CTL_ADD, _wakeup, &event);
+
+	_thread = std::thread(&CaptureReactor::Run, this);
+}
+
+CaptureReactor::~CaptureReactor()
+{
+	_mutex.lock();
+	_is_running = false;
+	_mutex.unlock();
+
+	Wakeup();
+
+	_thread.join();
+
+	close(_wakeup);
+	close(_epoll);
+}
+
+CaptureReactor * CaptureReactor::GetReactor()
+{
+	static std::mutex mutex;
+	static std::vector<std::unique_ptr<CaptureReactor>> reactors;
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	CaptureReactor *reactor = nullptr;
+	int devices = 0;
+
+	for (auto &i : reactors) {
+		int count = i->GetDeviceCount();
+
+		if (reactor == nullptr or count < devices) {
+			reactor = i.get();
+			devices = count;
+		}
+	}
+
+	// a new loop is only started when every running one is busy
+	if ((reactor == nullptr or devices > 0) and reactors.size() < V4L2_CAPTURE_REACTORS) {
+		reactors.push_back(std::make_unique<CaptureReactor>());
+
+		reactor = reactors.back().get();
+	}
+
+	return reactor;
+}
+
+void CaptureReactor::Wakeup()
+{
+	uint64_t value = 1;
+
+	if (write(_wakeup, &value, sizeof(value)) < 0) {
+		// the counter is already signaled
+	}
+}
+
+void CaptureReactor::Arm(int fd, bool armed)
+{
+	struct epoll_event event;
+
+	memset(&event, 0, sizeof(event));
+
+	event.events = 0;
+	event.data.fd = fd;
+
+	if (armed == true) {
+		event.events = EPOLLIN;
+	}
+
+	epoll_ctl(_epoll, EPOLL_CTL_MOD, fd, &event);
+
+	_devices[fd].is_armed = armed;
+}
+
+void CaptureReactor::Register(VideoGrabber *grabber)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	int fd = grabber->_handler;
+
+	if (_devices.find(fd) != _devices.end()) {
+		return;
+	}
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+	// the counters go on from where the grabber left them when it was paused or stopped
+	jcapture_statistics_t statistics = grabber->_statistics;
+
+	statistics.fps = 0.0;
+
+	_devices[fd] = {
+		grabber, statistics, now, now, now, 0, false, true
+	};
+
+	struct epoll_event event;
+
+	memset(&event, 0, sizeof(event));
+
+	event.events = EPOLLIN;
+	event.data.fd = fd;
+
+	if (epoll_ctl(_epoll, EPOLL_CTL_ADD, fd, &event) == -1) {
+		_devices.erase(fd);
+
+		throw std::runtime_error(std::string("Unable to watch the capture device: ") + strerror(errno));
+	}
+}
+
+jcapture_statistics_t CaptureReactor::Unregister(VideoGrabber *grabber)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	jcapture_statistics_t statistics = {0, 0, 0, 0, 0.0};
+
+	for (auto i=_devices.begin(); i!=_devices.end(); i++) {
+		if (i->second.grabber == grabber) {
+			statistics = i->second.statistics;
+
+			epoll_ctl(_epoll, EPOLL_CTL_DEL, i->first, nullptr);
+
+			_devices.erase(i);
+
+			break;
+		}
+	}
+
+	// the listener of a frame being dispatched may remove its own device
+	if (std::this_thread::get_id() != _thread.get_id()) {
+		while (_dispatching == grabber) {
+			_condition.wait(lock);
+		}
+	}
+
+	return statistics;
+}
+
+jcapture_statistics_t CaptureReactor::GetStatistics(VideoGrabber *grabber)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	for (auto &i : _devices) {
+		if (i.second.grabber == grabber) {
+			return i.second.statistics;
+		}
+	}
+
+	return {0, 0, 0, 0, 0.0};
+}
+
+int CaptureReactor::GetDeviceCount()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	return _devices.size();
+}
+
+void CaptureReactor::Dispatch(int fd, uint32_t events)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	auto i = _devices.find(fd);
+
+	if (i == _devices.end() or i->second.is_armed == false) {
+		return;
+	}
+
+	// an error without frames means that no buffer is queued or the device is gone, so it is polled again later
+	if ((events & EPOLLIN) == 0) {
+		Arm(fd, false);
+
+		i->second.rearm = std::chrono::steady_clock::now() + std::chrono::milliseconds(V4L2_CAPTURE_REARM);
+
+		return;
+	}
+
+	VideoGrabber *grabber = i->second.grabber;
+	int r = -1;
+
+	_dispatching = grabber;
+
+	lock.unlock();
+
+	try {
+		r = grabber->GetFrame();
+	} catch (std::runtime_error &e) {
+	}
+
+	lock.lock();
+
+	_dispatching = nullptr;
+	_condition.notify_all();
+
+	i = _devices.find(fd);
+
+	if (i == _devices.end() or i->second.grabber != grabber) {
+		return;
+	}
+
+	Device &device = i->second;
+
+	if (r < 0) {
+		device.statistics.errors = device.statistics.errors + 1;
+	} else if (r > 0) {
+		device.statistics.frames = device.statistics.frames + 1;
+		device.statistics.dropped = device.statistics.dropped + grabber->_gap;
+		device.window_frames = device.window_frames + 1;
+		device.last_frame = std::chrono::steady_clock::now();
+		device.is_stalled = false;
+	}
+}
+
+int CaptureReactor::Maintain()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	int timeout = V4L2_CAPTURE_TICK;
+
+	for (auto &i : _devices) {
+		Device &device = i.second;
+
+		uint64_t elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - device.window).count();
+
+		if (elapsed >= 1000000) {
+			device.statistics.fps = (device.window_frames*1000000.0)/elapsed;
+			device.window_frames = 0;
+			device.window = now;
+		}
+
+		// a stalled device is accounted once, but its stream is kept so it can recover by itself
+		if (device.is_stalled == false and now - device.last_frame > std::chrono::milliseconds(V4L2_CAPTURE_TIMEOUT)) {
+			device.statistics.timeouts = device.statistics.timeouts + 1;
+			device.is_stalled = true;
+		}
+
+		if (device.is_armed == false) {
+			if (now >= device.rearm) {
+				Arm(i.first, true);
+			} else {
+				timeout = std::min<int>(timeout, std::chrono::duration_cast<std::chrono::milliseconds>(device.rearm - now).count() + 1);
+			}
+		}
+	}
+
+	return timeout;
+}
+
+void CaptureReactor::Run()
+{
+	struct epoll_event events[V4L2_CAPTURE_EVENTS];
+
+	while (true) {
+		int timeout = Maintain();
+		int n = epoll_wait(_epoll, events, V4L2_CAPTURE_EVENTS, timeout);
+
+		if (n < 0 and errno != EINTR) {
+			break;
+		}
+
+		for (int i=0; i<n; i++) {
+			if (events[i].data.fd == _wakeup) {
+				uint64_t value;
+
+				if (read(_wakeup, &value, sizeof(value)) < 0) {
+					// nothing to consume
+				}
+
+				continue;
+			}
+
+			// level triggered, so a device with more frames ready is serviced again in the next round
+			Dispatch(events[i].data.fd, events[i].events);
+		}
+
+		std::unique_lock<std::mutex> lock(_mutex);
+
+		if (_is_running == false) {
+			break;
+		}
+	}
+}
+
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <map>
+
+namespace jmedia {
+
+struct jcapture_statistics_t {
+	/** \brief frames delivered to the listener */
+	uint64_t frames;
+	/** \brief frames lost by the device, from the gaps in their sequence numbers */
+	uint64_t dropped;
+	/** \brief periods without frames longer than the capture timeout */
+	uint64_t timeouts;
+	/** \brief failed dequeues */
+	uint64_t errors;
+	/** \brief frames per second measured over the last second */
+	double fps;
+};
+
+class VideoGrabber;
+
+/**
+ * \brief Services the capture of many devices from a single epoll loop. The devices are dequeued
+ * without blocking as soon as a frame is ready, and a device that stops delivering frames is
+ * only accounted, so its stream keeps running.
+ *
+ */
+class CaptureReactor {
+
+	private:
+		struct Device {
+			VideoGrabber *grabber;
+			jcapture_statistics_t statistics;
+			std::chrono::steady_clock::time_point last_frame;
+			std::chrono::steady_clock::time_point window;
+			std::chrono::steady_clock::time_point rearm;
+			uint64_t window_frames;
+			bool is_stalled;
+			bool is_armed;
+		};
+
+	private:
+		/** \brief */
+    std::thread _thread;
+		/** \brief */
+    std::mutex _mutex;
+		/** \brief */
+    std::condition_variable _condition;
+		/** \brief devices indexed by their descriptors */
+		std::map<int, Device> _devices;
+		/** \brief */
+		VideoGrabber *_dispatching;
+		/** \brief */
+		int _epoll;
+		/** \brief */
+		int _wakeup;
+		/** \brief */
+		bool _is_running;
+
+	private:
+		/**
+		 * \brief
+		 *
+		 */
+		void Wakeup();
+
+		/**
+		 * \brief
+		 *
+		 */
+		void Arm(int fd, bool armed);
+
+		/**
+		 * \brief
+		 *
+		 */
+		void Dispatch(int fd, uint32_t events);
+
+		/**
+		 * \brief
+		 *
+		 */
+		int Maintain();
+
+		/**
+		 * \brief
+		 *
+		 */
+		void Run();
+
+	public:
+		/**
+		 * \brief
+		 *
+		 */
+		CaptureReactor();
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual ~CaptureReactor();
+
+		/**
+		 * \brief Returns the reactor of the shared pool that services the fewer devices.
+		 *
+		 */
+		static CaptureReactor * GetReactor();
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual void Register(VideoGrabber *grabber);
+
+		/**
+		 * \brief Removes the device and waits for any frame of it being dispatched.
+		 *
+		 */
+		virtual jcapture_statistics_t Unregister(VideoGrabber *grabber);
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual jcapture_statistics_t GetStatistics(VideoGrabber *grabber);
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual int GetDeviceCount();
+
+};
+
+}
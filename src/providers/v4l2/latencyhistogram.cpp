@@ -0,0 +1,122 @@
+#include "latencyhistogram.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <string.h>
+
+// values below are recorded exactly, and each power of two above is split in eight
+#define LATENCY_HISTOGRAM_LINEAR 16
+#define LATENCY_HISTOGRAM_STEPS 8
+
+namespace jmedia {
+
+LatencyHistogram::LatencyHistogram()
+{
+	Reset();
+}
+
+LatencyHistogram::~LatencyHistogram()
+{
+}
+
+uint64_t LatencyHistogram::Now()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int LatencyHistogram::GetBucket(uint64_t value)
+{
+	if (value < LATENCY_HISTOGRAM_LINEAR) {
+		return value;
+	}
+
+	int exponent = 63 - __builtin_clzll(value);
+	int step = (value >> (exponent - 3)) & (LATENCY_HISTOGRAM_STEPS - 1);
+
+	return std::min<int>(LATENCY_HISTOGRAM_LINEAR + (exponent - 4)*LATENCY_HISTOGRAM_STEPS + step, LATENCY_HISTOGRAM_BUCKETS - 1);
+}
+
+uint64_t LatencyHistogram::GetValue(int bucket)
+{
+	if (bucket < LATENCY_HISTOGRAM_LINEAR) {
+		return bucket;
+	}
+
+	int
+		exponent = (bucket - LATENCY_HISTOGRAM_LINEAR)/LATENCY_HISTOGRAM_STEPS + 4,
+		step = (bucket - LATENCY_HISTOGRAM_LINEAR) % LATENCY_HISTOGRAM_STEPS;
+	uint64_t
+		width = 1ULL << (exponent - 3);
+
+	return (LATENCY_HISTOGRAM_STEPS + step)*width + width/2;
+}
+
+void LatencyHistogram::Record(uint64_t value)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	_buckets[GetBucket(value)]++;
+	_count = _count + 1;
+	_max = std::max(_max, value);
+}
+
+void LatencyHistogram::RecordSince(uint64_t timestamp)
+{
+	uint64_t now = Now();
+
+	if (timestamp == 0 or timestamp > now) {
+		return;
+	}
+
+	Record(now - timestamp);
+}
+
+uint64_t LatencyHistogram::GetCount()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	return _count;
+}
+
+uint64_t LatencyHistogram::GetMax()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	return _max;
+}
+
+uint64_t LatencyHistogram::GetPercentile(double fraction)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	if (_count == 0) {
+		return 0;
+	}
+
+	uint64_t 
+		rank = std::max<uint64_t>((uint64_t)(std::clamp(fraction, 0.0, 1.0)*_count + 0.5), 1),
+		total = 0;
+
+	for (int i=0; i<LATENCY_HISTOGRAM_BUCKETS; i++) {
+		total = total + _buckets[i];
+
+		if (total >= rank) {
+			return std::min(GetValue(i), _max);
+		}
+	}
+
+	return _max;
+}
+
+void LatencyHistogram::Reset()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	memset(_buckets, 0, sizeof(_buckets));
+
+	_count = 0;
+	_max = 0;
+}
+
+}
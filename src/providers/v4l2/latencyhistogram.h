@@ -0,0 +1,98 @@
+#pragma once
+
+#include <mutex>
+
+#include <stdint.h>
+
+#define LATENCY_HISTOGRAM_BUCKETS 320
+
+namespace jmedia {
+
+/**
+ * \brief Distribution of latencies in microseconds. The buckets are log-linear, eight for each
+ * power of two, so the percentiles are kept within about 6% of the recorded values.
+ *
+ */
+class LatencyHistogram {
+
+	private:
+		/** \brief */
+		std::mutex _mutex;
+		/** \brief */
+		uint64_t _buckets[LATENCY_HISTOGRAM_BUCKETS];
+		/** \brief */
+		uint64_t _count;
+		/** \brief */
+		uint64_t _max;
+
+	private:
+		/**
+		 * \brief
+		 *
+		 */
+		static int GetBucket(uint64_t value);
+
+		/**
+		 * \brief Returns the middle of the values in the bucket.
+		 *
+		 */
+		static uint64_t GetValue(int bucket);
+
+	public:
+		/**
+		 * \brief
+		 *
+		 */
+		LatencyHistogram();
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual ~LatencyHistogram();
+
+		/**
+		 * \brief Returns the monotonic clock in microseconds, the clock of the timestamps of the frames.
+		 *
+		 */
+		static uint64_t Now();
+
+		/**
+		 * \brief
+		 *
+		 */
+		void Record(uint64_t value);
+
+		/**
+		 * \brief Records the time elapsed since the timestamp, ignoring unknown ones.
+		 *
+		 */
+		void RecordSince(uint64_t timestamp);
+
+		/**
+		 * \brief
+		 *
+		 */
+		uint64_t GetCount();
+
+		/**
+		 * \brief
+		 *
+		 */
+		uint64_t GetMax();
+
+		/**
+		 * \brief Returns the value below which the fraction of the recorded values is.
+		 *
+		 */
+		uint64_t GetPercentile(double fraction);
+
+		/**
+		 * \brief
+		 *
+		 */
+		void Reset();
+
+};
+
+}
@@ -0,0 +1,389 @@
+#include "mjpegdecoder.h"
+
+#include "jcanvas/core/jbufferedimage.h"
+
+#include <algorithm>
+
+#include <stdio.h>
+#include <setjmp.h>
+
+#include <linux/videodev2.h>
+
+#if defined(V4L2_TURBOJPEG)
+#include <turbojpeg.h>
+#elif defined(V4L2_LIBJPEG)
+#include <jpeglib.h>
+#endif
+
+#define V4L2_DECODER_CACHE 2
+
+namespace jmedia {
+
+#if defined(V4L2_TURBOJPEG)
+
+static jcanvas::jpoint_t<int> GetScaledSize(int width, int height, jcanvas::jpoint_t<int> target)
+{
+	jcanvas::jpoint_t<int> size = {width, height};
+
+	if (target.x <= 0 or target.y <= 0) {
+		return size;
+	}
+
+	int n = 0;
+	tjscalingfactor *factors = tjGetScalingFactors(&n);
+
+	for (int i=0; factors != nullptr and i<n; i++) {
+		int
+			w = TJSCALED(width, factors[i]),
+			h = TJSCALED(height, factors[i]);
+
+		if (w >= target.x and h >= target.y and w*h < size.x*size.y) {
+			size = {w, h};
+		}
+	}
+
+	return size;
+}
+
+#elif defined(V4L2_LIBJPEG)
+
+struct Decompressor {
+	struct jpeg_decompress_struct info;
+	struct jpeg_error_mgr manager;
+	jmp_buf jump;
+};
+
+static void ExitJPEG(j_common_ptr info)
+{
+	longjmp(((Decompressor *)info->client_data)->jump, 1);
+}
+
+static void OutputJPEG(j_common_ptr)
+{
+	// cameras deliver truncated frames often enough to not report each of them
+}
+
+static bool ReadHeader(Decompressor *decompressor, const uint8_t *data, size_t size, jcanvas::jpoint_t<int> target, jcanvas::jpoint_t<int> *scaled)
+{
+	struct jpeg_decompress_struct *info = &decompressor->info;
+
+	if (setjmp(decompressor->jump)) {
+		jpeg_abort_decompress(info);
+
+		return false;
+	}
+
+	jpeg_mem_src(info, (unsigned char *)data, size);
+	jpeg_read_header(info, TRUE);
+
+	info->scale_num = 1;
+	info->scale_denom = 1;
+
+	if (target.x > 0 and target.y > 0) {
+		for (int denom = 8; denom > 1; denom = denom/2) {
+			if ((int)((info->image_width + denom - 1)/denom) >= target.x and (int)((info->image_height + denom - 1)/denom) >= target.y) {
+				info->scale_denom = denom;
+
+				break;
+			}
+		}
+	}
+
+	// video is presented once per frame, so the fast paths are worth their small loss of precision
+	info->dct_method = JDCT_IFAST;
+	info->do_fancy_upsampling = FALSE;
+
+#if defined(JCS_EXTENSIONS) and __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	info->out_color_space = JCS_EXT_BGRX;
+#elif defined(JCS_EXTENSIONS)
+	info->out_color_space = JCS_EXT_XRGB;
+#else
+	info->out_color_space = JCS_RGB;
+#endif
+
+	jpeg_calc_output_dimensions(info);
+
+	*scaled = {(int)info->output_width, (int)info->output_height};
+
+	return true;
+}
+
+static bool ReadPixels(Decompressor *decompressor, uint8_t *pixels, int stride)
+{
+	struct jpeg_decompress_struct *info = &decompressor->info;
+
+	if (setjmp(decompressor->jump)) {
+		jpeg_abort_decompress(info);
+
+		return false;
+	}
+
+	jpeg_start_decompress(info);
+
+	while (info->output_scanline < info->output_height) {
+		JSAMPROW row = pixels + info->output_scanline*stride;
+
+		jpeg_read_scanlines(info, &row, 1);
+
+#if !defined(JCS_EXTENSIONS)
+		uint32_t *dst = (uint32_t *)row;
+
+		for (int i=info->output_width - 1; i>=0; i--) {
+			dst[i] = 0xff000000 | (row[3*i + 0] << 16) | (row[3*i + 1] << 8) | row[3*i + 2];
+		}
+#endif
+	}
+
+	jpeg_finish_decompress(info);
+
+	return true;
+}
+
+#endif
+
+MJPEGDecoder::MJPEGDecoder()
+{
+	_handler = nullptr;
+
+#if defined(V4L2_TURBOJPEG)
+	_handler = tjInitDecompress();
+#elif defined(V4L2_LIBJPEG)
+	Decompressor *decompressor = new Decompressor;
+
+	decompressor->info.err = jpeg_std_error(&decompressor->manager);
+	decompressor->manager.error_exit = ExitJPEG;
+	decompressor->manager.output_message = OutputJPEG;
+
+	jpeg_create_decompress(&decompressor->info);
+
+	decompressor->info.client_data = decompressor;
+
+	_handler = decompressor;
+#endif
+}
+
+MJPEGDecoder::~MJPEGDecoder()
+{
+	if (_handler == nullptr) {
+		return;
+	}
+
+#if defined(V4L2_TURBOJPEG)
+	tjDestroy((tjhandle)_handler);
+#elif defined(V4L2_LIBJPEG)
+	Decompressor *decompressor = (Decompressor *)_handler;
+
+	jpeg_destroy_decompress(&decompressor->info);
+
+	delete decompressor;
+#endif
+}
+
+std::shared_ptr<jcanvas::Image> MJPEGDecoder::Decode(std::shared_ptr<VideoFrame> frame, jcanvas::jpoint_t<int> target, std::function<std::shared_ptr<jcanvas::Image>(jcanvas::jpoint_t<int>)> allocate)
+{
+	if (_handler == nullptr or frame == nullptr or frame->data == nullptr or frame->size == 0) {
+		return nullptr;
+	}
+
+	jcanvas::jpoint_t<int> scaled;
+
+#if defined(V4L2_TURBOJPEG)
+	tjhandle handler = (tjhandle)_handler;
+	int width, height, subsampling, colorspace;
+
+	if (tjDecompressHeader3(handler, frame->data, frame->size, &width, &height, &subsampling, &colorspace) != 0) {
+		return nullptr;
+	}
+
+	scaled = GetScaledSize(width, height, target);
+#elif defined(V4L2_LIBJPEG)
+	Decompressor *decompressor = (Decompressor *)_handler;
+
+	if (ReadHeader(decompressor, frame->data, frame->size, target, &scaled) == false) {
+		return nullptr;
+	}
+#else
+	return nullptr;
+#endif
+
+	std::shared_ptr<jcanvas::Image> image = allocate(scaled);
+
+	if (image == nullptr or image->GetSize().x != scaled.x or image->GetSize().y != scaled.y) {
+#if defined(V4L2_LIBJPEG) and !defined(V4L2_TURBOJPEG)
+		jpeg_abort_decompress(&decompressor->info);
+#endif
+
+		return nullptr;
+	}
+
+	uint8_t *pixels = image->LockData();
+	bool decoded = false;
+
+	if (pixels != nullptr) {
+#if defined(V4L2_TURBOJPEG)
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		int format = TJPF_BGRX;
+#else
+		int format = TJPF_XRGB;
+#endif
+
+		// a truncated frame is still presented, only fatal errors discard it
+		decoded = tjDecompress2(handler, frame->data, frame->size, pixels, scaled.x, scaled.x*4, scaled.y, format, TJFLAG_FASTDCT | TJFLAG_FASTUPSAMPLE) == 0 or tjGetErrorCode(handler) == TJERR_WARNING;
+#elif defined(V4L2_LIBJPEG)
+		decoded = ReadPixels(decompressor, pixels, scaled.x*4);
+#endif
+	}
+
+	image->UnlockData();
+
+	if (decoded == false) {
+		return nullptr;
+	}
+
+	return image;
+}
+
+MJPEGDecodePool::MJPEGDecodePool(int threads, std::function<void(std::shared_ptr<VideoFrame>)> callback)
+{
+	_callback = callback;
+	_cache = std::make_shared<ImageCache>();
+	_cache->limit = threads + V4L2_DECODER_CACHE;
+	_target = {-1, -1};
+	_submitted = 0;
+	_delivered = 0;
+	_dropped = 0;
+	_is_running = true;
+
+	for (int i=0; i<std::max(threads, 1); i++) {
+		_threads.emplace_back(&MJPEGDecodePool::Run, this);
+	}
+}
+
+MJPEGDecodePool::~MJPEGDecodePool()
+{
+	_mutex.lock();
+	_is_running = false;
+	_pending = nullptr;
+	_condition.notify_all();
+	_mutex.unlock();
+
+	for (auto &thread : _threads) {
+		thread.join();
+	}
+}
+
+void MJPEGDecodePool::Submit(std::shared_ptr<VideoFrame> frame, jcanvas::jpoint_t<int> target)
+{
+	std::shared_ptr<VideoFrame> replaced;
+
+	_mutex.lock();
+
+	// the replaced frame is released outside the lock, as its buffer goes back to the driver
+	if (_pending != nullptr) {
+		replaced = _pending;
+
+		_dropped = _dropped + 1;
+	}
+
+	_pending = frame;
+	_target = target;
+	_submitted = _submitted + 1;
+
+	_condition.notify_one();
+
+	_mutex.unlock();
+}
+
+uint64_t MJPEGDecodePool::GetDroppedFrames()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	return _dropped;
+}
+
+void MJPEGDecodePool::Run()
+{
+	MJPEGDecoder decoder;
+	std::shared_ptr<ImageCache> cache = _cache;
+
+	auto allocate = [cache](jcanvas::jpoint_t<int> size) {
+		std::unique_lock<std::mutex> lock(cache->mutex);
+
+		for (auto i=cache->images.begin(); i!=cache->images.end(); i++) {
+			if ((*i)->GetSize().x == size.x and (*i)->GetSize().y == size.y) {
+				std::shared_ptr<jcanvas::Image> image = *i;
+
+				cache->images.erase(i);
+
+				return image;
+			}
+		}
+
+		lock.unlock();
+
+		return std::shared_ptr<jcanvas::Image>(std::make_shared<jcanvas::BufferedImage>(jcanvas::jpixelformat_t::RGB32, size));
+	};
+
+	while (true) {
+		std::unique_lock<std::mutex> lock(_mutex);
+
+		while (_is_running == true and _pending == nullptr) {
+			_condition.wait(lock);
+		}
+
+		if (_is_running == false) {
+			break;
+		}
+
+		std::shared_ptr<VideoFrame> frame = _pending;
+		jcanvas::jpoint_t<int> target = _target;
+		uint64_t index = _submitted;
+
+		_pending = nullptr;
+
+		lock.unlock();
+
+		std::shared_ptr<jcanvas::Image> image = decoder.Decode(frame, target, allocate);
+		uint32_t sequence = frame->sequence;
+		uint64_t timestamp = frame->timestamp;
+
+		frame = nullptr;
+
+		if (image == nullptr) {
+			continue;
+		}
+
+		// the image goes back to the cache when the last reference to the frame is released
+		std::shared_ptr<VideoFrame> decoded(new VideoFrame{nullptr, 0, image->GetSize().x, image->GetSize().y, jcanvas::jpixelformat_t::RGB32, V4L2_PIX_FMT_RGB32, sequence, timestamp, image}, [cache](VideoFrame *frame) {
+			std::unique_lock<std::mutex> lock(cache->mutex);
+
+			if (cache->images.size() < cache->limit) {
+				cache->images.push_back(frame->image);
+			}
+
+			lock.unlock();
+
+			delete frame;
+		});
+
+		image = nullptr;
+
+		std::unique_lock<std::mutex> deliver(_deliver_mutex);
+
+		if (index <= _delivered) {
+			deliver.unlock();
+
+			lock.lock();
+			_dropped = _dropped + 1;
+			lock.unlock();
+
+			continue;
+		}
+
+		_delivered = index;
+
+		_callback(decoded);
+	}
+}
+
+}
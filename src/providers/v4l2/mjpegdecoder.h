@@ -0,0 +1,126 @@
+#pragma once
+
+#include "videograbber.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+
+#if defined(V4L2_TURBOJPEG) or defined(V4L2_LIBJPEG)
+#define V4L2_MJPEG
+#endif
+
+namespace jmedia {
+
+/**
+ * \brief Decodes the frames of a motion jpeg stream to RGB32. The frame is reduced in the dct
+ * domain to the smallest size that still covers the target, so a large capture presented in a
+ * small component is never decoded at full resolution.
+ *
+ */
+class MJPEGDecoder {
+
+	private:
+		/** \brief */
+		void *_handler;
+
+	public:
+		/**
+		 * \brief
+		 *
+		 */
+		MJPEGDecoder();
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual ~MJPEGDecoder();
+
+		/**
+		 * \brief Decodes the frame into the image returned by allocate, called with the decoded size. It
+		 * returns that image, or nullptr when the frame is corrupted.
+		 *
+		 */
+		std::shared_ptr<jcanvas::Image> Decode(std::shared_ptr<VideoFrame> frame, jcanvas::jpoint_t<int> target, std::function<std::shared_ptr<jcanvas::Image>(jcanvas::jpoint_t<int>)> allocate);
+
+};
+
+/**
+ * \brief Decodes the frames in worker threads, so a stream can be decoded faster than a single
+ * core allows. Only the latest frame waits for a worker, and a frame that completes after a newer
+ * one was delivered is dropped, so the callback always sees the frames in capture order.
+ *
+ */
+class MJPEGDecodePool {
+
+	private:
+		struct ImageCache {
+			std::mutex mutex;
+			std::vector<std::shared_ptr<jcanvas::Image>> images;
+			size_t limit;
+		};
+
+	private:
+		/** \brief */
+		std::vector<std::thread> _threads;
+		/** \brief */
+		std::mutex _mutex;
+		/** \brief */
+		std::mutex _deliver_mutex;
+		/** \brief */
+		std::condition_variable _condition;
+		/** \brief */
+		std::function<void(std::shared_ptr<VideoFrame>)> _callback;
+		/** \brief */
+		std::shared_ptr<ImageCache> _cache;
+		/** \brief */
+		std::shared_ptr<VideoFrame> _pending;
+		/** \brief */
+		jcanvas::jpoint_t<int> _target;
+		/** \brief */
+		uint64_t _submitted;
+		/** \brief */
+		uint64_t _delivered;
+		/** \brief */
+		uint64_t _dropped;
+		/** \brief */
+		bool _is_running;
+
+	private:
+		/**
+		 * \brief
+		 *
+		 */
+		void Run();
+
+	public:
+		/**
+		 * \brief
+		 *
+		 */
+		MJPEGDecodePool(int threads, std::function<void(std::shared_ptr<VideoFrame>)> callback);
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual ~MJPEGDecodePool();
+
+		/**
+		 * \brief Queues the frame to be decoded to the target size, replacing the one still waiting.
+		 *
+		 */
+		void Submit(std::shared_ptr<VideoFrame> frame, jcanvas::jpoint_t<int> target);
+
+		/**
+		 * \brief Returns the frames replaced before decoding or decoded too late.
+		 *
+		 */
+		uint64_t GetDroppedFrames();
+
+};
+
+}
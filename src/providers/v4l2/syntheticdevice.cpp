@@ -0,0 +1,667 @@
+#include "syntheticdevice.h"
+
+#include <sstream>
+#include <chrono>
+#include <algorithm>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+
+#if defined(V4L2_LIBJPEG)
+#include <jpeglib.h>
+#endif
+
+#define SYNTHETIC_DEVICE_WIDTH 640
+#define SYNTHETIC_DEVICE_HEIGHT 480
+#define SYNTHETIC_DEVICE_FPS 30.0
+#define SYNTHETIC_DEVICE_MAX_BUFFERS 32
+#define SYNTHETIC_DEVICE_JPEG_QUALITY 80
+
+#define CLEAR(x) memset(&(x), 0, sizeof(x))
+
+namespace jmedia {
+
+static const uint8_t synthetic_bars[8][3] = {
+	{0xc0, 0xc0, 0xc0},
+	{0xc0, 0xc0, 0x00},
+	{0x00, 0xc0, 0xc0},
+	{0x00, 0xc0, 0x00},
+	{0xc0, 0x00, 0xc0},
+	{0xc0, 0x00, 0x00},
+	{0x00, 0x00, 0xc0},
+	{0x10, 0x10, 0x10}
+};
+
+SyntheticVideoDevice::SyntheticVideoDevice(std::string parameters):
+	VideoDevice()
+{
+	_pixelformat = V4L2_PIX_FMT_YUYV;
+	_memory = 0;
+	_sequence = 0;
+	_width = SYNTHETIC_DEVICE_WIDTH;
+	_height = SYNTHETIC_DEVICE_HEIGHT;
+	_handler = -1;
+	_fps = SYNTHETIC_DEVICE_FPS;
+	_jitter = 0.0;
+	_drop = 0.0;
+	_is_fps_fixed = false;
+	_is_format_fixed = false;
+	_is_size_fixed = false;
+	_is_latest = false;
+	_is_streaming = false;
+
+	std::stringstream stream(parameters);
+	std::string parameter;
+
+	while (std::getline(stream, parameter, ',')) {
+		std::string::size_type i = parameter.find('=');
+
+		if (i == std::string::npos) {
+			continue;
+		}
+
+		std::string
+			key = parameter.substr(0, i),
+			value = parameter.substr(i + 1);
+
+		if (key == "size") {
+			_is_size_fixed = sscanf(value.c_str(), "%dx%d", &_width, &_height) == 2;
+		} else if (key == "format") {
+			_is_format_fixed = true;
+
+			if (value == "rgb24") {
+				_pixelformat = V4L2_PIX_FMT_RGB24;
+#if defined(V4L2_LIBJPEG)
+			} else if (value == "mjpeg") {
+				_pixelformat = V4L2_PIX_FMT_MJPEG;
+#endif
+			}
+		} else if (key == "fps") {
+			_fps = std::max(atof(value.c_str()), 1.0);
+			_is_fps_fixed = true;
+		} else if (key == "jitter") {
+			_jitter = std::max(atof(value.c_str()), 0.0);
+		} else if (key == "drop") {
+			_drop = std::clamp(atof(value.c_str()), 0.0, 1.0);
+		}
+	}
+
+	_width = std::clamp(_width & ~1, 16, 4096);
+	_height = std::clamp(_height, 16, 4096);
+}
+
+SyntheticVideoDevice::~SyntheticVideoDevice()
+{
+	Close();
+}
+
+size_t SyntheticVideoDevice::GetFrameSize()
+{
+	if (_pixelformat == V4L2_PIX_FMT_RGB24) {
+		return _width*_height*3;
+	}
+
+	// compressed frames have the same upper bound of the uvc driver
+	return _width*_height*2;
+}
+
+size_t SyntheticVideoDevice::GetStride()
+{
+	size_t page = sysconf(_SC_PAGESIZE);
+
+	return ((GetFrameSize() + page - 1)/page)*page;
+}
+
+size_t SyntheticVideoDevice::Render(uint8_t *data, size_t length, uint32_t sequence)
+{
+	int
+		width = _width,
+		height = _height,
+		bar = std::max(width/8, 1),
+		offset = (sequence*4) % width;
+
+	if (_pixelformat == V4L2_PIX_FMT_YUYV) {
+		if (length < (size_t)(width*height*2)) {
+			return 0;
+		}
+
+		for (int j=0; j<height; j++) {
+			uint8_t *line = data + j*width*2;
+
+			for (int i=0; i<width; i+=2) {
+				const uint8_t *rgb = synthetic_bars[((i + offset) % width)/bar % 8];
+
+				int
+					y = (( 66*rgb[0] + 129*rgb[1] +  25*rgb[2] + 128) >> 8) +  16,
+					u = ((-38*rgb[0] -  74*rgb[1] + 112*rgb[2] + 128) >> 8) + 128,
+					v = ((112*rgb[0] -  94*rgb[1] -  18*rgb[2] + 128) >> 8) + 128;
+
+				line[i*2 + 0] = y;
+				line[i*2 + 1] = u;
+				line[i*2 + 2] = y;
+				line[i*2 + 3] = v;
+			}
+		}
+
+		return width*height*2;
+	}
+
+	std::vector<uint8_t> scratch;
+	uint8_t *rgb = data;
+
+	if (_pixelformat != V4L2_PIX_FMT_RGB24) {
+		scratch.resize(width*height*3);
+
+		rgb = scratch.data();
+	} else if (length < (size_t)(width*height*3)) {
+		return 0;
+	}
+
+	for (int j=0; j<height; j++) {
+		uint8_t *line = rgb + j*width*3;
+
+		for (int i=0; i<width; i++) {
+			memcpy(line + i*3, synthetic_bars[((i + offset) % width)/bar % 8], 3);
+		}
+	}
+
+	if (_pixelformat == V4L2_PIX_FMT_RGB24) {
+		return width*height*3;
+	}
+
+#if defined(V4L2_LIBJPEG)
+	struct jpeg_compress_struct cinfo;
+	struct jpeg_error_mgr jerr;
+	unsigned char *jpeg = nullptr;
+	unsigned long size = 0;
+
+	cinfo.err = jpeg_std_error(&jerr);
+
+	jpeg_create_compress(&cinfo);
+	jpeg_mem_dest(&cinfo, &jpeg, &size);
+
+	cinfo.image_width = width;
+	cinfo.image_height = height;
+	cinfo.input_components = 3;
+	cinfo.in_color_space = JCS_RGB;
+
+	jpeg_set_defaults(&cinfo);
+	jpeg_set_quality(&cinfo, SYNTHETIC_DEVICE_JPEG_QUALITY, TRUE);
+	jpeg_start_compress(&cinfo, TRUE);
+
+	while (cinfo.next_scanline < cinfo.image_height) {
+		JSAMPROW row = rgb + cinfo.next_scanline*width*3;
+
+		jpeg_write_scanlines(&cinfo, &row, 1);
+	}
+
+	jpeg_finish_compress(&cinfo);
+	jpeg_destroy_compress(&cinfo);
+
+	size = std::min<unsigned long>(size, length);
+
+	memcpy(data, jpeg, size);
+	free(jpeg);
+
+	return size;
+#else
+	return 0;
+#endif
+}
+
+void SyntheticVideoDevice::Signal()
+{
+	uint64_t value = 1;
+
+	if (write(_handler, &value, sizeof(value)) < 0) {
+		// the counter can not overflow with the few buffers of the device
+	}
+}
+
+void SyntheticVideoDevice::StreamOn()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	if (_is_streaming == true) {
+		return;
+	}
+
+	_is_streaming = true;
+
+	_thread = std::thread(&SyntheticVideoDevice::Run, this);
+}
+
+void SyntheticVideoDevice::StreamOff()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	if (_is_streaming == false) {
+		return;
+	}
+
+	_is_streaming = false;
+
+	_condition.notify_all();
+
+	lock.unlock();
+
+	_thread.join();
+
+	lock.lock();
+
+	// as the kernel does, the buffers are all returned to the application
+	_queued.clear();
+	_done.clear();
+
+	_is_latest = false;
+
+	uint64_t value;
+
+	while (read(_handler, &value, sizeof(value)) > 0) {
+	}
+}
+
+void SyntheticVideoDevice::Run()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	std::uniform_real_distribution<double>
+		jitter(-_jitter, _jitter),
+		drop(0.0, 1.0);
+	std::chrono::steady_clock::time_point
+		next = std::chrono::steady_clock::now();
+
+	while (_is_streaming == true) {
+		std::chrono::microseconds period((uint64_t)(1000000.0/_fps));
+
+		next = next + period;
+
+		// a device that can not keep up drops frames instead of bursting them
+		if (next + period < std::chrono::steady_clock::now()) {
+			next = std::chrono::steady_clock::now();
+		}
+
+		std::chrono::steady_clock::time_point target = next;
+
+		if (_jitter > 0.0) {
+			target = target + std::chrono::microseconds((int64_t)(jitter(_random)*1000.0));
+		}
+
+		if (_condition.wait_until(lock, target, [this]() { return _is_streaming == false; }) == true) {
+			break;
+		}
+
+		uint32_t sequence = _sequence++;
+
+		if (_drop > 0.0 and drop(_random) < _drop) {
+			continue;
+		}
+
+		if (_memory == 0) {
+			std::vector<uint8_t> frame(GetFrameSize());
+
+			lock.unlock();
+
+			frame.resize(Render(frame.data(), frame.size(), sequence));
+
+			lock.lock();
+
+			_latest = std::move(frame);
+
+			if (_is_latest == false) {
+				_is_latest = true;
+
+				Signal();
+			}
+
+			continue;
+		}
+
+		// a frame without a queued buffer is lost, as in a driver
+		if (_queued.empty() == true) {
+			continue;
+		}
+
+		uint32_t index = _queued.front();
+
+		_queued.pop_front();
+
+		Slot &slot = _slots[index];
+
+		lock.unlock();
+
+		size_t used = Render(slot.data, slot.length, sequence);
+
+		lock.lock();
+
+		if (_is_streaming == false) {
+			break;
+		}
+
+		struct v4l2_buffer buf;
+		struct timespec now;
+
+		CLEAR(buf);
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+
+		buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		buf.memory = _memory;
+		buf.index = index;
+		buf.bytesused = used;
+		buf.length = slot.length;
+		buf.field = V4L2_FIELD_NONE;
+		buf.flags = V4L2_BUF_FLAG_DONE | V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC | V4L2_BUF_FLAG_TSTAMP_SRC_EOF;
+		buf.sequence = sequence;
+		buf.timestamp.tv_sec = now.tv_sec;
+		buf.timestamp.tv_usec = now.tv_nsec/1000;
+
+		if (_memory == V4L2_MEMORY_MMAP) {
+			buf.flags = buf.flags | V4L2_BUF_FLAG_MAPPED;
+			buf.m.offset = index*GetStride();
+		} else {
+			buf.m.userptr = (unsigned long)slot.data;
+		}
+
+		_done.push_back(buf);
+
+		Signal();
+	}
+}
+
+int SyntheticVideoDevice::Open()
+{
+	_handler = eventfd(0, EFD_SEMAPHORE | EFD_NONBLOCK | EFD_CLOEXEC);
+
+	return _handler;
+}
+
+int SyntheticVideoDevice::Close()
+{
+	if (_handler == -1) {
+		return 0;
+	}
+
+	StreamOff();
+
+	int r = close(_handler);
+
+	_handler = -1;
+
+	return r;
+}
+
+int SyntheticVideoDevice::Ioctl(unsigned long request, void *arg)
+{
+	if (request == VIDIOC_STREAMON) {
+		if (_slots.size() == 0) {
+			errno = EINVAL;
+
+			return -1;
+		}
+
+		StreamOn();
+
+		return 0;
+	}
+
+	if (request == VIDIOC_STREAMOFF) {
+		StreamOff();
+
+		return 0;
+	}
+
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	if (request == VIDIOC_QUERYCAP) {
+		struct v4l2_capability *cap = (struct v4l2_capability *)arg;
+
+		CLEAR(*cap);
+
+		strncpy((char *)cap->driver, "synthetic", sizeof(cap->driver) - 1);
+		strncpy((char *)cap->card, "Synthetic camera", sizeof(cap->card) - 1);
+		strncpy((char *)cap->bus_info, "platform:synthetic", sizeof(cap->bus_info) - 1);
+
+		cap->device_caps = V4L2_CAP_VIDEO_CAPTURE | V4L2_CAP_STREAMING | V4L2_CAP_READWRITE;
+		cap->capabilities = cap->device_caps | V4L2_CAP_DEVICE_CAPS;
+
+		return 0;
+	}
+
+	if (request == VIDIOC_G_FMT or request == VIDIOC_S_FMT or request == VIDIOC_TRY_FMT) {
+		struct v4l2_format *fmt = (struct v4l2_format *)arg;
+
+		if (fmt->type != V4L2_BUF_TYPE_VIDEO_CAPTURE) {
+			errno = EINVAL;
+
+			return -1;
+		}
+
+		if (request != VIDIOC_G_FMT) {
+			if (request == VIDIOC_S_FMT and (_is_streaming == true or _slots.size() > 0)) {
+				errno = EBUSY;
+
+				return -1;
+			}
+
+			uint32_t pixelformat = fmt->fmt.pix.pixelformat;
+
+			// the mode given in the name is the only one of the device, as in a driver that has a single mode
+			if (_is_format_fixed == false and (pixelformat == V4L2_PIX_FMT_YUYV or pixelformat == V4L2_PIX_FMT_RGB24
+#if defined(V4L2_LIBJPEG)
+					or pixelformat == V4L2_PIX_FMT_MJPEG
+#endif
+					)) {
+				_pixelformat = pixelformat;
+			}
+
+			if (_is_size_fixed == false) {
+				_width = std::clamp((int)fmt->fmt.pix.width & ~1, 16, 4096);
+				_height = std::clamp((int)fmt->fmt.pix.height, 16, 4096);
+			}
+		}
+
+		CLEAR(fmt->fmt.pix);
+
+		fmt->fmt.pix.width = _width;
+		fmt->fmt.pix.height = _height;
+		fmt->fmt.pix.pixelformat = _pixelformat;
+		fmt->fmt.pix.field = V4L2_FIELD_NONE;
+		fmt->fmt.pix.bytesperline = (_pixelformat == V4L2_PIX_FMT_MJPEG)?0:((_pixelformat == V4L2_PIX_FMT_RGB24)?_width*3:_width*2);
+		fmt->fmt.pix.sizeimage = GetFrameSize();
+		fmt->fmt.pix.colorspace = V4L2_COLORSPACE_SRGB;
+
+		return 0;
+	}
+
+	if (request == VIDIOC_G_PARM or request == VIDIOC_S_PARM) {
+		struct v4l2_streamparm *parm = (struct v4l2_streamparm *)arg;
+
+		if (parm->type != V4L2_BUF_TYPE_VIDEO_CAPTURE) {
+			errno = EINVAL;
+
+			return -1;
+		}
+
+		// a rate given in the name of the device is kept, as a camera with a fixed rate would do
+		if (request == VIDIOC_S_PARM and _is_fps_fixed == false and parm->parm.capture.timeperframe.numerator > 0) {
+			_fps = std::max((double)parm->parm.capture.timeperframe.denominator/parm->parm.capture.timeperframe.numerator, 1.0);
+		}
+
+		CLEAR(parm->parm);
+
+		parm->parm.capture.capability = V4L2_CAP_TIMEPERFRAME;
+		parm->parm.capture.timeperframe.numerator = 1000;
+		parm->parm.capture.timeperframe.denominator = (uint32_t)(_fps*1000.0);
+		parm->parm.capture.readbuffers = 2;
+
+		return 0;
+	}
+
+	if (request == VIDIOC_REQBUFS) {
+		struct v4l2_requestbuffers *req = (struct v4l2_requestbuffers *)arg;
+
+		if (req->type != V4L2_BUF_TYPE_VIDEO_CAPTURE or (req->memory != V4L2_MEMORY_MMAP and req->memory != V4L2_MEMORY_USERPTR)) {
+			errno = EINVAL;
+
+			return -1;
+		}
+
+		if (_is_streaming == true) {
+			errno = EBUSY;
+
+			return -1;
+		}
+
+		_queued.clear();
+		_done.clear();
+		_slots.clear();
+
+		_memory = req->memory;
+
+		req->count = std::min<uint32_t>(req->count, SYNTHETIC_DEVICE_MAX_BUFFERS);
+
+		_slots.resize(req->count);
+
+		for (Slot &slot : _slots) {
+			slot.data = nullptr;
+			slot.length = GetFrameSize();
+
+			if (_memory == V4L2_MEMORY_MMAP) {
+				slot.memory.resize(slot.length);
+				slot.data = slot.memory.data();
+			}
+		}
+
+		return 0;
+	}
+
+	if (request == VIDIOC_QUERYBUF or request == VIDIOC_QBUF) {
+		struct v4l2_buffer *buf = (struct v4l2_buffer *)arg;
+
+		if (buf->index >= _slots.size() or buf->memory != _memory) {
+			errno = EINVAL;
+
+			return -1;
+		}
+
+		Slot &slot = _slots[buf->index];
+
+		if (request == VIDIOC_QUERYBUF) {
+			buf->length = slot.length;
+			buf->flags = 0;
+
+			if (_memory == V4L2_MEMORY_MMAP) {
+				buf->m.offset = buf->index*GetStride();
+			}
+
+			return 0;
+		}
+
+		if (_memory == V4L2_MEMORY_USERPTR) {
+			if (buf->m.userptr == 0 or buf->length < GetFrameSize()) {
+				errno = EINVAL;
+
+				return -1;
+			}
+
+			slot.data = (uint8_t *)buf->m.userptr;
+			slot.length = buf->length;
+		}
+
+		_queued.push_back(buf->index);
+
+		return 0;
+	}
+
+	if (request == VIDIOC_DQBUF) {
+		struct v4l2_buffer *buf = (struct v4l2_buffer *)arg;
+
+		if (_done.empty() == true) {
+			errno = EAGAIN;
+
+			return -1;
+		}
+
+		uint64_t value;
+
+		*buf = _done.front();
+
+		_done.pop_front();
+
+		if (read(_handler, &value, sizeof(value)) < 0) {
+			// the counter follows the finished buffers
+		}
+
+		return 0;
+	}
+
+	// no controls, cropping or other ioctls
+	errno = (request == VIDIOC_QUERYCTRL or request == VIDIOC_G_CTRL or request == VIDIOC_S_CTRL or request == VIDIOC_CROPCAP or request == VIDIOC_S_CROP)?EINVAL:ENOTTY;
+
+	return -1;
+}
+
+void * SyntheticVideoDevice::Map(size_t, off_t offset)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	size_t index = offset/GetStride();
+
+	if (_memory != V4L2_MEMORY_MMAP or index >= _slots.size()) {
+		errno = EINVAL;
+
+		return MAP_FAILED;
+	}
+
+	return _slots[index].data;
+}
+
+int SyntheticVideoDevice::Unmap(void *, size_t)
+{
+	return 0;
+}
+
+ssize_t SyntheticVideoDevice::Read(void *buffer, size_t length)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	if (_is_streaming == false) {
+		_memory = 0;
+
+		lock.unlock();
+
+		StreamOn();
+
+		lock.lock();
+	}
+
+	if (_is_latest == false) {
+		errno = EAGAIN;
+
+		return -1;
+	}
+
+	uint64_t value;
+
+	length = std::min(length, _latest.size());
+
+	memcpy(buffer, _latest.data(), length);
+
+	_is_latest = false;
+
+	if (read(_handler, &value, sizeof(value)) < 0) {
+		// the counter follows the latest frame
+	}
+
+	return length;
+}
+
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include "videodevice.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <deque>
+#include <random>
+
+#include <linux/videodev2.h>
+
+namespace jmedia {
+
+/**
+ * \brief In-process capture device that streams generated frames through the same ioctls of a
+ * kernel driver. The name of the device carries its parameters, separated by commas:
+ *
+ * synthetic,size=640x480,format=yuyv|rgb24|mjpeg,fps=30,jitter=2,drop=0.01
+ *
+ * The size, format and fps given in the name are kept whatever the grabber asks for, and the
+ * others follow its requests. The jitter is the maximum deviation of each frame from its period
+ * (in milliseconds), and drop is the probability of a frame being lost before reaching a buffer.
+ *
+ */
+class SyntheticVideoDevice : public VideoDevice {
+
+	private:
+		struct Slot {
+			std::vector<uint8_t> memory;
+			uint8_t *data;
+			size_t length;
+		};
+
+	private:
+		/** \brief */
+    std::thread _thread;
+		/** \brief */
+    std::mutex _mutex;
+		/** \brief */
+    std::condition_variable _condition;
+		/** \brief */
+		std::vector<Slot> _slots;
+		/** \brief */
+		std::deque<uint32_t> _queued;
+		/** \brief */
+		std::deque<struct v4l2_buffer> _done;
+		/** \brief */
+		std::vector<uint8_t> _latest;
+		/** \brief */
+		std::mt19937 _random;
+		/** \brief */
+		uint32_t _pixelformat;
+		/** \brief */
+		uint32_t _memory;
+		/** \brief */
+		uint32_t _sequence;
+		/** \brief */
+		int _width;
+		/** \brief */
+		int _height;
+		/** \brief */
+		int _handler;
+		/** \brief */
+		double _fps;
+		/** \brief */
+		double _jitter;
+		/** \brief */
+		double _drop;
+		/** \brief */
+		bool _is_fps_fixed;
+		/** \brief */
+		bool _is_format_fixed;
+		/** \brief */
+		bool _is_size_fixed;
+		/** \brief */
+		bool _is_latest;
+		/** \brief */
+		bool _is_streaming;
+
+	private:
+		/**
+		 * \brief
+		 *
+		 */
+		size_t GetFrameSize();
+
+		/**
+		 * \brief
+		 *
+		 */
+		size_t GetStride();
+
+		/**
+		 * \brief Draws the frame of the sequence and returns the bytes used.
+		 *
+		 */
+		size_t Render(uint8_t *data, size_t length, uint32_t sequence);
+
+		/**
+		 * \brief
+		 *
+		 */
+		void Signal();
+
+		/**
+		 * \brief
+		 *
+		 */
+		void StreamOn();
+
+		/**
+		 * \brief
+		 *
+		 */
+		void StreamOff();
+
+		/**
+		 * \brief
+		 *
+		 */
+		void Run();
+
+	public:
+		/**
+		 * \brief
+		 *
+		 */
+		SyntheticVideoDevice(std::string parameters);
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual ~SyntheticVideoDevice();
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual int Open();
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual int Close();
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual int Ioctl(unsigned long request, void *arg);
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual void * Map(size_t length, off_t offset);
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual int Unmap(void *start, size_t length);
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual ssize_t Read(void *buffer, size_t length);
+
+};
+
+}
@@ -21,14 +21,14 @@ namespace jmedia {
  
 struct v4l2_queryctrl queryctrl;
 
-VideoControl::VideoControl(int handler)
+VideoControl::VideoControl(VideoDevice *device)
 {
-	_handler = handler;
+	_device = device;
 
 	CLEAR(queryctrl);
 
 	for (queryctrl.id = V4L2_CID_BASE; queryctrl.id < V4L2_CID_LASTP1; queryctrl.id++) {
-		if (0 == ioctl (_handler, VIDIOC_QUERYCTRL, &queryctrl)) {
+		if (0 == _device->Ioctl(VIDIOC_QUERYCTRL, &queryctrl)) {
 			if (queryctrl.flags & V4L2_CTRL_FLAG_DISABLED) {
 				continue;
 			}
@@ -38,7 +38,7 @@ VideoControl::VideoControl(int handler)
 	}
 
 	for (queryctrl.id = V4L2_CID_CAMERA_CLASS_BASE; queryctrl.id < V4L2_CID_CAMERA_CLASS_BASE + 32; queryctrl.id++) {
-		if (0 == ioctl (_handler, VIDIOC_QUERYCTRL, &queryctrl)) {
+		if (0 == _device->Ioctl(VIDIOC_QUERYCTRL, &queryctrl)) {
 			if (queryctrl.flags & V4L2_CTRL_FLAG_DISABLED) {
 				continue;
 			}
@@ -48,7 +48,7 @@ VideoControl::VideoControl(int handler)
 	}
 
 	for (queryctrl.id = V4L2_CID_PRIVATE_BASE;; queryctrl.id++) {
-		if (0 == ioctl (_handler, VIDIOC_QUERYCTRL, &queryctrl)) {
+		if (0 == _device->Ioctl(VIDIOC_QUERYCTRL, &queryctrl)) {
 			if (queryctrl.flags & V4L2_CTRL_FLAG_DISABLED) {
 				continue;
 			}
@@ -189,7 +189,7 @@ bool VideoControl::SetValue(jvideo_control_t id, int value)
 		control.id = t.v4l_id;
 		control.value = t.minimum+(value*(t.maximum-t.minimum))/100;
 
-		if (-1 == ioctl (_handler, VIDIOC_S_CTRL, &control) && errno != ERANGE) {
+		if (-1 == _device->Ioctl(VIDIOC_S_CTRL, &control) && errno != ERANGE) {
 			perror ("VIDIOC_S_CTRL");
 
 			return false;
@@ -219,7 +219,7 @@ void VideoControl::Reset(jvideo_control_t id)
 		control.id = t.v4l_id;
 		control.value = t.default_value;
 
-		if (-1 == ioctl (_handler, VIDIOC_S_CTRL, &control) && errno != ERANGE) {
+		if (-1 == _device->Ioctl(VIDIOC_S_CTRL, &control) && errno != ERANGE) {
 			perror ("VIDIOC_S_CTRL");
 		}
 
@@ -241,7 +241,7 @@ void VideoControl::Reset()
 		control.id = t.v4l_id;
 		control.value = t.default_value;
 
-		if (-1 == ioctl (_handler, VIDIOC_S_CTRL, &control) && errno != ERANGE) {
+		if (-1 == _device->Ioctl(VIDIOC_S_CTRL, &control) && errno != ERANGE) {
 			perror ("VIDIOC_S_CTRL");
 		}
 		
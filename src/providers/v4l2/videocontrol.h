@@ -1,5 +1,7 @@
 #pragma once
 
+#include "videodevice.h"
+
 #include "jmedia/jvideodevicecontrol.h"
 
 #include <stdio.h>
@@ -23,13 +25,13 @@ class VideoControl {
 
 	private:
 		std::vector<video_query_control_t> _query_controls;
-		int _handler;
+		VideoDevice *_device;
 
 	private:
 		void EnumerateControls();
 
 	public:
-		VideoControl(int handler);
+		VideoControl(VideoDevice *device);
 
 		virtual ~VideoControl();
 
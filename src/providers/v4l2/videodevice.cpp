@@ -0,0 +1,91 @@
+#include "videodevice.h"
+#include "syntheticdevice.h"
+
+#include <filesystem>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+
+namespace jmedia {
+
+std::shared_ptr<VideoDevice> VideoDevice::Create(std::string device)
+{
+	std::string name = std::filesystem::path(device).filename().string();
+
+	if (name.rfind("synthetic", 0) == 0) {
+		return std::make_shared<SyntheticVideoDevice>(name);
+	}
+
+	return std::make_shared<KernelVideoDevice>(device);
+}
+
+KernelVideoDevice::KernelVideoDevice(std::string device):
+	VideoDevice()
+{
+	_device = device;
+	_handler = -1;
+}
+
+KernelVideoDevice::~KernelVideoDevice()
+{
+	Close();
+}
+
+int KernelVideoDevice::Open()
+{
+	struct stat st;
+
+	if (stat(_device.c_str(), &st) != 0) {
+		return -1;
+	}
+
+	if (!S_ISCHR(st.st_mode)) {
+		errno = ENODEV;
+
+		return -1;
+	}
+
+	_handler = open(_device.c_str(), O_RDWR | O_NONBLOCK, 0);
+
+	return _handler;
+}
+
+int KernelVideoDevice::Close()
+{
+	if (_handler == -1) {
+		return 0;
+	}
+
+	int r = close(_handler);
+
+	_handler = -1;
+
+	return r;
+}
+
+int KernelVideoDevice::Ioctl(unsigned long request, void *arg)
+{
+	return ioctl(_handler, request, arg);
+}
+
+void * KernelVideoDevice::Map(size_t length, off_t offset)
+{
+	return mmap(nullptr /* start anywhere */, length, PROT_READ | PROT_WRITE /* required */, MAP_SHARED /* recommended */, _handler, offset);
+}
+
+int KernelVideoDevice::Unmap(void *start, size_t length)
+{
+	return munmap(start, length);
+}
+
+ssize_t KernelVideoDevice::Read(void *buffer, size_t length)
+{
+	return read(_handler, buffer, length);
+}
+
+}
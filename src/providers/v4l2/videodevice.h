@@ -0,0 +1,138 @@
+#pragma once
+
+#include <string>
+#include <memory>
+
+#include <sys/types.h>
+
+namespace jmedia {
+
+/**
+ * \brief Operations of a capture device. The grabber only talks to the device through them,
+ * so an in-process device can replace the kernel one.
+ *
+ */
+class VideoDevice {
+
+	public:
+		/**
+		 * \brief
+		 *
+		 */
+		VideoDevice()
+		{
+		}
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual ~VideoDevice()
+		{
+		}
+
+		/**
+		 * \brief Creates the synthetic device when the name of the device starts with
+		 * "synthetic" (ex.: /synthetic,format=mjpeg,fps=60), and the kernel one otherwise.
+		 *
+		 */
+		static std::shared_ptr<VideoDevice> Create(std::string device);
+
+		/**
+		 * \brief Returns a descriptor that polls readable when a frame is ready, or -1 with errno set.
+		 *
+		 */
+		virtual int Open() = 0;
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual int Close() = 0;
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual int Ioctl(unsigned long request, void *arg) = 0;
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual void * Map(size_t length, off_t offset) = 0;
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual int Unmap(void *start, size_t length) = 0;
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual ssize_t Read(void *buffer, size_t length) = 0;
+
+};
+
+class KernelVideoDevice : public VideoDevice {
+
+	private:
+		/** \brief */
+		std::string _device;
+		/** \brief */
+		int _handler;
+
+	public:
+		/**
+		 * \brief
+		 *
+		 */
+		KernelVideoDevice(std::string device);
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual ~KernelVideoDevice();
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual int Open();
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual int Close();
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual int Ioctl(unsigned long request, void *arg);
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual void * Map(size_t length, off_t offset);
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual int Unmap(void *start, size_t length);
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual ssize_t Read(void *buffer, size_t length);
+
+};
+
+}
@@ -1,11 +1,15 @@
 #include "videograbber.h"
 #include "videocontrol.h"
+#include "mjpegdecoder.h"
 
 #include <string.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
 
+#include <algorithm>
+#include <chrono>
+
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/mman.h>
@@ -15,6 +19,12 @@
 
 #define AUTO_EXPOSURE_ENABLED	1
 
+#define VIDEO_GRABBER_BUFFER_COUNT 6
+#define VIDEO_GRABBER_BUFFER_RESERVE 1
+
+#define VIDEO_GRABBER_FPS 30
+#define VIDEO_GRABBER_RAW_BANDWIDTH 24576000
+
 #define CLEAR(x) memset(&(x), 0, sizeof(x))
 
 namespace jmedia {
@@ -22,32 +32,80 @@ namespace jmedia {
 VideoGrabber::VideoGrabber(V4LFrameListener *listener, std::string device)
 {
 	_video_control = nullptr;
+	_reactor = nullptr;
+	_statistics = {0, 0, 0, 0, 0.0};
 	_listener = listener;
 	_device = device;
 	_method = IO_METHOD_MMAP;
 	_handler = -1;
 	_buffers = nullptr;
 	_n_buffers = 0;
+	_buffer_count = VIDEO_GRABBER_BUFFER_COUNT;
+	_starvation = jbuffer_starvation_t::Copy;
 	_xres = 0;
 	_yres = 0;
 	_running = false;
+	_pixelformat = jcanvas::jpixelformat_t::Unknown;
+	_fourcc = 0;
+	_sequence = -1;
+	_gap = 0;
 }
 
 VideoGrabber::~VideoGrabber()
 {
+	// the reactor keeps calling a registered grabber, so it leaves the reactor before it is freed
+	if (_running == true) {
+		try {
+			Stop();
+		} catch (std::runtime_error &e) {
+		}
+	}
 }
 
-int xioctl(int fh, int request, void *arg)
+static int xioctl(VideoDevice *device, unsigned long request, void *arg)
 {
 	int r;
 
 	do {
-		r = ioctl(fh, request, arg);
+		r = device->Ioctl(request, arg);
 	} while (-1 == r && EINTR == errno);
 
 	return r;
 }
 
+static uint64_t GetTimestamp(const struct v4l2_buffer *buf)
+{
+	// only monotonic timestamps can be compared to the clock of the presentation, so the others are replaced by the dequeue time
+	if (buf != nullptr and (buf->flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC) {
+		return buf->timestamp.tv_sec*1000000ULL + buf->timestamp.tv_usec;
+	}
+
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+VideoBufferPool::~VideoBufferPool()
+{
+	unsigned int i;
+
+	switch (method) {
+		case IO_METHOD_READ:
+			free(buffers[0].start);
+			break;
+
+		case IO_METHOD_MMAP:
+			for (i = 0; i < count; ++i)
+				device->Unmap(buffers[i].start, buffers[i].length);
+			break;
+
+		case IO_METHOD_USERPTR:
+			for (i = 0; i < count; ++i)
+				free(buffers[i].start);
+			break;
+	}
+
+	free(buffers);
+}
+
 void VideoGrabber::InitBuffer(unsigned int buffer_size)
 {
 	_buffers = (buffer *)calloc(1, sizeof(*_buffers));
@@ -70,11 +128,11 @@ void VideoGrabber::InitSharedMemory()
 
 	CLEAR(req);
 
-	req.count = 4;
+	req.count = _buffer_count;
 	req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 	req.memory = V4L2_MEMORY_MMAP;
 
-	if (-1 == xioctl(_handler, VIDIOC_REQBUFS, &req)) {
+	if (-1 == xioctl(_video_device.get(), VIDIOC_REQBUFS, &req)) {
 		if (EINVAL == errno) {
 			ExceptionHandler(_device + " does not support memory mapping");
 		} else {
@@ -101,16 +159,11 @@ void VideoGrabber::InitSharedMemory()
 		buf.memory      = V4L2_MEMORY_MMAP;
 		buf.index       = _n_buffers;
 
-		if (-1 == xioctl(_handler, VIDIOC_QUERYBUF, &buf))
+		if (-1 == xioctl(_video_device.get(), VIDIOC_QUERYBUF, &buf))
 			ExceptionHandler("VIDIOC_QUERYBUF");
 
 		_buffers[_n_buffers].length = buf.length;
-		_buffers[_n_buffers].start =
-			mmap(nullptr /* start anywhere */,
-					buf.length,
-					PROT_READ | PROT_WRITE /* required */,
-					MAP_SHARED /* recommended */,
-					_handler, buf.m.offset);
+		_buffers[_n_buffers].start = _video_device->Map(buf.length, buf.m.offset);
 
 		if (MAP_FAILED == _buffers[_n_buffers].start)
 			ExceptionHandler("mmap");
@@ -123,11 +176,11 @@ void VideoGrabber::InitUserPtr(unsigned int buffer_size)
 
 	CLEAR(req);
 
-	req.count  = 4;
+	req.count  = _buffer_count;
 	req.type   = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 	req.memory = V4L2_MEMORY_USERPTR;
 
-	if (-1 == xioctl(_handler, VIDIOC_REQBUFS, &req)) {
+	if (-1 == xioctl(_video_device.get(), VIDIOC_REQBUFS, &req)) {
 		if (EINVAL == errno) {
 			ExceptionHandler(_device + " does not support user pointer i/o");
 		} else {
@@ -135,13 +188,17 @@ void VideoGrabber::InitUserPtr(unsigned int buffer_size)
 		}
 	}
 
-	_buffers = (buffer *)calloc(4, sizeof(*_buffers));
+	if (req.count < 2) {
+		ExceptionHandler("Insufficient buffer memory on " + _device);
+	}
+
+	_buffers = (buffer *)calloc(req.count, sizeof(*_buffers));
 
 	if (!_buffers) {
 		ExceptionHandler("Out of memory");
 	}
 
-	for (_n_buffers = 0; _n_buffers < 4; ++_n_buffers) {
+	for (_n_buffers = 0; _n_buffers < req.count; ++_n_buffers) {
 		_buffers[_n_buffers].length = buffer_size;
 		_buffers[_n_buffers].start = malloc(buffer_size);
 
@@ -159,7 +216,7 @@ void VideoGrabber::Configure(int width, int height)
 	struct v4l2_format fmt;
 	unsigned int min;
 
-	if (-1 == xioctl(_handler, VIDIOC_QUERYCAP, &cap)) {
+	if (-1 == xioctl(_video_device.get(), VIDIOC_QUERYCAP, &cap)) {
 		if (EINVAL == errno) {
 			ExceptionHandler(_device + " is no V4L2 device");
 		} else {
@@ -191,11 +248,11 @@ void VideoGrabber::Configure(int width, int height)
 
 	cropcap.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 
-	if (0 == xioctl(_handler, VIDIOC_CROPCAP, &cropcap)) {
+	if (0 == xioctl(_video_device.get(), VIDIOC_CROPCAP, &cropcap)) {
 		crop.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 		crop.c = cropcap.defrect; // reset to default
 
-		if (-1 == xioctl(_handler, VIDIOC_S_CROP, &crop)) {
+		if (-1 == xioctl(_video_device.get(), VIDIOC_S_CROP, &crop)) {
 			switch (errno) {
 				case EINVAL:
 					// cropping not supported
@@ -219,18 +276,27 @@ void VideoGrabber::Configure(int width, int height)
 		fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_YUYV;
 		fmt.fmt.pix.field       = V4L2_FIELD_INTERLACED;
 
-		if (-1 == xioctl(_handler, VIDIOC_S_FMT, &fmt)) {
+#if defined(V4L2_MJPEG)
+		// usb cameras send raw frames through the isochronous bandwidth of usb 2, so larger
+		// modes are only delivered at the full rate when compressed. a driver without mjpeg
+		// answers with the format it has
+		if ((uint64_t)width*height*2*VIDEO_GRABBER_FPS > VIDEO_GRABBER_RAW_BANDWIDTH) {
+			fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_MJPEG;
+		}
+#endif
+
+		if (-1 == xioctl(_video_device.get(), VIDIOC_S_FMT, &fmt)) {
 			ExceptionHandler("VIDIOC_S_FMT");
 		}
 
-		if (-1 == xioctl(_handler, VIDIOC_G_FMT, &fmt)) {
+		if (-1 == xioctl(_video_device.get(), VIDIOC_G_FMT, &fmt)) {
 			ExceptionHandler("VIDIOC_G_FMT");
 		}
 
 		// note VIDIOC_S_FMT may change width and height
 	} else {
 		// Preserve original settings as set by v4l2-ctl for example
-		if (-1 == xioctl(_handler, VIDIOC_G_FMT, &fmt)) {
+		if (-1 == xioctl(_video_device.get(), VIDIOC_G_FMT, &fmt)) {
 			ExceptionHandler("VIDIOC_G_FMT");
 		}
 	}
@@ -241,12 +307,17 @@ void VideoGrabber::Configure(int width, int height)
 		_pixelformat = jcanvas::jpixelformat_t::RGB24;
 	} else if (fmt.fmt.pix.pixelformat == V4L2_PIX_FMT_RGB32) {
 		_pixelformat = jcanvas::jpixelformat_t::RGB32;
+#if defined(V4L2_MJPEG)
+	} else if (fmt.fmt.pix.pixelformat == V4L2_PIX_FMT_MJPEG or fmt.fmt.pix.pixelformat == V4L2_PIX_FMT_JPEG) {
+		_pixelformat = jcanvas::jpixelformat_t::Unknown;
+#endif
 	} else {
 		printf("[PIXEL FORMAT] 0x%8x\n", fmt.fmt.pix.pixelformat);
 
 		ExceptionHandler("Not implemented to this pixel format");
 	}
 
+	_fourcc = fmt.fmt.pix.pixelformat;
 	_xres = fmt.fmt.pix.width;
 	_yres = fmt.fmt.pix.height;
 
@@ -271,7 +342,7 @@ void VideoGrabber::Configure(int width, int height)
 	control.id = V4L2_CID_EXPOSURE_AUTO_PRIORITY;
 	control.value = AUTO_EXPOSURE_ENABLED;
 
-	if (ioctl(_handler, VIDIOC_S_CTRL, &control) < 0) {
+	if (_video_device->Ioctl(VIDIOC_S_CTRL, &control) < 0) {
 		printf("Couldn't set auto exposure !\n");
 	}
 
@@ -282,14 +353,14 @@ void VideoGrabber::Configure(int width, int height)
 
 	fps.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 
-	if (ioctl(_handler, VIDIOC_G_PARM, &fps) >= 0) {
+	if (_video_device->Ioctl(VIDIOC_G_PARM, &fps) >= 0) {
 		printf("Frame Rate:: %d/%d\n", fps.parm.capture.timeperframe.numerator, fps.parm.capture.timeperframe.denominator);
 	}
 
 	fps.parm.capture.timeperframe.numerator = 1;
-	fps.parm.capture.timeperframe.denominator = 30;
+	fps.parm.capture.timeperframe.denominator = VIDEO_GRABBER_FPS;
 
-	if (ioctl(_handler, VIDIOC_S_PARM, &fps) < 0) {
+	if (_video_device->Ioctl(VIDIOC_S_PARM, &fps) < 0) {
 		printf("Couldn't set v4l fps!\n");
 	}
 
@@ -306,6 +377,36 @@ void VideoGrabber::Configure(int width, int height)
 			InitUserPtr(fmt.fmt.pix.sizeimage);
 			break;
 	}
+
+	// the pool takes the buffers, so the ones still leased outlive the device
+	_pool = std::make_shared<VideoBufferPool>();
+
+	_pool->buffers = _buffers;
+	_pool->count = (_method == IO_METHOD_READ)?1:_n_buffers;
+	_pool->leased = 0;
+	_pool->device = _video_device;
+	_pool->method = _method;
+	_pool->streaming = false;
+}
+
+void VideoGrabber::SetBufferCount(int count)
+{
+	_buffer_count = std::max(count, 2);
+}
+
+int VideoGrabber::GetBufferCount()
+{
+	return _buffer_count;
+}
+
+void VideoGrabber::SetStarvationPolicy(jbuffer_starvation_t policy)
+{
+	_starvation = policy;
+}
+
+jbuffer_starvation_t VideoGrabber::GetStarvationPolicy()
+{
+	return _starvation;
 }
 
 void VideoGrabber::ReleaseDevice()
@@ -314,43 +415,93 @@ void VideoGrabber::ReleaseDevice()
     return;
   }
 
-	unsigned int i;
+  _pool->mutex.lock();
+  _pool->streaming = false;
+  _pool->mutex.unlock();
 
-	switch (_method) {
-		case IO_METHOD_READ:
-			free(_buffers[0].start);
-			break;
+  // the buffers are released with the last leased frame
+  _pool = nullptr;
+  _buffers = nullptr;
 
-		case IO_METHOD_MMAP:
-			for (i = 0; i < _n_buffers; ++i)
-				if (-1 == munmap(_buffers[i].start, _buffers[i].length))
-					ExceptionHandler("munmap");
-			break;
+	if (-1 == _video_device->Close())
+		ExceptionHandler("close");
 
-		case IO_METHOD_USERPTR:
-			for (i = 0; i < _n_buffers; ++i)
-				free(_buffers[i].start);
-			break;
+	_handler = -1;
+}
+
+std::shared_ptr<VideoFrame> VideoGrabber::CopyBuffer(const uint8_t *data, size_t size, uint32_t sequence, uint64_t timestamp)
+{
+	uint8_t *copy = new uint8_t[size];
+
+	memcpy(copy, data, size);
+
+	return std::shared_ptr<VideoFrame>(new VideoFrame{copy, size, _xres, _yres, _pixelformat, _fourcc, sequence, timestamp, nullptr}, [copy](VideoFrame *frame) {
+		delete [] copy;
+		delete frame;
+	});
+}
+
+std::shared_ptr<VideoFrame> VideoGrabber::LeaseBuffer(struct v4l2_buffer buf, const uint8_t *data)
+{
+	std::shared_ptr<VideoBufferPool> pool = _pool;
+	std::unique_lock<std::mutex> lock(pool->mutex);
+
+	// the driver needs some queued buffers to keep capturing, so a starving one does not lease the last of them,
+	// unless the policy is to starve the driver until the consumers release a frame
+	if (pool->count - pool->leased - 1 < VIDEO_GRABBER_BUFFER_RESERVE and _starvation != jbuffer_starvation_t::Wait) {
+		std::shared_ptr<VideoFrame> frame;
+
+		lock.unlock();
+
+		if (_starvation == jbuffer_starvation_t::Copy) {
+			frame = CopyBuffer(data, buf.bytesused, buf.sequence, GetTimestamp(&buf));
+		}
+
+		if (-1 == xioctl(_video_device.get(), VIDIOC_QBUF, &buf))
+			ExceptionHandler("VIDIOC_QBUF");
+
+		return frame;
 	}
 
-	free(_buffers);
+	pool->leased = pool->leased + 1;
 
-  _buffers = nullptr;
+	return std::shared_ptr<VideoFrame>(new VideoFrame{data, buf.bytesused, _xres, _yres, _pixelformat, _fourcc, buf.sequence, GetTimestamp(&buf), nullptr}, [pool, buf](VideoFrame *frame) mutable {
+		std::unique_lock<std::mutex> lock(pool->mutex);
 
-	if (-1 == close(_handler))
-		ExceptionHandler("close");
+		pool->leased = pool->leased - 1;
 
-	_handler = -1;
+		if (pool->streaming == true) {
+			xioctl(pool->device.get(), VIDIOC_QBUF, &buf);
+		}
+
+		delete frame;
+	});
+}
+
+void VideoGrabber::Sequence(uint32_t sequence)
+{
+	_gap = 0;
+
+	// the counter of the driver starts again with the stream
+	if (_sequence >= 0 and sequence > (uint32_t)_sequence) {
+		_gap = sequence - (uint32_t)_sequence - 1;
+	}
+
+	_sequence = sequence;
 }
 
 int VideoGrabber::GetFrame()
 {
+	std::shared_ptr<VideoFrame> frame;
 	struct v4l2_buffer buf;
+	ssize_t r;
 	unsigned int i;
 
 	switch (_method) {
 		case IO_METHOD_READ:
-			if (-1 == read(_handler, _buffers[0].start, _buffers[0].length)) {
+			r = _video_device->Read(_buffers[0].start, _buffers[0].length);
+
+			if (-1 == r) {
 				switch (errno) {
 					case EAGAIN:
 						return 0;
@@ -363,9 +514,9 @@ int VideoGrabber::GetFrame()
 				}
 			}
 
+			// the next read reuses the buffer
 			if (_listener != nullptr) {
-				_listener->ProcessFrame((const uint8_t *)_buffers[0].start, _xres, _yres, _pixelformat);
-				// _listener->ProcessFrame((const uint8_t *)buffers[0].start, buffers[0].length, _pixelformat);
+				_listener->ProcessFrame(CopyBuffer((const uint8_t *)_buffers[0].start, r, ++_sequence, GetTimestamp(nullptr)));
 			}
 			break;
 
@@ -375,7 +526,7 @@ int VideoGrabber::GetFrame()
 			buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 			buf.memory = V4L2_MEMORY_MMAP;
 
-			if (-1 == xioctl(_handler, VIDIOC_DQBUF, &buf)) {
+			if (-1 == xioctl(_video_device.get(), VIDIOC_DQBUF, &buf)) {
 				switch (errno) {
 					case EAGAIN:
 						return 0;
@@ -392,13 +543,13 @@ int VideoGrabber::GetFrame()
 				ExceptionHandler("Buffer index is out of bounds");
 			}
 
-			if (_listener != nullptr) {
-				_listener->ProcessFrame((const uint8_t *)_buffers[buf.index].start, _xres, _yres, _pixelformat);
-				// _listener->ProcessFrame((const uint8_t *)buffers[buf.index].start, buf.bytesused, _pixelformat);
-			}
+			Sequence(buf.sequence);
+
+			frame = LeaseBuffer(buf, (const uint8_t *)_buffers[buf.index].start);
 
-			if (-1 == xioctl(_handler, VIDIOC_QBUF, &buf))
-				ExceptionHandler("VIDIOC_QBUF");
+			if (_listener != nullptr and frame != nullptr) {
+				_listener->ProcessFrame(frame);
+			}
 			break;
 
 		case IO_METHOD_USERPTR:
@@ -407,7 +558,7 @@ int VideoGrabber::GetFrame()
 			buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 			buf.memory = V4L2_MEMORY_USERPTR;
 
-			if (-1 == xioctl(_handler, VIDIOC_DQBUF, &buf)) {
+			if (-1 == xioctl(_video_device.get(), VIDIOC_DQBUF, &buf)) {
 				switch (errno) {
 					case EAGAIN:
 						return 0;
@@ -429,13 +580,13 @@ int VideoGrabber::GetFrame()
 				ExceptionHandler("Buffer index is out of bounds");
 			}
 
-			if (_listener != nullptr) {
-				_listener->ProcessFrame((const uint8_t *)buf.m.userptr, _xres, _yres, _pixelformat);
-				// _listener->ProcessFrame((const uint8_t *)buf.m.userptr, buf.bytesused, _pixelformat);
-			}
+			Sequence(buf.sequence);
 
-			if (-1 == xioctl(_handler, VIDIOC_QBUF, &buf))
-				ExceptionHandler("VIDIOC_QBUF");
+			frame = LeaseBuffer(buf, (const uint8_t *)buf.m.userptr);
+
+			if (_listener != nullptr and frame != nullptr) {
+				_listener->ProcessFrame(frame);
+			}
 			break;
 	}
 
@@ -449,23 +600,16 @@ void VideoGrabber::ExceptionHandler(std::string msg)
 
 void VideoGrabber::Open()
 {
-	struct stat st;
-
-	if (stat(_device.c_str(), &st) != 0) {
-		ExceptionHandler("Cannot identify '" + _device + "': " + strerror(errno));
-	}
-
-	if (!S_ISCHR(st.st_mode)) {
-		ExceptionHandler(_device + " is no device");
-	}
+	// a new device for each run, as the buffers of the last one can still be leased
+	_video_device = VideoDevice::Create(_device);
 
-	_handler = open(_device.c_str(), O_RDWR | O_NONBLOCK, 0);
+	_handler = _video_device->Open();
 
 	if (_handler == -1) {
-		ExceptionHandler("Cannot open '" + _device + "': " + strerror(errno));
+		ExceptionHandler("Cannot open '" + _device + "'");
 	}
 
-	_video_control = new VideoControl(_handler);
+	_video_control = new VideoControl(_video_device.get());
 }
 
 void VideoGrabber::Start()
@@ -487,12 +631,13 @@ void VideoGrabber::Start()
 				buf.memory = V4L2_MEMORY_MMAP;
 				buf.index = i;
 
-				if (-1 == xioctl(_handler, VIDIOC_QBUF, &buf))
+				if (-1 == xioctl(_video_device.get(), VIDIOC_QBUF, &buf))
 					ExceptionHandler("VIDIOC_QBUF");
 			}
 			type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-			if (-1 == xioctl(_handler, VIDIOC_STREAMON, &type))
+			if (-1 == xioctl(_video_device.get(), VIDIOC_STREAMON, &type))
 				ExceptionHandler("VIDIOC_STREAMON");
+			_pool->streaming = true;
 			break;
 
 		case IO_METHOD_USERPTR:
@@ -506,16 +651,23 @@ void VideoGrabber::Start()
 				buf.m.userptr = (unsigned long)_buffers[i].start;
 				buf.length = _buffers[i].length;
 
-				if (-1 == xioctl(_handler, VIDIOC_QBUF, &buf))
+				if (-1 == xioctl(_video_device.get(), VIDIOC_QBUF, &buf))
 					ExceptionHandler("VIDIOC_QBUF");
 			}
 			type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-			if (-1 == xioctl(_handler, VIDIOC_STREAMON, &type))
+			if (-1 == xioctl(_video_device.get(), VIDIOC_STREAMON, &type))
 				ExceptionHandler("VIDIOC_STREAMON");
+			_pool->streaming = true;
 			break;
 	}
 
-  _thread = std::thread(&VideoGrabber::Run, this);
+	// the frames are dequeued by a loop shared with the other devices
+	_running = true;
+	_sequence = -1;
+	_gap = 0;
+
+	_reactor = CaptureReactor::GetReactor();
+	_reactor->Register(this);
 }
 
 void VideoGrabber::Pause()
@@ -523,14 +675,16 @@ void VideoGrabber::Pause()
 	if (_running == true) {
 		_running = false;
 
-    _thread.join();
+		_statistics = _reactor->Unregister(this);
 	}
 }
 
 void VideoGrabber::Resume()
 {
-	if (_running == false) {
-    _thread = std::thread(&VideoGrabber::Run, this);
+	if (_running == false and _reactor != nullptr) {
+		_running = true;
+
+		_reactor->Register(this);
 	}
 }
 
@@ -544,10 +698,7 @@ void VideoGrabber::Stop()
 
 	_running = false;
 
-  try {
-    _thread.join();
-  } catch (std::system_error &e) {
-  }
+	_statistics = _reactor->Unregister(this);
 
 	switch (_method) {
 		case IO_METHOD_READ:
@@ -556,8 +707,13 @@ void VideoGrabber::Stop()
 
 		case IO_METHOD_MMAP:
 		case IO_METHOD_USERPTR:
+			// the leased frames are not queued again after the stream is off
+			_pool->mutex.lock();
+			_pool->streaming = false;
+			_pool->mutex.unlock();
+
 			type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-			if (-1 == xioctl(_handler, VIDIOC_STREAMOFF, &type))
+			if (-1 == xioctl(_video_device.get(), VIDIOC_STREAMOFF, &type))
 				ExceptionHandler("VIDIOC_STREAMOFF");
 			break;
 	}
@@ -570,46 +726,13 @@ VideoControl * VideoGrabber::GetVideoControl()
 	return _video_control;
 }
 
-void VideoGrabber::Run()
+jcapture_statistics_t VideoGrabber::GetStatistics()
 {
-	_running = true;
-
-	while (_running) {
-		for (;;) {
-			fd_set fds;
-			struct timeval tv;
-			int r;
-
-			FD_ZERO(&fds);
-			FD_SET(_handler, &fds);
-
-			// timeout
-			tv.tv_sec = 2;
-			tv.tv_usec = 0;
-
-			r = select(_handler + 1, &fds, nullptr, nullptr, &tv);
-
-			if (-1 == r) {
-				if (EINTR == errno) {
-					continue;
-				}
-
-				ExceptionHandler("select");
-			}
-
-			if (0 == r) {
-				ExceptionHandler("Select timeout");
-			}
-
-			if (GetFrame()) {
-				break;
-			}
-
-			// EAGAIN - continue select loop
-		}
+	if (_running == true) {
+		return _reactor->GetStatistics(this);
 	}
 
-  _running = false;
+	return _statistics;
 }
 
 }
@@ -1,8 +1,14 @@
 #pragma once
 
+#include "capturereactor.h"
+#include "videodevice.h"
+
 #include "jcanvas/core/jimage.h"
 
-#include <thread>
+#include <memory>
+#include <mutex>
+
+#include <linux/videodev2.h>
 
 namespace jmedia {
 
@@ -12,11 +18,60 @@ enum jcapture_method_t {
 	IO_METHOD_USERPTR,
 };
 
+/**
+ * \brief What a grabber does with a new frame when only the reserved buffers are left in the
+ * driver. Copy delivers a copy and queues the buffer again, Drop queues it again without a frame,
+ * and Wait leases it anyway, so the driver starves and delivers no frame until a consumer
+ * releases one. The capture loop is shared by the devices and never blocks.
+ *
+ */
+enum class jbuffer_starvation_t {
+	Copy,
+	Drop,
+	Wait
+};
+
 struct buffer {
 	void *start;
 	size_t length;
 };
 
+/**
+ * \brief A captured frame. Leased frames point into the driver buffer, that is queued
+ * again when the last reference is dropped. Compressed frames have an unknown format and
+ * are told apart by the fourcc of the device, and decoded frames are kept in the image. The
+ * timestamp is the capture time in microseconds of the monotonic clock.
+ *
+ */
+struct VideoFrame {
+	const uint8_t *data;
+	size_t size;
+	int width;
+	int height;
+	jcanvas::jpixelformat_t format;
+	uint32_t fourcc;
+	uint32_t sequence;
+	uint64_t timestamp;
+	std::shared_ptr<jcanvas::Image> image;
+};
+
+/**
+ * \brief Owns the capture buffers while there are leased frames, even after the device
+ * is released.
+ *
+ */
+struct VideoBufferPool {
+	std::mutex mutex;
+	struct buffer *buffers;
+	uint32_t count;
+	uint32_t leased;
+	std::shared_ptr<VideoDevice> device;
+	jcapture_method_t method;
+	bool streaming;
+
+	~VideoBufferPool();
+};
+
 class V4LFrameListener {
 
 	protected:
@@ -30,7 +85,7 @@ class V4LFrameListener {
 		{
 		}
 
-		virtual void ProcessFrame(const uint8_t *buffer, int width, int height, jcanvas::jpixelformat_t format)
+		virtual void ProcessFrame(std::shared_ptr<VideoFrame> frame)
 		{
 		}
 };
@@ -39,20 +94,32 @@ class VideoControl;
 
 class VideoGrabber {
 
+	friend class CaptureReactor;
+
 	private:
 		/** \brief */
 		VideoControl *_video_control;
 		/** \brief */
 		V4LFrameListener *_listener;
 		/** \brief */
-    std::thread _thread;
+		CaptureReactor *_reactor;
+		/** \brief */
+		jcapture_statistics_t _statistics;
 		/** \brief */
 		struct buffer *_buffers;
 		/** \brief */
+		std::shared_ptr<VideoBufferPool> _pool;
+		/** \brief */
+		std::shared_ptr<VideoDevice> _video_device;
+		/** \brief */
 		std::string _device;
 		/** \brief */
 		uint32_t _n_buffers;
 		/** \brief */
+		uint32_t _buffer_count;
+		/** \brief */
+		jbuffer_starvation_t _starvation;
+		/** \brief */
 		int _handler;
 		/** \brief */
 		int _xres;
@@ -64,6 +131,12 @@ class VideoGrabber {
 		jcapture_method_t _method;
 		/** \brief */
 		jcanvas::jpixelformat_t _pixelformat;
+		/** \brief */
+		uint32_t _fourcc;
+		/** \brief last sequence number dequeued, or -1 */
+		int64_t _sequence;
+		/** \brief frames lost before the last one dequeued */
+		uint32_t _gap;
 
 	private:
 		/**
@@ -90,12 +163,30 @@ class VideoGrabber {
 		 */
 		void ReleaseDevice();
 
+		/**
+		 * \brief Accounts the frames lost before the one with the sequence number.
+		 *
+		 */
+		void Sequence(uint32_t sequence);
+
 		/**
 		 * \brief
 		 *
 		 */
 		int GetFrame();
 
+		/**
+		 * \brief Wraps a dequeued buffer in a frame that queues it again when released.
+		 *
+		 */
+		std::shared_ptr<VideoFrame> LeaseBuffer(struct v4l2_buffer buf, const uint8_t *data);
+
+		/**
+		 * \brief
+		 *
+		 */
+		std::shared_ptr<VideoFrame> CopyBuffer(const uint8_t *data, size_t size, uint32_t sequence, uint64_t timestamp);
+
 	public:
 		/**
 		 * \brief
@@ -127,6 +218,31 @@ class VideoGrabber {
 		 */
 		virtual void Configure(int width, int height);
 
+		/**
+		 * \brief Sets the number of buffers requested to the driver by the next Configure().
+		 *
+		 */
+		virtual void SetBufferCount(int count);
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual int GetBufferCount();
+
+		/**
+		 * \brief Sets what happens to a new frame when the consumers keep too many buffers
+		 * leased.
+		 *
+		 */
+		virtual void SetStarvationPolicy(jbuffer_starvation_t policy);
+
+		/**
+		 * \brief
+		 *
+		 */
+		virtual jbuffer_starvation_t GetStarvationPolicy();
+
 		/**
 		 * \brief
 		 *
@@ -158,10 +274,10 @@ class VideoGrabber {
 		virtual VideoControl * GetVideoControl();
 
 		/**
-		 * \brief
+		 * \brief Returns the frame accounting of the capture, kept from the last run while stopped.
 		 *
 		 */
-		virtual void Run();
+		virtual jcapture_statistics_t GetStatistics();
 
 };
 
@@ -0,0 +1,131 @@
+#include "providers/alsa/audioconverter.h"
+
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+
+using namespace jmedia;
+
+static int failures = 0;
+
+static void Expect(bool condition, const char *message)
+{
+  if (condition == false) {
+    fprintf(stderr, "failed: %s\n", message);
+
+    failures = failures + 1;
+  }
+}
+
+static std::vector<int16_t> Sine(int rate, double frequency, size_t frames)
+{
+  std::vector<int16_t> samples(frames);
+
+  for (size_t i=0; i<frames; i++) {
+    samples[i] = (int16_t)lrint(16384.0*sin(2.0*M_PI*frequency*i/rate));
+  }
+
+  return samples;
+}
+
+static std::vector<int16_t> Resample(const std::vector<int16_t> &samples, int src_rate, int dst_rate)
+{
+  AudioConverter converter(SND_PCM_FORMAT_S16_LE, 1, src_rate, SND_PCM_FORMAT_S16_LE, 1, dst_rate);
+  std::vector<int16_t> output;
+  std::vector<int16_t> block(1000);
+  size_t offset = 0;
+
+  // the input goes in pieces that do not match the blocks of the converter
+  while (offset < samples.size()) {
+    size_t consumed, frames = std::min<size_t>(777, samples.size() - offset);
+    size_t produced = converter.Convert((const uint8_t *)(samples.data() + offset), frames, &consumed, (uint8_t *)block.data(), block.size());
+
+    output.insert(output.end(), block.begin(), block.begin() + produced);
+
+    offset = offset + consumed;
+  }
+
+  while (true) {
+    size_t consumed, produced = converter.Convert(nullptr, 0, &consumed, (uint8_t *)block.data(), block.size());
+
+    if (produced == 0) {
+      break;
+    }
+
+    output.insert(output.end(), block.begin(), block.begin() + produced);
+  }
+
+  return output;
+}
+
+static void TestFormatRoundTrip()
+{
+  std::vector<int16_t> samples(2*1000), result(2*1000);
+  std::vector<float> floats(2*1000);
+  size_t consumed;
+
+  srand(1);
+
+  for (auto &sample : samples) {
+    sample = (int16_t)(rand() % 65536 - 32768);
+  }
+
+  samples[0] = -32768;
+  samples[1] = 32767;
+
+  AudioConverter 
+    encoder(SND_PCM_FORMAT_S16_LE, 2, 48000, SND_PCM_FORMAT_FLOAT_LE, 2, 48000),
+    decoder(SND_PCM_FORMAT_FLOAT_LE, 2, 48000, SND_PCM_FORMAT_S16_LE, 2, 48000);
+
+  Expect(encoder.Convert((const uint8_t *)samples.data(), 1000, &consumed, (uint8_t *)floats.data(), 1000) == 1000 and consumed == 1000, "s16 to float");
+  Expect(floats[0] == -1.0f, "lowest sample to -1.0");
+  Expect(decoder.Convert((const uint8_t *)floats.data(), 1000, &consumed, (uint8_t *)result.data(), 1000) == 1000 and consumed == 1000, "float to s16");
+  Expect(samples == result, "s16 samples kept through floats");
+}
+
+static void TestRateRatio(int src_rate, int dst_rate)
+{
+  std::vector<int16_t> 
+    samples = Sine(src_rate, 1000.0, src_rate),
+    output = Resample(samples, src_rate, dst_rate);
+  double expected = (double)samples.size()*dst_rate/src_rate;
+
+  // one second of input gives one second of output, apart from the edges of the filter
+  Expect(fabs(output.size() - expected) <= 64.0, "frames in the ratio of the rates");
+
+  if (output.size() < (size_t)dst_rate/2) {
+    return;
+  }
+
+  // the middle of the output keeps the frequency and the level of the sine
+  size_t 
+    begin = dst_rate/4,
+    end = begin + dst_rate/2,
+    crossings = 0;
+  double power = 0.0;
+
+  for (size_t i=begin; i<end; i++) {
+    if ((output[i - 1] < 0) != (output[i] < 0)) {
+      crossings = crossings + 1;
+    }
+
+    power = power + (double)output[i]*output[i];
+  }
+
+  double rms = sqrt(power/(end - begin));
+
+  Expect(crossings >= 998 and crossings <= 1002, "frequency kept by the resampler");
+  Expect(fabs(rms - 16384.0/sqrt(2.0)) < 0.01*16384.0, "level kept by the resampler");
+}
+
+int main()
+{
+  TestFormatRoundTrip();
+  TestRateRatio(44100, 48000);
+  TestRateRatio(48000, 44100);
+  TestRateRatio(22050, 48000);
+
+  return (failures == 0)?0:1;
+}
@@ -0,0 +1,100 @@
+#include "jmedia/jeventqueue.h"
+
+#include <thread>
+#include <vector>
+#include <cstdio>
+
+using namespace jmedia;
+
+static int failures = 0;
+
+static void Expect(bool condition, const char *message)
+{
+  if (condition == false) {
+    fprintf(stderr, "failed: %s\n", message);
+
+    failures = failures + 1;
+  }
+}
+
+static void TestWraparound()
+{
+  // a capacity of 5 is rounded up to 8
+  EventQueue<int> queue(5);
+  int value, pushed = 0, popped = 0;
+
+  for (int i=0; i<8; i++) {
+    Expect(queue.Push(pushed++) == true, "push while the queue has room");
+  }
+
+  Expect(queue.Push(-1) == false, "push while the queue is full");
+
+  // the positions go around the slots many times with the queue half full
+  for (int round=0; round<100; round++) {
+    for (int i=0; i<3; i++) {
+      Expect(queue.Pop(value) == true and value == popped++, "pop in the order of the pushes");
+    }
+
+    for (int i=0; i<3; i++) {
+      Expect(queue.Push(pushed++) == true, "push after the pops");
+    }
+  }
+
+  while (queue.Pop(value) == true) {
+    Expect(value == popped++, "pop of the remaining values in order");
+  }
+
+  Expect(popped == pushed, "every value popped once");
+}
+
+static void TestProducers()
+{
+  EventQueue<int> queue(64);
+  std::vector<std::thread> producers;
+  std::vector<int> counts(4, 0);
+  int total = 0;
+
+  for (int p=0; p<4; p++) {
+    producers.emplace_back([&queue, p]() {
+      for (int i=0; i<10000; i++) {
+        while (queue.Push(p*10000 + i) == false) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  // the values of each producer come out in the order it pushed them
+  while (total < 40000) {
+    int value;
+
+    if (queue.Pop(value) == false) {
+      std::this_thread::yield();
+
+      continue;
+    }
+
+    int producer = value/10000;
+
+    Expect(value%10000 == counts[producer], "values of a producer in order");
+
+    counts[producer] = value%10000 + 1;
+    total = total + 1;
+  }
+
+  for (auto &producer : producers) {
+    producer.join();
+  }
+
+  int value;
+
+  Expect(queue.Pop(value) == false, "queue empty after every value");
+}
+
+int main()
+{
+  TestWraparound();
+  TestProducers();
+
+  return (failures == 0)?0:1;
+}
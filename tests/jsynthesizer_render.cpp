@@ -0,0 +1,117 @@
+#include "jmedia/jsynthesizer.h"
+
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace jmedia;
+
+#define RATE 48000
+#define START 1000
+#define DURATION 4800
+
+static int failures = 0;
+
+static void Expect(bool condition, const char *message)
+{
+  if (condition == false) {
+    fprintf(stderr, "failed: %s\n", message);
+
+    failures = failures + 1;
+  }
+}
+
+static int Peak(const std::vector<int16_t> &samples, size_t begin, size_t end)
+{
+  int peak = 0;
+
+  for (size_t i=begin; i<end and i<samples.size(); i++) {
+    peak = std::max(peak, abs(samples[i]));
+  }
+
+  return peak;
+}
+
+static std::vector<int16_t> Render(const std::vector<jnote_t> &notes, double release)
+{
+  Synthesizer synthesizer(1, RATE);
+  jenvelope_t envelope;
+
+  envelope.release = release;
+
+  synthesizer.SetWave(sine_wave);
+  synthesizer.SetEnvelope(envelope);
+
+  return synthesizer.Render(notes);
+}
+
+static void TestDeterminism()
+{
+  std::vector<jnote_t> notes = {
+    {START, DURATION, -1, 440.0, 0.5},
+    {START + 777, DURATION, -1, 660.0, 0.5}
+  };
+
+  Synthesizer synthesizer(2, RATE);
+
+  synthesizer.SetWave(sine_wave);
+
+  std::vector<int16_t> 
+    first = synthesizer.Render(notes),
+    second = synthesizer.Render(notes);
+
+  Expect(first.empty() == false, "samples rendered");
+  Expect(first == second, "the same notes render the same samples again");
+
+  Synthesizer other(2, RATE);
+
+  other.SetWave(sine_wave);
+
+  Expect(other.Render(notes) == first, "the same notes render the same samples on another synthesizer");
+  Expect(synthesizer.NoteOn(0, 440.0) == 0, "no live notes without a device");
+}
+
+static void TestLength()
+{
+  std::vector<int16_t> samples = Render({{START, DURATION, -1, 440.0, 1.0}}, 0.02);
+  size_t 
+    release = 0.02*RATE,
+    end = START + DURATION + release;
+
+  // the rendering stops at the end of the period where the release ends
+  Expect(samples.size() >= end and samples.size() < end + 1024, "rendering ends after the release");
+  Expect(Peak(samples, 0, START) == 0, "silence before the note");
+  Expect(Peak(samples, START, START + 64) > 0, "note starts at its frame");
+
+  std::vector<int16_t> longer = Render({{START, DURATION, -1, 440.0, 1.0}}, 0.1);
+
+  Expect(longer.size() >= START + DURATION + (size_t)(0.1*RATE), "a longer release renders a longer tail");
+  Expect(Render({}, 0.02).empty() == true, "no notes render no samples");
+}
+
+static void TestReleaseTail()
+{
+  std::vector<int16_t> samples = Render({{START, DURATION, -1, 440.0, 1.0}}, 0.02);
+  size_t 
+    release = 0.02*RATE,
+    off = START + DURATION;
+  int 
+    sustain = Peak(samples, off - release, off),
+    early = Peak(samples, off, off + release/4),
+    late = Peak(samples, off + 3*release/4, off + release);
+
+  Expect(sustain > 0, "note sounds until its end");
+  Expect(early > 0 and early <= sustain, "tail starts at the level of the note");
+  Expect(late < early/2, "tail fades out");
+  Expect(Peak(samples, off + release + 1, samples.size()) == 0, "silence after the release");
+}
+
+int main()
+{
+  TestDeterminism();
+  TestLength();
+  TestReleaseTail();
+
+  return (failures == 0)?0:1;
+}
@@ -0,0 +1,78 @@
+#include "providers/alsa/periodring.h"
+
+#include <cstdio>
+#include <cstring>
+
+using namespace jmedia;
+
+static int failures = 0;
+
+static void Expect(bool condition, const char *message)
+{
+  if (condition == false) {
+    fprintf(stderr, "failed: %s\n", message);
+
+    failures = failures + 1;
+  }
+}
+
+static void TestWraparound()
+{
+  PeriodRing ring(3, 4);
+  size_t written = 0, read = 0;
+
+  Expect(ring.GetCapacity() == 3, "capacity in periods");
+
+  // the producer runs one period ahead of the consumer around the ring many times
+  for (int round=0; round<10; round++) {
+    while (uint8_t *period = ring.BeginWrite()) {
+      memset(period, written & 0xff, 4);
+
+      ring.EndWrite(1 + written % 4, written*4, written/5);
+
+      written = written + 1;
+    }
+
+    Expect(ring.GetLevel() == 3, "full ring");
+    Expect(ring.BeginWrite() == nullptr, "no period while the ring is full");
+
+    for (int i=0; i<2; i++) {
+      size_t size, position;
+      uint64_t serial;
+      uint8_t *period = ring.BeginRead(&size, &position, &serial);
+
+      Expect(period != nullptr, "period while the ring is not empty");
+
+      if (period == nullptr) {
+        return;
+      }
+
+      Expect(period[0] == (read & 0xff) and period[3] == (read & 0xff), "samples in order");
+      Expect(size == 1 + read % 4 and position == read*4 and serial == read/5, "period attributes in order");
+
+      ring.EndRead();
+
+      read = read + 1;
+    }
+
+    Expect(ring.GetLevel() == 1, "level after the reads");
+  }
+
+  Expect(written == read + 1, "every period read once");
+
+  size_t size, position;
+  uint64_t serial;
+
+  ring.Reset();
+
+  Expect(ring.GetLevel() == 0, "empty after a reset");
+  Expect(ring.BeginRead(&size, &position, &serial) == nullptr, "no period while the ring is empty");
+  Expect(ring.BeginWrite() != nullptr, "free period after a reset");
+}
+
+int main()
+{
+  TestWraparound();
+
+  return (failures == 0)?0:1;
+}
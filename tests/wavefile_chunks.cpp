@@ -0,0 +1,163 @@
+#include "providers/alsa/wavefile.h"
+
+#include <vector>
+#include <string>
+#include <cstdio>
+
+using namespace jmedia;
+
+static int failures = 0;
+
+static void Expect(bool condition, const char *message)
+{
+  if (condition == false) {
+    fprintf(stderr, "failed: %s\n", message);
+
+    failures = failures + 1;
+  }
+}
+
+static void WriteLE(std::vector<uint8_t> &data, uint32_t word, int size)
+{
+  for (int i=0; i<size; i++) {
+    data.push_back((word >> (8*i)) & 0xff);
+  }
+}
+
+static void WriteChunk(std::vector<uint8_t> &data, std::string id, const std::vector<uint8_t> &payload, uint32_t length)
+{
+  data.insert(data.end(), id.begin(), id.end());
+
+  WriteLE(data, length, 4);
+
+  data.insert(data.end(), payload.begin(), payload.end());
+
+  if ((payload.size() & 1) != 0) {
+    data.push_back(0);
+  }
+}
+
+static std::vector<uint8_t> Format(uint16_t tag, uint16_t channels, uint32_t rate, uint16_t bits)
+{
+  std::vector<uint8_t> payload;
+
+  WriteLE(payload, tag, 2);
+  WriteLE(payload, channels, 2);
+  WriteLE(payload, rate, 4);
+  WriteLE(payload, rate*channels*bits/8, 4);
+  WriteLE(payload, channels*bits/8, 2);
+  WriteLE(payload, bits, 2);
+
+  return payload;
+}
+
+static std::vector<uint8_t> Wave(const std::vector<uint8_t> &chunks)
+{
+  std::vector<uint8_t> data {'R', 'I', 'F', 'F'};
+
+  WriteLE(data, chunks.size() + 4, 4);
+
+  data.insert(data.end(), {'W', 'A', 'V', 'E'});
+  data.insert(data.end(), chunks.begin(), chunks.end());
+
+  return data;
+}
+
+static void TestChunks()
+{
+  std::vector<uint8_t> chunks;
+  WaveInfo info;
+
+  // a LIST chunk of odd length, padded to an even offset, before the format
+  WriteChunk(chunks, "LIST", {'I', 'N', 'F', 'O', 'x'}, 5);
+  WriteChunk(chunks, "fmt ", Format(1, 2, 44100, 16), 16);
+  WriteChunk(chunks, "fact", {2, 0, 0, 0}, 4);
+
+  size_t offset = chunks.size() + 12 + 8;
+
+  WriteChunk(chunks, "data", {1, 0, 2, 0, 3, 0, 4, 0}, 8);
+
+  std::vector<uint8_t> data = Wave(chunks);
+
+  Expect(ParseWave(data.data(), data.size(), &info) == true, "wave with LIST and fact chunks");
+  Expect(info.tag == 1 and info.channels == 2 and info.sample_rate == 44100 and info.bits_per_sample == 16, "format after a LIST chunk");
+  Expect(info.block_align == 4, "block align of 16 bits stereo");
+  Expect(info.fact_frames == 2, "frames of the fact chunk");
+  Expect(info.data_offset == offset and info.data_size == 8, "samples after the fact chunk");
+}
+
+static void TestTruncatedData()
+{
+  std::vector<uint8_t> chunks;
+  WaveInfo info;
+
+  WriteChunk(chunks, "fmt ", Format(1, 2, 48000, 16), 16);
+  // an interrupted recording claims more samples than the file holds
+  WriteChunk(chunks, "data", {1, 0, 2, 0, 3, 0}, 4096);
+
+  std::vector<uint8_t> data = Wave(chunks);
+
+  Expect(ParseWave(data.data(), data.size(), &info) == true, "wave with a truncated data chunk");
+  Expect(info.data_size == 4, "truncated samples cut to whole frames");
+  Expect(info.data_offset + info.data_size <= data.size(), "truncated samples inside the file");
+  Expect(info.fact_frames == 0, "no fact chunk");
+}
+
+static void TestBadHeaders()
+{
+  std::vector<uint8_t> chunks;
+  WaveInfo info;
+
+  // the frame of 65535 channels of 16 bits does not fit the block align
+  WriteChunk(chunks, "fmt ", Format(1, 65535, 48000, 16), 16);
+  WriteChunk(chunks, "data", {1, 0, 2, 0}, 4);
+
+  std::vector<uint8_t> data = Wave(chunks);
+
+  Expect(ParseWave(data.data(), data.size(), &info) == false, "oversized channels rejected");
+
+  chunks.clear();
+
+  WriteChunk(chunks, "fmt ", Format(1, 0, 48000, 16), 16);
+  WriteChunk(chunks, "data", {1, 0, 2, 0}, 4);
+
+  data = Wave(chunks);
+
+  Expect(ParseWave(data.data(), data.size(), &info) == false, "no channels rejected");
+
+  chunks.clear();
+
+  WriteChunk(chunks, "fmt ", Format(1, 2, 48000, 64), 16);
+  WriteChunk(chunks, "data", {1, 0, 2, 0}, 4);
+
+  data = Wave(chunks);
+
+  Expect(ParseWave(data.data(), data.size(), &info) == false, "64 bits samples rejected");
+
+  chunks.clear();
+
+  // a format chunk longer than the file
+  WriteChunk(chunks, "fmt ", Format(1, 2, 48000, 16), 64);
+
+  data = Wave(chunks);
+
+  Expect(ParseWave(data.data(), data.size(), &info) == false, "truncated format rejected");
+
+  chunks.clear();
+
+  WriteChunk(chunks, "fmt ", Format(1, 2, 48000, 16), 16);
+
+  data = Wave(chunks);
+
+  Expect(ParseWave(data.data(), data.size(), &info) == false, "wave without samples rejected");
+  Expect(ParseWave(data.data(), 11, &info) == false, "header shorter than the riff");
+}
+
+int main()
+{
+  TestChunks();
+  TestTruncatedData();
+  TestBadHeaders();
+
+  return (failures == 0)?0:1;
+}